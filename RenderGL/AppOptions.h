@@ -0,0 +1,325 @@
+#ifndef APP_OPTIONS_H
+#define APP_OPTIONS_H
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+
+#include "Mesh.h"
+#include "ProgramBinaryCache.h"
+
+// Command line options, see printUsage() for what each of them does
+struct AppOptions
+{
+	bool headless = false;
+	unsigned int maxFrames = 0; // 0 -> no frame limit
+	float maxSeconds = 0.0f;    // 0 -> no deadline
+	std::string outputImagePath; // Written after the last frame when running headless
+
+	// Benchmarking
+	bool benchmark = false;
+	std::string cameraPathFile;       // Scripted/recorded camera path to replay, built-in path if empty
+	std::string benchmarkOutputFile;  // JSON report, stdout if empty
+	unsigned int warmupFrames = 10;   // Frames excluded from the statistics
+	std::string recordCameraPathFile; // Record the interactive camera into a path file for later replay
+
+	// Scene
+	unsigned int cubeCount = 0; // Stress scene with this many cubes, 0 -> the default single cube
+	bool instanced = false;     // Draw all cubes with instanced draw calls instead of one call per cube
+	VertexFormat vertexFormat;  // GPU vertex format of the meshes
+	bool frustumCulling = false; // Only draw objects whose bounding sphere intersects the view frustum
+	bool bvh = false;            // Cull through a BVH (which also picks the object in the screen center) instead of testing every object
+	std::string meshFile;        // OBJ/glTF/cooked mesh drawn for the objects instead of the cube
+	bool generateLods = false;   // Simplify the object mesh into levels of detail at load (or when cooking it)
+	float lodPixelError = DEFAULT_LOD_PIXEL_ERROR; // Screen space error allowed when picking a level of detail per object, 0 -> always full detail
+	bool meshlets = false;       // Split the object mesh into meshlets and cull them per object before drawing
+	bool gpuDriven = false;      // Cull, pick levels of detail and write the draw commands in a compute shader, one indirect draw for all objects
+
+	// Microbenchmarks, run instead of the renderer
+	bool cullingBenchmark = false;
+	bool bvhBenchmark = false;
+	unsigned int textureBenchmarkCount = 0; // Images loaded by the texture loading benchmark, 0 -> don't run it
+	bool mipBenchmark = false;
+	std::string importBenchmarkFile; // Mesh to measure single vs multi-threaded import throughput on, empty -> don't run it
+	std::string meshCodecBenchmarkFile; // Mesh to measure the vertex/index codecs on, empty -> don't run it
+
+	// Asset cooking/packing, run instead of the renderer
+	std::string cookInputFile;  // Source image
+	std::string cookOutputFile; // Cooked .rtex container
+	std::string cookMeshInputFile;  // Source mesh
+	std::string cookMeshOutputFile; // Cooked .rmesh container
+	std::string packOutputFile;          // Asset pack to write
+	std::vector<std::string> packInputFiles; // Files to put into it
+	std::string packBenchmarkFile;       // Asset pack to compare with its loose files
+	std::string assetPackFile;           // Load the shaders from this pack instead of the loose files
+	std::string shaderCacheDirectory = DEFAULT_PROGRAM_BINARY_CACHE_DIRECTORY; // Linked program binaries, empty -> always compile
+	bool serialShaderCompile = false; // Compile and check one program after the other even if the driver can compile in parallel
+	bool hotReload = false;           // Rebuild shaders whose sources change while running
+	bool showHelp = false;
+};
+
+inline void printUsage(const char* programName)
+{
+	std::cout << "Usage: " << programName << " [options]\n"
+		<< "  --headless         Render offscreen into an FBO through a surfaceless EGL context (no window, no display)\n"
+		<< "  --frames N         Stop after N frames (headless default: 100)\n"
+		<< "  --seconds S        Stop after S seconds of wall-clock time\n"
+		<< "  --output FILE.ppm  Save the last headless frame as a PPM image\n"
+		<< "  --bench            Benchmark: fixed timestep, scripted camera, JSON frame time report (default 600 frames)\n"
+		<< "  --camera-path FILE Camera path to replay while benchmarking (built-in path otherwise)\n"
+		<< "  --bench-out FILE   Write the benchmark JSON report to FILE instead of stdout\n"
+		<< "  --warmup N         Frames excluded from the benchmark statistics (default 10)\n"
+		<< "  --record-path FILE Record the interactive camera movement as a camera path\n"
+		<< "  --cubes N          Stress scene: spawn N cubes instead of the single one\n"
+		<< "  --instanced        Draw the cubes with instancing (per-instance model matrix + color) instead of one draw per cube\n"
+		<< "  --positions FMT    Vertex position format: float (default), half or unorm16\n"
+		<< "  --normals FMT      Vertex normal format: float (default), int2101010 or octahedral\n"
+		<< "  --mesh FILE        Draw the objects with the mesh from FILE (.obj, .glb or cooked .rmesh, fitted to the cube's size) instead of the cube\n"
+		<< "  --lods             Generate levels of detail for the object mesh at load (or store them with --cook-mesh), picked per object by screen space error\n"
+		<< "  --lod-error PIXELS Screen space error a level of detail may have (default 1, 0 -> always full detail)\n"
+		<< "  --meshlets         Split the object mesh into meshlets, cull back-facing and off-screen ones per object before drawing (not with --instanced)\n"
+		<< "  --gpu-driven       Cull the objects and pick their levels of detail in a compute shader, draw them all with one multi-draw indirect call\n"
+		<< "                     (needs OpenGL 4.3, replaces --cull, --bvh, --instanced and --meshlets)\n"
+		<< "  --cull             Frustum cull the cubes against their bounding spheres before drawing\n"
+		<< "  --cull-bench       Measure frustum culling throughput at 10k/100k/1M objects and exit\n"
+		<< "  --bvh              Frustum cull through a BVH and highlight the cube in the screen center (ray pick)\n"
+		<< "  --bvh-bench        Measure BVH build/refit/query times at 10k/100k/1M objects and exit\n"
+		<< "  --texture-bench N  Compare synchronous and asynchronous loading of N textures and exit (needs a context, combine with --headless)\n"
+		<< "  --mip-bench        Compare CPU mip generation (box/Kaiser/Lanczos) with glGenerateMipmap at 1K-8K and exit (needs a context, combine with --headless)\n"
+		<< "  --import-bench FILE Measure OBJ/glTF (.glb) import throughput in MB/s with one thread and with more, and exit\n"
+		<< "  --mesh-codec-bench FILE Measure vertex/index stream compression and decoding speed on a mesh (.obj, .glb or .rmesh) and exit\n"
+		<< "  --cook IN OUT      Cook the image IN into the compressed texture container OUT (.rtex, BC1/BC3 with mips) and exit\n"
+		<< "  --cook-mesh IN OUT Cook the mesh IN (.obj or .glb) into the compressed mesh container OUT (.rmesh) in the --positions/--normals format and exit\n"
+		<< "  --pack OUT FILE... Write the files into the asset pack OUT and exit (must be the last option)\n"
+		<< "  --pack-bench PACK  Compare cold/warm loading of the assets in PACK from the pack and from the loose files, and exit\n"
+		<< "  --assets PACK      Load the shaders from the asset pack PACK (see --pack) instead of the shaders directory\n"
+		<< "  --shader-cache DIR Keep linked program binaries in DIR (default " DEFAULT_PROGRAM_BINARY_CACHE_DIRECTORY ") to skip shader compilation on later runs\n"
+		<< "  --no-shader-cache  Always compile the shaders from source\n"
+		<< "  --serial-shaders   Compile the shaders one after the other instead of in parallel (KHR_parallel_shader_compile)\n"
+		<< "  --hot-reload       Watch the shaders directory and swap in shaders that change while running (Linux, inotify)\n"
+		<< "  --help             Print this message" << std::endl;
+}
+
+// Vertex format names as --positions/--normals take them, false for anything else
+inline bool parsePositionFormat(const char* name, PositionFormat& format)
+{
+	if (strcmp(name, "float") == 0)
+	{
+		format = POSITION_FLOAT32;
+	}
+	else if (strcmp(name, "half") == 0)
+	{
+		format = POSITION_HALF;
+	}
+	else if (strcmp(name, "unorm16") == 0)
+	{
+		format = POSITION_UNORM16;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+inline bool parseNormalFormat(const char* name, NormalFormat& format)
+{
+	if (strcmp(name, "float") == 0)
+	{
+		format = NORMAL_FLOAT32;
+	}
+	else if (strcmp(name, "int2101010") == 0)
+	{
+		format = NORMAL_INT_2_10_10_10;
+	}
+	else if (strcmp(name, "octahedral") == 0)
+	{
+		format = NORMAL_OCTAHEDRAL;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+inline AppOptions parseAppOptions(int argc, char* argv[])
+{
+	AppOptions options;
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (strcmp(arg, "--headless") == 0)
+		{
+			options.headless = true;
+		}
+		else if (strcmp(arg, "--frames") == 0 && hasValue)
+		{
+			options.maxFrames = (unsigned int)strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(arg, "--seconds") == 0 && hasValue)
+		{
+			options.maxSeconds = (float)atof(argv[++i]);
+		}
+		else if (strcmp(arg, "--output") == 0 && hasValue)
+		{
+			options.outputImagePath = argv[++i];
+		}
+		else if (strcmp(arg, "--bench") == 0)
+		{
+			options.benchmark = true;
+		}
+		else if (strcmp(arg, "--camera-path") == 0 && hasValue)
+		{
+			options.cameraPathFile = argv[++i];
+		}
+		else if (strcmp(arg, "--bench-out") == 0 && hasValue)
+		{
+			options.benchmarkOutputFile = argv[++i];
+		}
+		else if (strcmp(arg, "--warmup") == 0 && hasValue)
+		{
+			options.warmupFrames = (unsigned int)strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(arg, "--record-path") == 0 && hasValue)
+		{
+			options.recordCameraPathFile = argv[++i];
+		}
+		else if (strcmp(arg, "--cubes") == 0 && hasValue)
+		{
+			options.cubeCount = (unsigned int)strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(arg, "--instanced") == 0)
+		{
+			options.instanced = true;
+		}
+		else if (strcmp(arg, "--positions") == 0 && hasValue && parsePositionFormat(argv[i + 1], options.vertexFormat.positionFormat))
+		{
+			i++;
+		}
+		else if (strcmp(arg, "--normals") == 0 && hasValue && parseNormalFormat(argv[i + 1], options.vertexFormat.normalFormat))
+		{
+			i++;
+		}
+		else if (strcmp(arg, "--mesh") == 0 && hasValue)
+		{
+			options.meshFile = argv[++i];
+		}
+		else if (strcmp(arg, "--lods") == 0)
+		{
+			options.generateLods = true;
+		}
+		else if (strcmp(arg, "--lod-error") == 0 && hasValue)
+		{
+			options.lodPixelError = (float)atof(argv[++i]);
+		}
+		else if (strcmp(arg, "--meshlets") == 0)
+		{
+			options.meshlets = true;
+		}
+		else if (strcmp(arg, "--gpu-driven") == 0)
+		{
+			options.gpuDriven = true;
+		}
+		else if (strcmp(arg, "--cull") == 0)
+		{
+			options.frustumCulling = true;
+		}
+		else if (strcmp(arg, "--cull-bench") == 0)
+		{
+			options.cullingBenchmark = true;
+		}
+		else if (strcmp(arg, "--bvh") == 0)
+		{
+			options.bvh = true;
+		}
+		else if (strcmp(arg, "--bvh-bench") == 0)
+		{
+			options.bvhBenchmark = true;
+		}
+		else if (strcmp(arg, "--texture-bench") == 0 && hasValue)
+		{
+			options.textureBenchmarkCount = (unsigned int)strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(arg, "--mip-bench") == 0)
+		{
+			options.mipBenchmark = true;
+		}
+		else if (strcmp(arg, "--import-bench") == 0 && hasValue)
+		{
+			options.importBenchmarkFile = argv[++i];
+		}
+		else if (strcmp(arg, "--mesh-codec-bench") == 0 && hasValue)
+		{
+			options.meshCodecBenchmarkFile = argv[++i];
+		}
+		else if (strcmp(arg, "--cook") == 0 && i + 2 < argc)
+		{
+			options.cookInputFile = argv[++i];
+			options.cookOutputFile = argv[++i];
+		}
+		else if (strcmp(arg, "--cook-mesh") == 0 && i + 2 < argc)
+		{
+			options.cookMeshInputFile = argv[++i];
+			options.cookMeshOutputFile = argv[++i];
+		}
+		else if (strcmp(arg, "--pack") == 0 && hasValue)
+		{
+			options.packOutputFile = argv[++i];
+			while (i + 1 < argc)
+			{
+				options.packInputFiles.push_back(argv[++i]);
+			}
+		}
+		else if (strcmp(arg, "--pack-bench") == 0 && hasValue)
+		{
+			options.packBenchmarkFile = argv[++i];
+		}
+		else if (strcmp(arg, "--assets") == 0 && hasValue)
+		{
+			options.assetPackFile = argv[++i];
+		}
+		else if (strcmp(arg, "--shader-cache") == 0 && hasValue)
+		{
+			options.shaderCacheDirectory = argv[++i];
+		}
+		else if (strcmp(arg, "--no-shader-cache") == 0)
+		{
+			options.shaderCacheDirectory.clear();
+		}
+		else if (strcmp(arg, "--serial-shaders") == 0)
+		{
+			options.serialShaderCompile = true;
+		}
+		else if (strcmp(arg, "--hot-reload") == 0)
+		{
+			options.hotReload = true;
+		}
+		else if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0)
+		{
+			options.showHelp = true;
+		}
+		else
+		{
+			std::cout << "Unknown or incomplete option: " << arg << std::endl;
+			options.showHelp = true;
+		}
+	}
+
+	// Benchmarks always measure a fixed number of frames
+	if (options.benchmark && options.maxFrames == 0)
+	{
+		options.maxFrames = options.warmupFrames + 600;
+	}
+	// Without a window there is nothing to close, so make sure a headless run terminates
+	if (options.headless && options.maxFrames == 0 && options.maxSeconds <= 0.0f)
+	{
+		options.maxFrames = 100;
+	}
+	return options;
+}
+
+#endif
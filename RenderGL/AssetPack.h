@@ -0,0 +1,359 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Asset pack: many files (shaders, cooked textures, meshes) in one file that is memory mapped whole, so assets are consumed
+// straight from the mapping (glShaderSource, glCompressedTexImage2D, ...) without reading them into intermediate buffers.
+//
+// Layout (little endian): header, table of contents sorted by name, name strings, then the blobs, each aligned to
+// ASSET_PACK_ALIGNMENT so they can be read as arrays of any type in place. Every entry has a 64 bit FNV-1a hash of its contents
+
+#define ASSET_PACK_MAGIC 0x4B415052u // "RPAK"
+#define ASSET_PACK_VERSION 1u
+#define ASSET_PACK_ALIGNMENT 64
+
+struct AssetPackHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t namesSize; // Bytes of name strings after the table of contents
+};
+
+struct AssetPackEntry
+{
+	uint64_t offset; // From the start of the file
+	uint64_t size;
+	uint64_t contentHash;
+	uint32_t nameOffset; // Into the name strings
+	uint32_t nameLength;
+};
+
+// Bytes of one asset inside the mapping, valid while the pack is open
+struct AssetView
+{
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+
+	bool isValid() const
+	{
+		return data != nullptr;
+	}
+};
+
+inline uint64_t hashAssetBytes(const unsigned char* bytes, size_t size)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+class AssetPack
+{
+public:
+	AssetPack() : mapping(nullptr), mappedSize(0), entries(nullptr), names(nullptr), entryCount(0)
+#if defined(_WIN32)
+		, file(INVALID_HANDLE_VALUE), fileMapping(NULL)
+#endif
+	{
+	}
+	~AssetPack()
+	{
+		close();
+	}
+	AssetPack(const AssetPack&) = delete;
+	AssetPack& operator=(const AssetPack&) = delete;
+
+	// Map a pack read-only, false (and a message) if it can't be opened or isn't a valid pack
+	bool open(const std::string& path)
+	{
+		close();
+		if (!mapFile(path))
+		{
+			std::cout << "Failed to map asset pack: " << path << std::endl;
+			return false;
+		}
+
+		AssetPackHeader header;
+		bool valid = mappedSize >= sizeof(header);
+		if (valid)
+		{
+			memcpy(&header, mapping, sizeof(header));
+			valid = header.magic == ASSET_PACK_MAGIC && header.version == ASSET_PACK_VERSION
+				&& sizeof(header) + (uint64_t)header.entryCount * sizeof(AssetPackEntry) + header.namesSize <= mappedSize;
+		}
+		if (valid)
+		{
+			entries = (const AssetPackEntry*)(mapping + sizeof(header));
+			names = (const char*)(entries + header.entryCount);
+			entryCount = header.entryCount;
+			for (uint32_t i = 0; i < entryCount && valid; i++)
+			{
+				// Written so a corrupt offset or size can't wrap around
+				valid = entries[i].size <= mappedSize && entries[i].offset <= mappedSize - entries[i].size
+					&& (uint64_t)entries[i].nameOffset + entries[i].nameLength <= header.namesSize;
+			}
+		}
+		if (!valid)
+		{
+			std::cout << "Invalid asset pack: " << path << std::endl;
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close()
+	{
+		unmapFile();
+		entries = nullptr;
+		names = nullptr;
+		entryCount = 0;
+	}
+
+	bool isOpen() const
+	{
+		return mapping != nullptr;
+	}
+
+	// Asset by the name it was packed under (its path relative to the working directory when packing, '/' separated).
+	// Binary search, no allocations. Invalid view if there is no such asset
+	AssetView find(const std::string& name) const
+	{
+		const AssetPackEntry* end = entries + entryCount;
+		const AssetPackEntry* entry = std::lower_bound(entries, end, name, [this](const AssetPackEntry& candidate, const std::string& key)
+		{
+			return compareName(candidate, key) < 0;
+		});
+		AssetView view;
+		if (entry != end && compareName(*entry, name) == 0)
+		{
+			view.data = mapping + entry->offset;
+			view.size = (size_t)entry->size;
+		}
+		return view;
+	}
+
+	size_t getEntryCount() const
+	{
+		return entryCount;
+	}
+	std::string getEntryName(size_t index) const
+	{
+		return std::string(names + entries[index].nameOffset, entries[index].nameLength);
+	}
+	size_t getMappedSize() const
+	{
+		return mappedSize;
+	}
+
+	// Check every asset against its content hash. Reads the whole pack, so this is for tools and debugging, not startup
+	bool verify() const
+	{
+		bool valid = true;
+		for (size_t i = 0; i < entryCount; i++)
+		{
+			if (hashAssetBytes(mapping + entries[i].offset, (size_t)entries[i].size) != entries[i].contentHash)
+			{
+				std::cout << "Asset pack entry corrupt: " << getEntryName(i) << std::endl;
+				valid = false;
+			}
+		}
+		return valid;
+	}
+
+	// Packer: write the files into a pack at packPath, named by their paths as given
+	static bool write(const std::string& packPath, const std::vector<std::string>& filePaths)
+	{
+		std::vector<std::string> sortedPaths(filePaths);
+		for (std::string& path : sortedPaths)
+		{
+			std::replace(path.begin(), path.end(), '\\', '/');
+		}
+		std::sort(sortedPaths.begin(), sortedPaths.end());
+		sortedPaths.erase(std::unique(sortedPaths.begin(), sortedPaths.end()), sortedPaths.end());
+
+		AssetPackHeader header;
+		header.magic = ASSET_PACK_MAGIC;
+		header.version = ASSET_PACK_VERSION;
+		header.entryCount = (uint32_t)sortedPaths.size();
+		header.namesSize = 0;
+		std::vector<AssetPackEntry> packEntries(sortedPaths.size());
+		std::string packNames;
+		for (size_t i = 0; i < sortedPaths.size(); i++)
+		{
+			packEntries[i].nameOffset = (uint32_t)packNames.size();
+			packEntries[i].nameLength = (uint32_t)sortedPaths[i].size();
+			packNames += sortedPaths[i];
+		}
+		header.namesSize = (uint32_t)packNames.size();
+
+		// Blobs go after the table of contents, their offsets are patched in once their sizes are known
+		std::ofstream pack(packPath, std::ios::binary);
+		if (!pack)
+		{
+			std::cout << "Failed to write asset pack: " << packPath << std::endl;
+			return false;
+		}
+		uint64_t offset = sizeof(header) + packEntries.size() * sizeof(AssetPackEntry) + packNames.size();
+		pack.seekp((std::streamoff)offset);
+		std::vector<unsigned char> contents;
+		const char padding[ASSET_PACK_ALIGNMENT] = {};
+		for (size_t i = 0; i < sortedPaths.size(); i++)
+		{
+			std::ifstream file(sortedPaths[i], std::ios::binary | std::ios::ate);
+			if (!file)
+			{
+				std::cout << "Failed to read asset: " << sortedPaths[i] << std::endl;
+				return false;
+			}
+			contents.resize((size_t)file.tellg());
+			file.seekg(0);
+			file.read((char*)contents.data(), contents.size());
+
+			uint64_t alignedOffset = (offset + ASSET_PACK_ALIGNMENT - 1) / ASSET_PACK_ALIGNMENT * ASSET_PACK_ALIGNMENT;
+			pack.write(padding, (std::streamsize)(alignedOffset - offset));
+			packEntries[i].offset = alignedOffset;
+			packEntries[i].size = contents.size();
+			packEntries[i].contentHash = hashAssetBytes(contents.data(), contents.size());
+			pack.write((const char*)contents.data(), contents.size());
+			offset = alignedOffset + contents.size();
+		}
+		pack.seekp(0);
+		pack.write((const char*)&header, sizeof(header));
+		pack.write((const char*)packEntries.data(), packEntries.size() * sizeof(AssetPackEntry));
+		pack.write(packNames.data(), packNames.size());
+		if (!pack)
+		{
+			std::cout << "Failed to write asset pack: " << packPath << std::endl;
+			return false;
+		}
+		std::cout << "Packed " << sortedPaths.size() << " assets (" << offset << " bytes) into " << packPath << std::endl;
+		return true;
+	}
+
+private:
+	int compareName(const AssetPackEntry& entry, const std::string& name) const
+	{
+		int result = strncmp(names + entry.nameOffset, name.c_str(), std::min((size_t)entry.nameLength, name.size()));
+		if (result != 0)
+		{
+			return result;
+		}
+		return entry.nameLength < name.size() ? -1 : (entry.nameLength > name.size() ? 1 : 0);
+	}
+
+#if defined(_WIN32)
+	bool mapFile(const std::string& path)
+	{
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			unmapFile();
+			return false;
+		}
+		fileMapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		mapping = fileMapping ? (const unsigned char*)MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (!mapping)
+		{
+			unmapFile();
+			return false;
+		}
+		mappedSize = (size_t)size.QuadPart;
+		return true;
+	}
+	void unmapFile()
+	{
+		if (mapping)
+		{
+			UnmapViewOfFile(mapping);
+		}
+		if (fileMapping)
+		{
+			CloseHandle(fileMapping);
+		}
+		if (file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(file);
+		}
+		mapping = nullptr;
+		mappedSize = 0;
+		fileMapping = NULL;
+		file = INVALID_HANDLE_VALUE;
+	}
+#else
+	bool mapFile(const std::string& path)
+	{
+		int descriptor = ::open(path.c_str(), O_RDONLY);
+		if (descriptor < 0)
+		{
+			return false;
+		}
+		struct stat status;
+		void* address = MAP_FAILED;
+		if (fstat(descriptor, &status) == 0 && status.st_size > 0)
+		{
+			address = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		}
+		::close(descriptor); // The mapping keeps the file referenced
+		if (address == MAP_FAILED)
+		{
+			return false;
+		}
+		mapping = (const unsigned char*)address;
+		mappedSize = (size_t)status.st_size;
+		return true;
+	}
+	void unmapFile()
+	{
+		if (mapping)
+		{
+			munmap((void*)mapping, mappedSize);
+		}
+		mapping = nullptr;
+		mappedSize = 0;
+	}
+#endif
+
+	const unsigned char* mapping;
+	size_t mappedSize;
+	const AssetPackEntry* entries;
+	const char* names;
+	uint32_t entryCount;
+#if defined(_WIN32)
+	HANDLE file;
+	HANDLE fileMapping;
+#endif
+};
+
+#endif
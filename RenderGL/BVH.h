@@ -0,0 +1,539 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "glm/glm.hpp"
+#include "FrustumCulling.h"
+
+#define BVH_BIN_COUNT 16           // SAH split candidates per axis
+#define BVH_MAX_LEAF_SIZE 8        // Leaves may hold more objects only if they can't be split at all
+#define BVH_PARALLEL_THRESHOLD 4096 // Smaller subtrees aren't worth a thread
+#define BVH_MAX_SAH_DEPTH 40       // Deeper nodes are split in half, so the traversal stacks below can't overflow
+#define BVH_STACK_SIZE 64
+
+// Axis aligned bounding box, empty (min > max) by default
+struct AABB
+{
+	glm::vec3 min;
+	glm::vec3 max;
+
+	AABB() : min(FLT_MAX), max(-FLT_MAX)
+	{
+	}
+	AABB(const glm::vec3& min_in, const glm::vec3& max_in) : min(min_in), max(max_in)
+	{
+	}
+
+	// Box around a sphere (xyz = center, w = radius)
+	static AABB fromSphere(const glm::vec4& sphere)
+	{
+		return AABB(glm::vec3(sphere) - sphere.w, glm::vec3(sphere) + sphere.w);
+	}
+
+	void grow(const glm::vec3& point)
+	{
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+	void grow(const AABB& other)
+	{
+		min = glm::min(min, other.min);
+		max = glm::max(max, other.max);
+	}
+
+	glm::vec3 getCenter() const
+	{
+		return (min + max) * 0.5f;
+	}
+
+	float getSurfaceArea() const
+	{
+		glm::vec3 extent = max - min;
+		if (extent.x < 0.0f || extent.y < 0.0f || extent.z < 0.0f)
+		{
+			return 0.0f;
+		}
+		return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+	}
+
+	bool operator==(const AABB& other) const
+	{
+		return min == other.min && max == other.max;
+	}
+};
+
+// Every node covers a contiguous range of the BVH's object order, interior nodes the union of their children's ranges
+struct BVHNode
+{
+	AABB bounds;
+	unsigned int leftChild;      // 0 for leaves (the root is never a child), the right child is leftChild + 1
+	unsigned int parent;         // The root is its own parent
+	unsigned int firstObject;
+	unsigned int objectCount;
+
+	bool isLeaf() const
+	{
+		return leftChild == 0;
+	}
+};
+
+struct RayHit
+{
+	unsigned int object = ~0u;
+	float distance = FLT_MAX;
+};
+
+// Bounding volume hierarchy over object bounding boxes, for frustum culling, ray picking and range queries.
+// Built top-down with binned SAH (Wald 2007, "On fast Construction of SAH-based Bounding Volume Hierarchies"), subtrees in parallel.
+// Moving objects are handled by refitting the boxes without changing the tree, which is fine as long as they don't move far
+class BVH
+{
+public:
+	BVH()
+	{
+	}
+	BVH(const BVH&) = delete;
+	BVH& operator=(const BVH&) = delete;
+
+	// (Re)build over the given object bounds, using up to threadCount threads
+	void build(const std::vector<AABB>& bounds, unsigned int threadCount = 1)
+	{
+		// Objects are partitioned by value rather than through an index array, so every pass over a node reads memory linearly
+		unsigned int count = (unsigned int)bounds.size();
+		buildObjects.resize(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			buildObjects[i].bounds = bounds[i];
+			buildObjects[i].centroid = bounds[i].getCenter();
+			buildObjects[i].object = i;
+		}
+
+		nodes.clear();
+		objectOrder.resize(count);
+		orderedBounds.resize(count);
+		slotOfObject.resize(count);
+		leafOfObject.assign(count, 0);
+		if (count == 0)
+		{
+			return;
+		}
+
+		// A binary tree with at most one object per leaf has at most 2n - 1 nodes, so children can be allocated without locking
+		nodes.resize(2 * (size_t)count - 1);
+		nodes[0].parent = 0;
+		nodes[0].firstObject = 0;
+		nodes[0].objectCount = count;
+		std::atomic<unsigned int> nodeCount(1);
+		unsigned int parallelDepth = 0;
+		while ((1u << parallelDepth) < threadCount)
+		{
+			parallelDepth++;
+		}
+		buildNode(0, nodeCount, 0, threadCount > 1 ? parallelDepth + 1 : 0); // One level more than strictly needed, for load balancing
+		nodes.resize(nodeCount);
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			objectOrder[i] = buildObjects[i].object;
+			orderedBounds[i] = buildObjects[i].bounds;
+			slotOfObject[buildObjects[i].object] = i;
+		}
+		for (unsigned int n = 0; n < nodes.size(); n++)
+		{
+			if (nodes[n].isLeaf())
+			{
+				for (unsigned int i = nodes[n].firstObject; i < nodes[n].firstObject + nodes[n].objectCount; i++)
+				{
+					leafOfObject[objectOrder[i]] = n;
+				}
+			}
+		}
+		buildObjects.clear();
+		buildObjects.shrink_to_fit();
+	}
+
+	// Refit every node after many objects moved. Children always come after their parents, so one reverse pass is enough
+	void refit(const std::vector<AABB>& bounds)
+	{
+		for (size_t i = 0; i < objectOrder.size(); i++)
+		{
+			orderedBounds[i] = bounds[objectOrder[i]];
+		}
+		for (size_t n = nodes.size(); n-- > 0;)
+		{
+			nodes[n].bounds = computeNodeBounds(nodes[n]);
+		}
+	}
+
+	// Refit after a single object moved: only its leaf and the ancestors whose bounds actually change are touched
+	void updateObject(unsigned int object, const AABB& bounds)
+	{
+		orderedBounds[slotOfObject[object]] = bounds;
+		unsigned int n = leafOfObject[object];
+		while (true)
+		{
+			AABB newBounds = computeNodeBounds(nodes[n]);
+			if (newBounds == nodes[n].bounds)
+			{
+				break;
+			}
+			nodes[n].bounds = newBounds;
+			if (n == 0)
+			{
+				break;
+			}
+			n = nodes[n].parent;
+		}
+	}
+
+	// Objects whose box intersects the frustum. Subtrees entirely inside it are accepted without testing their objects
+	void cullFrustum(const Frustum& frustum, std::vector<unsigned int>& visible) const
+	{
+		visible.clear();
+		if (nodes.empty())
+		{
+			return;
+		}
+		unsigned int stack[BVH_STACK_SIZE];
+		unsigned int stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0)
+		{
+			const BVHNode& node = nodes[stack[--stackSize]];
+			if (!frustum.intersectsAABB(node.bounds.min, node.bounds.max))
+			{
+				continue;
+			}
+			if (frustum.containsAABB(node.bounds.min, node.bounds.max))
+			{
+				visible.insert(visible.end(), objectOrder.begin() + node.firstObject, objectOrder.begin() + node.firstObject + node.objectCount);
+			}
+			else if (node.isLeaf())
+			{
+				for (unsigned int i = node.firstObject; i < node.firstObject + node.objectCount; i++)
+				{
+					const AABB& bounds = orderedBounds[i];
+					if (frustum.intersectsAABB(bounds.min, bounds.max))
+					{
+						visible.push_back(objectOrder[i]);
+					}
+				}
+			}
+			else
+			{
+				stack[stackSize++] = node.leftChild;
+				stack[stackSize++] = node.leftChild + 1;
+			}
+		}
+	}
+
+	// Closest object box hit by the ray within maxDistance, e.g. picking with the camera position and front vector
+	bool raycast(const glm::vec3& origin, const glm::vec3& direction, RayHit& hit, float maxDistance = FLT_MAX) const
+	{
+		hit = RayHit();
+		hit.distance = maxDistance;
+		if (nodes.empty())
+		{
+			return false;
+		}
+		glm::vec3 inverseDirection = 1.0f / direction;
+		unsigned int stack[BVH_STACK_SIZE];
+		unsigned int stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0)
+		{
+			const BVHNode& node = nodes[stack[--stackSize]];
+			float nodeDistance;
+			if (!intersectRay(node.bounds, origin, inverseDirection, hit.distance, nodeDistance))
+			{
+				continue;
+			}
+			if (node.isLeaf())
+			{
+				for (unsigned int i = node.firstObject; i < node.firstObject + node.objectCount; i++)
+				{
+					float distance;
+					if (intersectRay(orderedBounds[i], origin, inverseDirection, hit.distance, distance))
+					{
+						hit.object = objectOrder[i];
+						hit.distance = distance;
+					}
+				}
+			}
+			else
+			{
+				// Visit the nearer child first so the farther one is more likely to be rejected by the shrinking hit distance
+				unsigned int nearChild = node.leftChild;
+				unsigned int farChild = node.leftChild + 1;
+				if (glm::dot(nodes[farChild].bounds.getCenter() - nodes[nearChild].bounds.getCenter(), direction) < 0.0f)
+				{
+					std::swap(nearChild, farChild);
+				}
+				stack[stackSize++] = farChild;
+				stack[stackSize++] = nearChild;
+			}
+		}
+		return hit.object != ~0u;
+	}
+
+	// Objects whose box is within radius of center
+	void queryRange(const glm::vec3& center, float radius, std::vector<unsigned int>& result) const
+	{
+		result.clear();
+		if (nodes.empty())
+		{
+			return;
+		}
+		unsigned int stack[BVH_STACK_SIZE];
+		unsigned int stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0)
+		{
+			const BVHNode& node = nodes[stack[--stackSize]];
+			if (!intersectSphere(node.bounds, center, radius))
+			{
+				continue;
+			}
+			if (node.isLeaf())
+			{
+				for (unsigned int i = node.firstObject; i < node.firstObject + node.objectCount; i++)
+				{
+					if (intersectSphere(orderedBounds[i], center, radius))
+					{
+						result.push_back(objectOrder[i]);
+					}
+				}
+			}
+			else
+			{
+				stack[stackSize++] = node.leftChild;
+				stack[stackSize++] = node.leftChild + 1;
+			}
+		}
+	}
+
+	size_t getNodeCount() const
+	{
+		return nodes.size();
+	}
+
+	size_t getObjectCount() const
+	{
+		return objectOrder.size();
+	}
+
+	// SAH cost of the tree relative to the root: expected node visits + object tests for a random ray
+	float computeCost() const
+	{
+		if (nodes.empty())
+		{
+			return 0.0f;
+		}
+		float rootArea = std::max(nodes[0].bounds.getSurfaceArea(), FLT_MIN);
+		float cost = 0.0f;
+		for (const BVHNode& node : nodes)
+		{
+			cost += node.bounds.getSurfaceArea() / rootArea * (node.isLeaf() ? (float)node.objectCount : 1.0f);
+		}
+		return cost;
+	}
+
+private:
+	struct Bin
+	{
+		AABB bounds;
+		unsigned int count = 0;
+	};
+
+	struct BuildObject
+	{
+		AABB bounds;
+		glm::vec3 centroid;
+		unsigned int object;
+	};
+
+	void buildNode(unsigned int nodeIndex, std::atomic<unsigned int>& nodeCount, unsigned int depth, unsigned int parallelDepth)
+	{
+		BVHNode& node = nodes[nodeIndex];
+		node.leftChild = 0;
+		BuildObject* first = &buildObjects[node.firstObject];
+		BuildObject* last = first + node.objectCount;
+		AABB centroidBounds;
+		node.bounds = AABB();
+		for (const BuildObject* object = first; object != last; object++)
+		{
+			node.bounds.grow(object->bounds);
+			centroidBounds.grow(object->centroid);
+		}
+		if (node.objectCount <= 1)
+		{
+			return;
+		}
+
+		// Bin the objects along all three axes in one pass, then find the cheapest split plane between bins along any axis
+		float bestCost = FLT_MAX;
+		int bestAxis = -1;
+		unsigned int bestSplit = 0;
+		Bin axisBins[3][BVH_BIN_COUNT];
+		glm::vec3 binScale(0.0f);
+		bool splittable = false;
+		for (int axis = 0; axis < 3 && depth < BVH_MAX_SAH_DEPTH; axis++)
+		{
+			float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+			binScale[axis] = extent > 0.0f ? BVH_BIN_COUNT / extent : 0.0f;
+			splittable = splittable || extent > 0.0f;
+		}
+		if (splittable)
+		{
+			for (const BuildObject* object = first; object != last; object++)
+			{
+				for (int axis = 0; axis < 3; axis++)
+				{
+					Bin& bin = axisBins[axis][getBin(object->centroid[axis], centroidBounds.min[axis], binScale[axis])];
+					bin.bounds.grow(object->bounds);
+					bin.count++;
+				}
+			}
+		}
+		for (int axis = 0; axis < 3 && splittable; axis++)
+		{
+			if (binScale[axis] == 0.0f)
+			{
+				continue;
+			}
+			const Bin* bins = axisBins[axis];
+
+			// Sweep from the right to get the cost of everything right of each split, then from the left
+			float rightAreas[BVH_BIN_COUNT];
+			unsigned int rightCounts[BVH_BIN_COUNT];
+			AABB rightBounds;
+			unsigned int rightCount = 0;
+			for (unsigned int b = BVH_BIN_COUNT - 1; b > 0; b--)
+			{
+				rightBounds.grow(bins[b].bounds);
+				rightCount += bins[b].count;
+				rightAreas[b] = rightBounds.getSurfaceArea();
+				rightCounts[b] = rightCount;
+			}
+			AABB leftBounds;
+			unsigned int leftCount = 0;
+			for (unsigned int split = 1; split < BVH_BIN_COUNT; split++)
+			{
+				leftBounds.grow(bins[split - 1].bounds);
+				leftCount += bins[split - 1].count;
+				if (leftCount == 0 || rightCounts[split] == 0)
+				{
+					continue;
+				}
+				float cost = leftBounds.getSurfaceArea() * leftCount + rightAreas[split] * rightCounts[split];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = split;
+				}
+			}
+		}
+
+		// Compare against not splitting: one traversal step + testing both children vs testing every object
+		float leafCost = node.bounds.getSurfaceArea() * node.objectCount;
+		float splitCost = node.bounds.getSurfaceArea() + bestCost;
+		BuildObject* middle;
+		if (bestAxis >= 0 && (splitCost < leafCost || node.objectCount > BVH_MAX_LEAF_SIZE))
+		{
+			float binMin = centroidBounds.min[bestAxis];
+			float axisScale = binScale[bestAxis];
+			middle = std::partition(first, last, [&](const BuildObject& object) { return getBin(object.centroid[bestAxis], binMin, axisScale) < bestSplit; });
+		}
+		else if (node.objectCount > BVH_MAX_LEAF_SIZE)
+		{
+			middle = first + node.objectCount / 2; // All centroids in the same spot (or too deep), any split is as good as another
+		}
+		else
+		{
+			return;
+		}
+
+		unsigned int leftChild = nodeCount.fetch_add(2);
+		node.leftChild = leftChild;
+		BVHNode& left = nodes[leftChild];
+		BVHNode& right = nodes[leftChild + 1];
+		left.parent = nodeIndex;
+		left.firstObject = node.firstObject;
+		left.objectCount = (unsigned int)(middle - first);
+		right.parent = nodeIndex;
+		right.firstObject = left.firstObject + left.objectCount;
+		right.objectCount = node.objectCount - left.objectCount;
+
+		// Both halves only touch their own objects and nodes, so the left one can be built on another thread
+		if (parallelDepth > 0 && node.objectCount > BVH_PARALLEL_THRESHOLD)
+		{
+			std::thread leftThread(&BVH::buildNode, this, leftChild, std::ref(nodeCount), depth + 1, parallelDepth - 1);
+			buildNode(leftChild + 1, nodeCount, depth + 1, parallelDepth - 1);
+			leftThread.join();
+		}
+		else
+		{
+			buildNode(leftChild, nodeCount, depth + 1, 0);
+			buildNode(leftChild + 1, nodeCount, depth + 1, 0);
+		}
+	}
+
+	static unsigned int getBin(float centroid, float binMin, float binScale)
+	{
+		return std::min((unsigned int)((centroid - binMin) * binScale), (unsigned int)BVH_BIN_COUNT - 1);
+	}
+
+	AABB computeNodeBounds(const BVHNode& node) const
+	{
+		AABB bounds;
+		if (node.isLeaf())
+		{
+			for (unsigned int i = node.firstObject; i < node.firstObject + node.objectCount; i++)
+			{
+				bounds.grow(orderedBounds[i]);
+			}
+		}
+		else
+		{
+			bounds = nodes[node.leftChild].bounds;
+			bounds.grow(nodes[node.leftChild + 1].bounds);
+		}
+		return bounds;
+	}
+
+	// Slab test, distance is where the ray enters the box (0 if it starts inside)
+	static bool intersectRay(const AABB& bounds, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, float& distance)
+	{
+		glm::vec3 t0 = (bounds.min - origin) * inverseDirection;
+		glm::vec3 t1 = (bounds.max - origin) * inverseDirection;
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+		float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+		distance = enter;
+		return enter <= exit;
+	}
+
+	static bool intersectSphere(const AABB& bounds, const glm::vec3& center, float radius)
+	{
+		glm::vec3 closest = glm::clamp(center, bounds.min, bounds.max);
+		glm::vec3 offset = closest - center;
+		return glm::dot(offset, offset) <= radius * radius;
+	}
+
+	std::vector<BVHNode> nodes;
+	std::vector<unsigned int> objectOrder;   // Objects sorted so that each node covers a contiguous range
+	std::vector<AABB> orderedBounds;         // Object bounds in that same order
+	std::vector<unsigned int> slotOfObject;  // Object -> position in objectOrder
+	std::vector<unsigned int> leafOfObject;  // For incremental refits
+	std::vector<BuildObject> buildObjects;   // Only needed while building
+};
+
+#endif
@@ -0,0 +1,300 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+// Fixed simulation step used while benchmarking, so every run renders exactly the same sequence of frames
+#define BENCHMARK_TIMESTEP (1.0f / 60.0f)
+
+// Statistics over a series of timings, all in milliseconds
+struct TimingSummary
+{
+	double mean = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+// Nearest-rank percentile of sorted samples: the smallest sample at least percent% of the samples are less than or equal to
+inline double getNearestRankPercentile(const std::vector<double>& sortedSamples, size_t percent)
+{
+	size_t rank = (percent * sortedSamples.size() + 99) / 100; // ceil(percent / 100 * count), in integers so it's exact
+	return sortedSamples[std::max(rank, (size_t)1) - 1];
+}
+
+// Nearest-rank percentiles
+inline TimingSummary summarizeTimings(std::vector<double> samples)
+{
+	TimingSummary summary;
+	if (samples.empty())
+	{
+		return summary;
+	}
+	std::sort(samples.begin(), samples.end());
+	double total = 0.0;
+	for (double sample : samples)
+	{
+		total += sample;
+	}
+	size_t count = samples.size();
+	summary.mean = total / count;
+	summary.p50 = getNearestRankPercentile(samples, 50);
+	summary.p95 = getNearestRankPercentile(samples, 95);
+	summary.p99 = getNearestRankPercentile(samples, 99);
+	summary.max = samples.back();
+	return summary;
+}
+
+// Measures GPU time per frame with GL_TIME_ELAPSED queries.
+// Queries are kept in a small ring and read back a few frames later, so measuring doesn't stall the CPU on the GPU.
+class GpuTimer
+{
+public:
+	GpuTimer() : writeIndex(0), readIndex(0)
+	{
+		glGenQueries(QUERY_COUNT, queries);
+	}
+	~GpuTimer()
+	{
+		glDeleteQueries(QUERY_COUNT, queries);
+	}
+
+	void begin()
+	{
+		// Ring is full, the oldest query has to be read before it can be reused
+		if (writeIndex - readIndex == QUERY_COUNT)
+		{
+			collect(true);
+		}
+		glBeginQuery(GL_TIME_ELAPSED, queries[writeIndex % QUERY_COUNT]);
+	}
+
+	void end()
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		writeIndex++;
+		collect(false);
+	}
+
+	// Read back finished queries, optionally waiting for all outstanding ones
+	void collect(bool wait)
+	{
+		while (readIndex < writeIndex)
+		{
+			unsigned int query = queries[readIndex % QUERY_COUNT];
+			if (!wait)
+			{
+				int available = 0;
+				glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+				if (!available)
+				{
+					break;
+				}
+			}
+			GLuint64 elapsedNanoseconds = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsedNanoseconds);
+			samples.push_back(elapsedNanoseconds / 1.0e6);
+			readIndex++;
+		}
+	}
+
+	// GPU time of every frame so far, in frame order
+	const std::vector<double>& getSamples()
+	{
+		return samples;
+	}
+
+private:
+	static const unsigned int QUERY_COUNT = 8;
+	unsigned int queries[QUERY_COUNT];
+	unsigned int writeIndex;
+	unsigned int readIndex;
+	std::vector<double> samples;
+};
+
+// Collects CPU/GPU frame times for a benchmark run and writes them out as JSON, so runs can be diffed across commits
+class Benchmark
+{
+public:
+	Benchmark(unsigned int warmupFrames_in) : warmupFrames(warmupFrames_in), frameIndex(0)
+	{
+	}
+
+	void beginFrame()
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (frameIndex > warmupFrames)
+		{
+			frameIntervals.push_back(std::chrono::duration<double, std::milli>(now - frameStart).count());
+		}
+		frameStart = now;
+		gpuTimer.begin();
+	}
+
+	void endFrame()
+	{
+		gpuTimer.end();
+		if (frameIndex >= warmupFrames)
+		{
+			cpuTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+		}
+		frameIndex++;
+	}
+
+	// Extra per-run metric to include in the report
+	void setCounter(const std::string& name, double value)
+	{
+		getCounter(name, false).value = value;
+	}
+
+	// Per-frame metric (e.g. draw calls), reported as the average over the measured frames. Call between beginFrame() and endFrame()
+	void addFrameCounter(const std::string& name, double value)
+	{
+		if (frameIndex >= warmupFrames)
+		{
+			getCounter(name, true).value += value;
+		}
+	}
+
+	// Sum of a counter over all measured frames
+	double getCounterTotal(const std::string& name)
+	{
+		for (const Counter& counter : counters)
+		{
+			if (counter.name == name)
+			{
+				return counter.value;
+			}
+		}
+		return 0.0;
+	}
+
+	unsigned int getMeasuredFrameCount()
+	{
+		return (unsigned int)cpuTimes.size();
+	}
+
+	// CPU time spent in the measured frames
+	double getMeasuredSeconds()
+	{
+		double total = 0.0;
+		for (double cpuTime : cpuTimes)
+		{
+			total += cpuTime;
+		}
+		return total / 1000.0;
+	}
+
+	std::string createReport(int width, int height)
+	{
+		gpuTimer.collect(true);
+		const std::vector<double>& allGpuTimes = gpuTimer.getSamples();
+		std::vector<double> gpuTimes;
+		if (allGpuTimes.size() > warmupFrames)
+		{
+			gpuTimes.assign(allGpuTimes.begin() + warmupFrames, allGpuTimes.end());
+		}
+
+		std::ostringstream json;
+		json << "{\n";
+		json << "  \"renderer\": \"" << escape((const char*)glGetString(GL_RENDERER)) << "\",\n";
+		json << "  \"gl_version\": \"" << escape((const char*)glGetString(GL_VERSION)) << "\",\n";
+		json << "  \"width\": " << width << ",\n";
+		json << "  \"height\": " << height << ",\n";
+		json << "  \"warmup_frames\": " << warmupFrames << ",\n";
+		json << "  \"frames\": " << cpuTimes.size() << ",\n";
+		writeSummary(json, "cpu_ms", summarizeTimings(cpuTimes));
+		writeSummary(json, "gpu_ms", summarizeTimings(gpuTimes));
+		writeSummary(json, "frame_interval_ms", summarizeTimings(frameIntervals));
+		json << "  \"counters\": {";
+		for (size_t i = 0; i < counters.size(); i++)
+		{
+			double value = counters[i].perFrame ? counters[i].value / std::max<size_t>(cpuTimes.size(), 1) : counters[i].value;
+			json << (i == 0 ? "\n" : ",\n") << "    \"" << counters[i].name << "\": " << value;
+		}
+		json << (counters.empty() ? "}\n" : "\n  }\n");
+		json << "}\n";
+		return json.str();
+	}
+
+	// Write the report to filePath, or to stdout if it's empty
+	bool writeReport(const std::string& filePath, int width, int height)
+	{
+		std::string report = createReport(width, height);
+		if (filePath.empty())
+		{
+			std::cout << report;
+			return true;
+		}
+		std::ofstream file(filePath.c_str());
+		if (!file)
+		{
+			std::cout << "ERROR::BENCHMARK::FAILED_TO_OPEN " << filePath << std::endl;
+			return false;
+		}
+		file << report;
+		return true;
+	}
+
+private:
+	struct Counter
+	{
+		std::string name;
+		double value;
+		bool perFrame;
+	};
+
+	Counter& getCounter(const std::string& name, bool perFrame)
+	{
+		for (Counter& counter : counters)
+		{
+			if (counter.name == name)
+			{
+				return counter;
+			}
+		}
+		Counter counter = { name, 0.0, perFrame };
+		counters.push_back(counter);
+		return counters.back();
+	}
+
+	static void writeSummary(std::ostringstream& json, const char* name, const TimingSummary& summary)
+	{
+		json << "  \"" << name << "\": { \"mean\": " << summary.mean << ", \"p50\": " << summary.p50 << ", \"p95\": " << summary.p95
+			<< ", \"p99\": " << summary.p99 << ", \"max\": " << summary.max << " },\n";
+	}
+
+	static std::string escape(const char* text)
+	{
+		std::string escaped;
+		for (const char* c = text; c != NULL && *c != '\0'; c++)
+		{
+			if (*c == '"' || *c == '\\')
+			{
+				escaped += '\\';
+			}
+			escaped += *c;
+		}
+		return escaped;
+	}
+
+	unsigned int warmupFrames;
+	unsigned int frameIndex;
+	std::chrono::steady_clock::time_point frameStart;
+
+	GpuTimer gpuTimer;
+	std::vector<double> cpuTimes;
+	std::vector<double> frameIntervals;
+	std::vector<Counter> counters;
+};
+
+#endif
@@ -71,6 +71,11 @@ public:
 			cameraPos += glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
 	}
 
+	void setPosition(const glm::vec3& position)
+	{
+		cameraPos = position;
+	}
+
 	float getFOV()
 	{
 		return fov;
@@ -81,6 +86,16 @@ public:
 		return lookAt_mat;
 	}
 
+	glm::vec3 getPosition()
+	{
+		return cameraPos;
+	}
+
+	glm::vec3 getFront()
+	{
+		return cameraFront;
+	}
+
 private:
 	glm::vec3 cameraPos;   // Position of the camera
 	glm::vec3 cameraFront; // Direction the camera is looking at
@@ -0,0 +1,193 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include "Camera.h"
+
+// One sample of a camera path. Yaw/pitch/FOV are interpolated between keyframes, movement is held until the next keyframe
+struct CameraKeyframe
+{
+	float time;
+	float yaw;
+	float pitch;
+	float fov;
+	unsigned int movementMask; // Bit (1 << Camera_Movement) set for every direction being moved in
+};
+
+inline unsigned int movementBit(Camera_Movement movement)
+{
+	return 1u << movement;
+}
+
+// Scripted or recorded camera motion, replayed through the same Camera interface the mouse/keyboard callbacks use.
+// File format: one keyframe per line, "time yaw pitch fov moves" where moves is any of F/B/L/R or '-' for none. '#' starts a comment.
+class CameraPath
+{
+public:
+	CameraPath() :
+		loop(-1),
+		startPosition(0.0f)
+	{
+	}
+
+	bool loadFromFile(const std::string& filePath)
+	{
+		std::ifstream file(filePath.c_str());
+		if (!file)
+		{
+			std::cout << "ERROR::CAMERA_PATH::FILE_NOT_SUCCESFULLY_READ " << filePath << std::endl;
+			return false;
+		}
+
+		keyframes.clear();
+		std::string line;
+		while (std::getline(file, line))
+		{
+			if (line.empty() || line[0] == '#')
+			{
+				continue;
+			}
+			std::istringstream lineStream(line);
+			CameraKeyframe keyframe;
+			std::string moves = "-";
+			if (!(lineStream >> keyframe.time >> keyframe.yaw >> keyframe.pitch >> keyframe.fov))
+			{
+				std::cout << "ERROR::CAMERA_PATH::MALFORMED_LINE " << line << std::endl;
+				continue;
+			}
+			lineStream >> moves;
+			keyframe.movementMask = parseMoves(moves);
+			keyframes.push_back(keyframe);
+		}
+		return !keyframes.empty();
+	}
+
+	bool saveToFile(const std::string& filePath)
+	{
+		std::ofstream file(filePath.c_str());
+		if (!file)
+		{
+			return false;
+		}
+		file << "# time yaw pitch fov moves\n";
+		for (const CameraKeyframe& keyframe : keyframes)
+		{
+			file << keyframe.time << " " << keyframe.yaw << " " << keyframe.pitch << " " << keyframe.fov << " " << formatMoves(keyframe.movementMask) << "\n";
+		}
+		return true;
+	}
+
+	// Built-in path used when no file is given: look around, strafe, fly in and out and zoom
+	static CameraPath createDefault()
+	{
+		CameraPath path;
+		path.addKeyframe(0.0f, -90.0f, 0.0f, 45.0f, 0);
+		path.addKeyframe(2.0f, -60.0f, -10.0f, 45.0f, movementBit(LEFT));
+		path.addKeyframe(4.0f, -120.0f, 10.0f, 35.0f, movementBit(RIGHT));
+		path.addKeyframe(6.0f, -90.0f, 0.0f, 25.0f, movementBit(FORWARD));
+		path.addKeyframe(8.0f, -100.0f, -20.0f, 45.0f, movementBit(BACKWARD));
+		path.addKeyframe(10.0f, -90.0f, 0.0f, 45.0f, 0);
+		return path;
+	}
+
+	void addKeyframe(float time, float yaw, float pitch, float fov, unsigned int movementMask)
+	{
+		CameraKeyframe keyframe = { time, yaw, pitch, fov, movementMask };
+		keyframes.push_back(keyframe);
+	}
+
+	// Drive the camera to where the path is at the given time. Past the end the path loops, every loop starts from where the camera
+	// was when the path was first applied, so every loop renders the same frames
+	void apply(Camera& camera, float time, float deltaTime)
+	{
+		if (keyframes.empty())
+		{
+			return;
+		}
+
+		float duration = getDuration();
+		long currentLoop = duration > 0.0f ? (long)floor(time / duration) : 0;
+		if (duration > 0.0f)
+		{
+			time = fmod(time, duration);
+		}
+		if (loop < 0)
+		{
+			startPosition = camera.getPosition();
+		}
+		if (currentLoop != loop)
+		{
+			// Movement follows the camera's facing, so that is reset to the start of the path as well
+			camera.setPosition(startPosition);
+			camera.updateYawAndPitch(keyframes[0].yaw, keyframes[0].pitch);
+			camera.update();
+			loop = currentLoop;
+		}
+
+		// Find the keyframe interval containing time
+		size_t next = 0;
+		while (next < keyframes.size() && keyframes[next].time <= time)
+		{
+			next++;
+		}
+		const CameraKeyframe& a = keyframes[next == 0 ? 0 : next - 1];
+		const CameraKeyframe& b = keyframes[next < keyframes.size() ? next : keyframes.size() - 1];
+		float t = (b.time > a.time) ? (time - a.time) / (b.time - a.time) : 0.0f;
+
+		camera.updateYawAndPitch(a.yaw + (b.yaw - a.yaw) * t, a.pitch + (b.pitch - a.pitch) * t);
+		camera.updateFOV(a.fov + (b.fov - a.fov) * t);
+		for (int movement = FORWARD; movement <= RIGHT; movement++)
+		{
+			if (a.movementMask & movementBit((Camera_Movement)movement))
+			{
+				camera.processMovement((Camera_Movement)movement, deltaTime);
+			}
+		}
+	}
+
+	float getDuration() const
+	{
+		return keyframes.empty() ? 0.0f : keyframes.back().time;
+	}
+
+	size_t getKeyframeCount() const
+	{
+		return keyframes.size();
+	}
+
+private:
+	static unsigned int parseMoves(const std::string& moves)
+	{
+		unsigned int mask = 0;
+		for (char c : moves)
+		{
+			if (c == 'F') mask |= movementBit(FORWARD);
+			if (c == 'B') mask |= movementBit(BACKWARD);
+			if (c == 'L') mask |= movementBit(LEFT);
+			if (c == 'R') mask |= movementBit(RIGHT);
+		}
+		return mask;
+	}
+
+	static std::string formatMoves(unsigned int mask)
+	{
+		std::string moves;
+		if (mask & movementBit(FORWARD)) moves += 'F';
+		if (mask & movementBit(BACKWARD)) moves += 'B';
+		if (mask & movementBit(LEFT)) moves += 'L';
+		if (mask & movementBit(RIGHT)) moves += 'R';
+		return moves.empty() ? "-" : moves;
+	}
+
+	std::vector<CameraKeyframe> keyframes;
+	long loop; // Loop of the path the camera is on, -1 before the path was first applied
+	glm::vec3 startPosition;
+};
+
+#endif
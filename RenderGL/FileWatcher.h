@@ -0,0 +1,212 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+#define DEFAULT_FILE_WATCHER_DEBOUNCE_MS 50 // Editors save in several steps (truncate + write, temp file + rename), wait for them to settle
+
+// Reports files that were written in watched directories. A background thread blocks on inotify (Linux) and collects the
+// changed paths, takeChanges() hands them out once no more events arrived for them for the debounce time. Paths are the
+// watched directory as given plus the file's path below it, '/' separated.
+// On other platforms start() fails and nothing is ever reported
+class FileWatcher
+{
+public:
+	FileWatcher(unsigned int debounceMilliseconds_in = DEFAULT_FILE_WATCHER_DEBOUNCE_MS) :
+		debounceMilliseconds(debounceMilliseconds_in),
+		running(false)
+#if defined(__linux__)
+		, inotifyDescriptor(-1)
+#endif
+	{
+#if defined(__linux__)
+		wakeupPipe[0] = -1;
+		wakeupPipe[1] = -1;
+#endif
+	}
+	~FileWatcher()
+	{
+		stop();
+	}
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	// Watch the directories (and their subdirectories as they are now) and start the watcher thread
+	bool start(const std::vector<std::string>& directories)
+	{
+		stop();
+#if defined(__linux__)
+		inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (inotifyDescriptor < 0 || pipe(wakeupPipe) != 0)
+		{
+			std::cout << "ERROR::FILE_WATCHER::INOTIFY_INIT_FAILED" << std::endl;
+			stop();
+			return false;
+		}
+		for (const std::string& directory : directories)
+		{
+			watchDirectory(directory);
+		}
+		if (watchedDirectories.empty())
+		{
+			std::cout << "ERROR::FILE_WATCHER::NOTHING_TO_WATCH" << std::endl;
+			stop();
+			return false;
+		}
+		running = true;
+		thread = std::thread([this]() { run(); });
+		return true;
+#else
+		std::cout << "ERROR::FILE_WATCHER::NOT_SUPPORTED_ON_THIS_PLATFORM (requires inotify on Linux)" << std::endl;
+		return false;
+#endif
+	}
+
+	void stop()
+	{
+#if defined(__linux__)
+		if (running)
+		{
+			running = false;
+			char wakeup = 0;
+			if (write(wakeupPipe[1], &wakeup, 1) < 0)
+			{
+				std::cout << "ERROR::FILE_WATCHER::WAKEUP_FAILED" << std::endl;
+			}
+			thread.join();
+		}
+		if (inotifyDescriptor >= 0)
+		{
+			close(inotifyDescriptor);
+		}
+		for (int& descriptor : wakeupPipe)
+		{
+			if (descriptor >= 0)
+			{
+				close(descriptor);
+			}
+			descriptor = -1;
+		}
+		inotifyDescriptor = -1;
+		watchedDirectories.clear();
+#endif
+		std::lock_guard<std::mutex> lock(mutex);
+		changes.clear();
+	}
+
+	bool isRunning() const
+	{
+		return running;
+	}
+
+	// Paths changed since the last call whose writes have settled. Cheap when nothing changed, call once per frame
+	std::vector<std::string> takeChanges()
+	{
+		std::vector<std::string> settled;
+		std::lock_guard<std::mutex> lock(mutex);
+		if (changes.empty())
+		{
+			return settled;
+		}
+		auto now = std::chrono::steady_clock::now();
+		for (auto it = changes.begin(); it != changes.end();)
+		{
+			if (now - it->second >= std::chrono::milliseconds(debounceMilliseconds))
+			{
+				settled.push_back(it->first);
+				it = changes.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+		return settled;
+	}
+
+private:
+#if defined(__linux__)
+	void watchDirectory(const std::string& directory)
+	{
+		int watch = inotify_add_watch(inotifyDescriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (watch < 0)
+		{
+			std::cout << "ERROR::FILE_WATCHER::CANNOT_WATCH " << directory << std::endl;
+			return;
+		}
+		watchedDirectories[watch] = directory;
+
+		DIR* listing = opendir(directory.c_str());
+		if (!listing)
+		{
+			return;
+		}
+		while (dirent* entry = readdir(listing))
+		{
+			std::string name = entry->d_name;
+			if (entry->d_type == DT_DIR && name != "." && name != "..")
+			{
+				watchDirectory(directory + "/" + name);
+			}
+		}
+		closedir(listing);
+	}
+
+	// Watcher thread: sleeps until there are events (or stop() wakes it up)
+	void run()
+	{
+		alignas(struct inotify_event) char buffer[16 * 1024];
+		while (running)
+		{
+			pollfd descriptors[2] = { { inotifyDescriptor, POLLIN, 0 }, { wakeupPipe[0], POLLIN, 0 } };
+			if (poll(descriptors, 2, -1) <= 0 || !running)
+			{
+				continue;
+			}
+			ssize_t length;
+			while ((length = read(inotifyDescriptor, buffer, sizeof(buffer))) > 0)
+			{
+				auto now = std::chrono::steady_clock::now();
+				std::lock_guard<std::mutex> lock(mutex);
+				for (char* event = buffer; event < buffer + length;)
+				{
+					const inotify_event* notification = (const inotify_event*)event;
+					auto directory = watchedDirectories.find(notification->wd);
+					if (notification->len > 0 && directory != watchedDirectories.end())
+					{
+						changes[directory->second + "/" + notification->name] = now; // Later events push the deadline out
+					}
+					event += sizeof(inotify_event) + notification->len;
+				}
+			}
+		}
+	}
+#endif
+
+	unsigned int debounceMilliseconds;
+	std::atomic<bool> running;
+	std::thread thread;
+	std::mutex mutex;
+	std::map<std::string, std::chrono::steady_clock::time_point> changes; // Path -> time of the last event
+#if defined(__linux__)
+	int inotifyDescriptor;
+	int wakeupPipe[2];
+	std::map<int, std::string> watchedDirectories; // By watch descriptor, only changed before the thread starts
+#endif
+};
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+// Offscreen render target (RGBA8 color + 24-bit depth), used in place of the window's default framebuffer when running headless
+class Framebuffer
+{
+public:
+	Framebuffer(int width_in, int height_in) : ID(0), colorRBO(0), depthRBO(0), width(width_in), height(height_in)
+	{
+		glGenFramebuffers(1, &ID);
+		glBindFramebuffer(GL_FRAMEBUFFER, ID);
+
+		// Renderbuffers since we never sample from these, we only read the final image back
+		glGenRenderbuffers(1, &colorRBO);
+		glBindRenderbuffer(GL_RENDERBUFFER, colorRBO);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRBO);
+
+		glGenRenderbuffers(1, &depthRBO);
+		glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "ERROR::FRAMEBUFFER::INCOMPLETE" << std::endl;
+		}
+
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+	~Framebuffer()
+	{
+		unbind();
+		glDeleteRenderbuffers(1, &colorRBO);
+		glDeleteRenderbuffers(1, &depthRBO);
+		glDeleteFramebuffers(1, &ID);
+	}
+
+	// Bind as the render target and match the viewport to it
+	void bind()
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, ID);
+		glViewport(0, 0, width, height);
+	}
+	void unbind()
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	// Read back the color attachment and write it out as a binary PPM
+	bool saveToPPM(const std::string& filePath)
+	{
+		std::vector<unsigned char> pixels(width * height * 4);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, ID);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+		std::ofstream file(filePath.c_str(), std::ios::binary);
+		if (!file)
+		{
+			std::cout << "ERROR::FRAMEBUFFER::FAILED_TO_OPEN " << filePath << std::endl;
+			return false;
+		}
+		file << "P6\n" << width << " " << height << "\n255\n";
+		// Flip rows, since OGL's origin is the bottom-left corner
+		for (int y = height - 1; y >= 0; y--)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				file.write((const char*)&pixels[(y * width + x) * 4], 3);
+			}
+		}
+		return true;
+	}
+
+	unsigned int getID()
+	{
+		return ID;
+	}
+	int getWidth()
+	{
+		return width;
+	}
+	int getHeight()
+	{
+		return height;
+	}
+
+private:
+	unsigned int ID;
+	unsigned int colorRBO;
+	unsigned int depthRBO;
+
+	int width;
+	int height;
+};
+
+#endif
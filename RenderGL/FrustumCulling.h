@@ -0,0 +1,253 @@
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+#include <vector>
+#include <cmath>
+
+#include "glm/glm.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULLING_SSE 1
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define FRUSTUM_CULLING_AVX2 1
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h> // _BitScanForward
+#endif
+
+// View frustum as 6 planes (xyz = inward facing normal, w = distance), a point p is inside a plane if dot(xyz, p) + w >= 0
+struct Frustum
+{
+	glm::vec4 planes[6];
+
+	// Extract the planes from projection * view (Gribb & Hartmann), they end up in world space
+	static Frustum fromMatrix(const glm::mat4& viewProjection)
+	{
+		// glm is column major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++)
+		{
+			rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+		}
+
+		Frustum frustum;
+		frustum.planes[0] = rows[3] + rows[0]; // Left
+		frustum.planes[1] = rows[3] - rows[0]; // Right
+		frustum.planes[2] = rows[3] + rows[1]; // Bottom
+		frustum.planes[3] = rows[3] - rows[1]; // Top
+		frustum.planes[4] = rows[3] + rows[2]; // Near
+		frustum.planes[5] = rows[3] - rows[2]; // Far
+		for (glm::vec4& plane : frustum.planes)
+		{
+			plane = plane / glm::length(glm::vec3(plane));
+		}
+		return frustum;
+	}
+
+	bool intersectsSphere(const glm::vec3& center, float radius) const
+	{
+		for (const glm::vec4& plane : planes)
+		{
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Conservative: only rejects boxes that are entirely outside one of the planes
+	bool intersectsAABB(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const
+	{
+		for (const glm::vec4& plane : planes)
+		{
+			// Box corner furthest along the plane normal
+			glm::vec3 corner(plane.x >= 0.0f ? boundsMax.x : boundsMin.x, plane.y >= 0.0f ? boundsMax.y : boundsMin.y, plane.z >= 0.0f ? boundsMax.z : boundsMin.z);
+			if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// True if the box is entirely inside the frustum (its corner nearest to each plane is inside it)
+	bool containsAABB(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const
+	{
+		for (const glm::vec4& plane : planes)
+		{
+			glm::vec3 corner(plane.x >= 0.0f ? boundsMin.x : boundsMax.x, plane.y >= 0.0f ? boundsMin.y : boundsMax.y, plane.z >= 0.0f ? boundsMin.z : boundsMax.z);
+			if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+// Bounding spheres of many objects in SoA layout, tested against a frustum 4 (SSE) or 8 (AVX2) at a time.
+// Produces the compact list of visible object indices that the draw loop consumes
+class FrustumCuller
+{
+public:
+	void clear()
+	{
+		centerX.clear();
+		centerY.clear();
+		centerZ.clear();
+		radius.clear();
+	}
+
+	void addSphere(const glm::vec3& center, float sphereRadius)
+	{
+		centerX.push_back(center.x);
+		centerY.push_back(center.y);
+		centerZ.push_back(center.z);
+		radius.push_back(sphereRadius);
+	}
+
+	void setSphere(size_t index, const glm::vec3& center, float sphereRadius)
+	{
+		centerX[index] = center.x;
+		centerY[index] = center.y;
+		centerZ[index] = center.z;
+		radius[index] = sphereRadius;
+	}
+
+	size_t getCount() const
+	{
+		return radius.size();
+	}
+
+	// Instruction set cull() was compiled for
+	static const char* getSimdName()
+	{
+#if defined(FRUSTUM_CULLING_AVX2)
+		return "AVX2";
+#elif defined(FRUSTUM_CULLING_SSE)
+		return "SSE2";
+#else
+		return "scalar";
+#endif
+	}
+
+	// Fill visible with the indices of all spheres intersecting the frustum, in increasing order
+	void cull(const Frustum& frustum, std::vector<unsigned int>& visible) const
+	{
+		visible.resize(radius.size());
+		size_t visibleCount = 0;
+		size_t i = 0;
+#if defined(FRUSTUM_CULLING_AVX2)
+		visibleCount = cullAVX2(frustum, visible.data(), i);
+#elif defined(FRUSTUM_CULLING_SSE)
+		visibleCount = cullSSE(frustum, visible.data(), i);
+#endif
+		// Leftovers that don't fill a whole SIMD register
+		for (; i < radius.size(); i++)
+		{
+			if (frustum.intersectsSphere(glm::vec3(centerX[i], centerY[i], centerZ[i]), radius[i]))
+			{
+				visible[visibleCount++] = (unsigned int)i;
+			}
+		}
+		visible.resize(visibleCount);
+	}
+
+	// Reference implementation, one sphere at a time
+	void cullScalar(const Frustum& frustum, std::vector<unsigned int>& visible) const
+	{
+		visible.clear();
+		for (size_t i = 0; i < radius.size(); i++)
+		{
+			if (frustum.intersectsSphere(glm::vec3(centerX[i], centerY[i], centerZ[i]), radius[i]))
+			{
+				visible.push_back((unsigned int)i);
+			}
+		}
+	}
+
+private:
+#if defined(FRUSTUM_CULLING_SSE)
+	size_t cullSSE(const Frustum& frustum, unsigned int* visible, size_t& i) const
+	{
+		size_t visibleCount = 0;
+		size_t count = radius.size() & ~(size_t)3;
+		for (; i < count; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(&centerX[i]);
+			__m128 y = _mm_loadu_ps(&centerY[i]);
+			__m128 z = _mm_loadu_ps(&centerZ[i]);
+			__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&radius[i]));
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (const glm::vec4& plane : frustum.planes)
+			{
+				// Summed in the order of intersectsSphere(), so the results match cullScalar() bit for bit
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+					_mm_mul_ps(z, _mm_set1_ps(plane.z))), _mm_set1_ps(plane.w));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+			}
+			int mask = _mm_movemask_ps(inside);
+			while (mask)
+			{
+				int lane = countTrailingZeros(mask);
+				visible[visibleCount++] = (unsigned int)(i + lane);
+				mask &= mask - 1;
+			}
+		}
+		return visibleCount;
+	}
+#endif
+
+#if defined(FRUSTUM_CULLING_AVX2)
+	size_t cullAVX2(const Frustum& frustum, unsigned int* visible, size_t& i) const
+	{
+		size_t visibleCount = 0;
+		size_t count = radius.size() & ~(size_t)7;
+		for (; i < count; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(&centerX[i]);
+			__m256 y = _mm256_loadu_ps(&centerY[i]);
+			__m256 z = _mm256_loadu_ps(&centerZ[i]);
+			__m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&radius[i]));
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (const glm::vec4& plane : frustum.planes)
+			{
+				// No FMA: it isn't part of AVX2, and fused rounding could flip spheres that touch a plane compared to cullScalar()
+				__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(plane.x)), _mm256_mul_ps(y, _mm256_set1_ps(plane.y))),
+					_mm256_mul_ps(z, _mm256_set1_ps(plane.z))), _mm256_set1_ps(plane.w));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+			}
+			int mask = _mm256_movemask_ps(inside);
+			while (mask)
+			{
+				int lane = countTrailingZeros(mask);
+				visible[visibleCount++] = (unsigned int)(i + lane);
+				mask &= mask - 1;
+			}
+		}
+		return visibleCount;
+	}
+#endif
+
+	static int countTrailingZeros(int mask)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, (unsigned long)mask);
+		return (int)index;
+#else
+		return __builtin_ctz((unsigned int)mask);
+#endif
+	}
+
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radius;
+};
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include <cstring>
+
+// Functionality beyond the GL 3.3 core that glad loads. It's used when the driver has it (as an extension or because the context
+// is newer), so these entry points are loaded by hand with the same loader glad got, see loadGLExtensions()
+
+// ARB_get_program_binary (core in 4.1)
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+// KHR_parallel_shader_compile (ARB_parallel_shader_compile is the same with other names)
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Compute shaders, shader storage buffers and multi-draw indirect (core in 4.3)
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+#define GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT 0x90DF
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+#ifndef GL_BUFFER_UPDATE_BARRIER_BIT
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#endif
+
+typedef void (APIENTRYP GLGetProgramBinaryFunction)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP GLProgramBinaryFunction)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP GLProgramParameteriFunction)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP GLMaxShaderCompilerThreadsFunction)(GLuint count);
+typedef void (APIENTRYP GLDispatchComputeFunction)(GLuint groupsX, GLuint groupsY, GLuint groupsZ);
+typedef void (APIENTRYP GLMemoryBarrierFunction)(GLbitfield barriers);
+typedef void (APIENTRYP GLMultiDrawElementsIndirectFunction)(GLenum mode, GLenum type, const void* indirect, GLsizei drawCount, GLsizei stride);
+
+// Entry points are null when the driver doesn't support the functionality
+struct GLExtensions
+{
+	bool programBinary = false; // Program binaries can be retrieved and loaded, with at least one binary format
+	GLGetProgramBinaryFunction getProgramBinary = nullptr;
+	GLProgramBinaryFunction programBinaryLoad = nullptr;
+	GLProgramParameteriFunction programParameteri = nullptr;
+
+	bool parallelShaderCompile = false; // Compiles/links may run on driver threads, GL_COMPLETION_STATUS_KHR can be queried
+	GLMaxShaderCompilerThreadsFunction maxShaderCompilerThreads = nullptr;
+
+	bool gpuDrivenDrawing = false; // Compute shaders writing into storage buffers, draws whose parameters come from a buffer (the GPU's)
+	GLDispatchComputeFunction dispatchCompute = nullptr;
+	GLMemoryBarrierFunction memoryBarrier = nullptr;
+	GLMultiDrawElementsIndirectFunction multiDrawElementsIndirect = nullptr;
+};
+
+inline GLExtensions& getGLExtensions()
+{
+	static GLExtensions extensions;
+	return extensions;
+}
+
+// Whether the current context is at least GL major.minor
+inline bool isGLVersionAtLeast(int major, int minor)
+{
+	GLint contextMajor = 0;
+	GLint contextMinor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+	glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+	return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+}
+
+// Whether the current context exposes the extension (full name, e.g. "GL_ARB_get_program_binary")
+inline bool hasGLExtension(const char* name)
+{
+	GLint extensionCount = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+	for (GLint i = 0; i < extensionCount; i++)
+	{
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (extension && strcmp(extension, name) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Load the entry points above, call once after glad was initialized, with the same loader and the context current
+inline void loadGLExtensions(GLADloadproc loader)
+{
+	GLExtensions& extensions = getGLExtensions();
+	extensions = GLExtensions();
+
+	if (isGLVersionAtLeast(4, 1) || hasGLExtension("GL_ARB_get_program_binary"))
+	{
+		extensions.getProgramBinary = (GLGetProgramBinaryFunction)loader("glGetProgramBinary");
+		extensions.programBinaryLoad = (GLProgramBinaryFunction)loader("glProgramBinary");
+		extensions.programParameteri = (GLProgramParameteriFunction)loader("glProgramParameteri");
+		GLint formatCount = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+		extensions.programBinary = extensions.getProgramBinary && extensions.programBinaryLoad && extensions.programParameteri && formatCount > 0;
+	}
+
+	if (hasGLExtension("GL_KHR_parallel_shader_compile"))
+	{
+		extensions.maxShaderCompilerThreads = (GLMaxShaderCompilerThreadsFunction)loader("glMaxShaderCompilerThreadsKHR");
+	}
+	else if (hasGLExtension("GL_ARB_parallel_shader_compile"))
+	{
+		extensions.maxShaderCompilerThreads = (GLMaxShaderCompilerThreadsFunction)loader("glMaxShaderCompilerThreadsARB");
+	}
+	extensions.parallelShaderCompile = extensions.maxShaderCompilerThreads != nullptr;
+
+	// Only with a 4.3 context, the compute shaders are GLSL 430
+	if (isGLVersionAtLeast(4, 3))
+	{
+		extensions.dispatchCompute = (GLDispatchComputeFunction)loader("glDispatchCompute");
+		extensions.memoryBarrier = (GLMemoryBarrierFunction)loader("glMemoryBarrier");
+		extensions.multiDrawElementsIndirect = (GLMultiDrawElementsIndirectFunction)loader("glMultiDrawElementsIndirect");
+		extensions.gpuDrivenDrawing = extensions.dispatchCompute && extensions.memoryBarrier && extensions.multiDrawElementsIndirect;
+	}
+}
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef GPU_DRIVEN_RENDERER_H
+#define GPU_DRIVEN_RENDERER_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include <vector>
+#include <iostream>
+
+#include "glm/glm.hpp"
+#include "GLExtensions.h"
+#include "Shader.h"
+#include "Mesh.h"
+
+// GPU-driven drawing: the object bounds and the mesh's levels of detail live in storage buffers, a compute shader
+// (shaders/object_culling.comp) culls every object against the frustum, picks its level of detail and writes its draw command,
+// and all objects are drawn with one glMultiDrawElementsIndirect(). The CPU issues the same few calls whatever the object count.
+// Needs GL 4.3 (GLExtensions::gpuDrivenDrawing)
+
+// Must match local_size_x in shaders/object_culling.comp
+#define GPU_CULLING_GROUP_SIZE 64
+// Frames the culling statistics are read back late, so reading them doesn't wait for the GPU
+#define DEFAULT_GPU_CULL_STATS_FRAMES 3
+
+// Storage buffer binding points, must match the shader
+#define GPU_OBJECT_BOUNDS_BINDING 0
+#define GPU_LODS_BINDING 1
+#define GPU_DRAW_COMMANDS_BINDING 2
+#define GPU_CULL_STATS_BINDING 3
+
+// Layout glMultiDrawElementsIndirect() reads
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// A level of detail as the shader reads it (std430)
+struct GpuLodRange
+{
+	GLuint indexOffset;
+	GLuint indexCount;
+	float error;
+	float padding;
+};
+
+// What the culling shader counted in one frame
+struct GpuCullStats
+{
+	GLuint visibleObjects = 0;
+	GLuint triangles = 0;
+};
+
+class GpuDrivenRenderer
+{
+public:
+	// Objects with world space bounding spheres, all drawn with mesh (meshRadius is the radius of the mesh's own bounding sphere,
+	// it gives the scale of each object). The scene is static, the bounds are uploaded once
+	GpuDrivenRenderer(Shader& cullingShader_in, Mesh& mesh_in, const std::vector<glm::vec4>& objectSpheres, float meshRadius,
+		unsigned int statsFrameCount = DEFAULT_GPU_CULL_STATS_FRAMES) :
+		cullingShader(cullingShader_in),
+		mesh(mesh_in),
+		objectCount((unsigned int)objectSpheres.size()),
+		statsRegionStride(0),
+		statsRegionCount(statsFrameCount),
+		currentStatsRegion(0),
+		stallCount(0),
+		statsFences(statsFrameCount, (GLsync)0)
+	{
+		std::vector<GpuLodRange> lods(mesh.getLodCount());
+		for (unsigned int i = 0; i < mesh.getLodCount(); i++)
+		{
+			const MeshLod& lod = mesh.getLod(i);
+			lods[i] = { lod.indexOffset, lod.indexCount, lod.error, 0.0f };
+		}
+
+		glGenBuffers(1, &objectBoundsBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, objectBoundsBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, objectSpheres.size() * sizeof(glm::vec4), objectSpheres.data(), GL_STATIC_DRAW);
+
+		glGenBuffers(1, &lodBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, lodBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, lods.size() * sizeof(GpuLodRange), lods.data(), GL_STATIC_DRAW);
+
+		// Written by the shader every frame, read by the draw
+		glGenBuffers(1, &commandBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, objectSpheres.size() * sizeof(DrawElementsIndirectCommand), NULL, GL_DYNAMIC_COPY);
+
+		// A ring of regions like UniformRingBuffer, each one starting at a bindable offset
+		int offsetAlignment = 256;
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+		statsRegionStride = (sizeof(GpuCullStats) + offsetAlignment - 1) / offsetAlignment * offsetAlignment;
+		glGenBuffers(1, &statsBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, statsRegionStride * statsRegionCount, NULL, GL_DYNAMIC_READ);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		// Resolve uniform handles once
+		objectCountUniform = cullingShader.getUniform<int>("objectCount");
+		lodCountUniform = cullingShader.getUniform<int>("lodCount");
+		cameraPositionUniform = cullingShader.getUniform<glm::vec3>("cameraPosition");
+		meshRadiusUniform = cullingShader.getUniform<float>("meshRadius");
+		lodProjectionScaleUniform = cullingShader.getUniform<float>("lodProjectionScale");
+		lodPixelErrorUniform = cullingShader.getUniform<float>("lodPixelError");
+
+		cullingShader.use();
+		cullingShader.set(objectCountUniform, (int)objectCount);
+		cullingShader.set(lodCountUniform, (int)lods.size());
+		cullingShader.set(meshRadiusUniform, meshRadius);
+	}
+	GpuDrivenRenderer(const GpuDrivenRenderer&) = delete;
+	GpuDrivenRenderer& operator=(const GpuDrivenRenderer&) = delete;
+	~GpuDrivenRenderer()
+	{
+		for (GLsync fence : statsFences)
+		{
+			if (fence)
+			{
+				glDeleteSync(fence);
+			}
+		}
+		glDeleteBuffers(1, &objectBoundsBuffer);
+		glDeleteBuffers(1, &lodBuffer);
+		glDeleteBuffers(1, &commandBuffer);
+		glDeleteBuffers(1, &statsBuffer);
+	}
+
+	// Write this frame's draw commands, with the camera in the FrameData block. Levels of detail are picked like Mesh::selectLod(),
+	// maxPixelError 0 -> always full detail. Call once per frame, before draw()
+	void cull(const glm::vec3& cameraPosition, float projectionScale, float maxPixelError)
+	{
+		currentStatsRegion = (currentStatsRegion + 1) % statsRegionCount;
+		readStats(currentStatsRegion);
+
+		GpuCullStats zero;
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsBuffer);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, currentStatsRegion * statsRegionStride, sizeof(GpuCullStats), &zero);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_OBJECT_BOUNDS_BINDING, objectBoundsBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_LODS_BINDING, lodBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_DRAW_COMMANDS_BINDING, commandBuffer);
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, GPU_CULL_STATS_BINDING, statsBuffer, currentStatsRegion * statsRegionStride, sizeof(GpuCullStats));
+
+		cullingShader.use();
+		cullingShader.set(cameraPositionUniform, cameraPosition);
+		cullingShader.set(lodProjectionScaleUniform, projectionScale);
+		cullingShader.set(lodPixelErrorUniform, maxPixelError);
+		getGLExtensions().dispatchCompute((objectCount + GPU_CULLING_GROUP_SIZE - 1) / GPU_CULLING_GROUP_SIZE, 1, 1);
+
+		// The draw reads the commands as its parameters, the statistics get read back with glGetBufferSubData()
+		getGLExtensions().memoryBarrier(GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	}
+
+	// Draw every object with the commands from cull(), with the mesh's instanced vertex array and program bound. The per-instance
+	// attributes have to start at the first object, each command's base instance selects its object
+	void draw()
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+		mesh.drawIndirect((GLsizei)objectCount);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	// Mark this frame's statistics region as in use. Call once per frame, after draw()
+	void fenceFrame()
+	{
+		statsFences[currentStatsRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	// Statistics of the frame statsFrameCount frames before the current one, zero for the first frames
+	const GpuCullStats& getStats() const
+	{
+		return stats;
+	}
+
+	// Number of times reading the statistics had to wait for the GPU
+	unsigned int getStallCount() const
+	{
+		return stallCount;
+	}
+
+private:
+	void readStats(unsigned int region)
+	{
+		GLsync fence = statsFences[region];
+		if (!fence)
+		{
+			return;
+		}
+		if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			stallCount++;
+			glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000); // 1s
+		}
+		glDeleteSync(fence);
+		statsFences[region] = 0;
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsBuffer);
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, region * statsRegionStride, sizeof(GpuCullStats), &stats);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	Shader& cullingShader;
+	Mesh& mesh;
+	unsigned int objectCount;
+	unsigned int objectBoundsBuffer;
+	unsigned int lodBuffer;
+	unsigned int commandBuffer;
+	unsigned int statsBuffer;
+	size_t statsRegionStride;
+	unsigned int statsRegionCount;
+	unsigned int currentStatsRegion;
+	unsigned int stallCount;
+	std::vector<GLsync> statsFences;
+	GpuCullStats stats;
+
+	Uniform<int> objectCountUniform;
+	Uniform<int> lodCountUniform;
+	Uniform<glm::vec3> cameraPositionUniform;
+	Uniform<float> meshRadiusUniform;
+	Uniform<float> lodProjectionScaleUniform;
+	Uniform<float> lodPixelErrorUniform;
+};
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <iostream>
+#include <cstring>
+
+#if defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+// OpenGL context without a window or display server, used for offscreen rendering on render nodes.
+// Backed by EGL, preferring Mesa's surfaceless platform so it also runs on CPU-only machines (llvmpipe).
+class HeadlessContext
+{
+public:
+#if defined(__linux__)
+	HeadlessContext() : display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT)
+	{
+	}
+
+	~HeadlessContext()
+	{
+		destroy();
+	}
+
+	// Create a core profile context of the requested version and make it current (no default framebuffer!)
+	bool create(int majorVersion, int minorVersion)
+	{
+		// The surfaceless platform needs neither a GPU nor a display, fall back to the default display otherwise
+		PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (eglGetPlatformDisplayEXT)
+		{
+			display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		}
+		if (display == EGL_NO_DISPLAY)
+		{
+			display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		}
+
+		EGLint eglMajor, eglMinor;
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, &eglMajor, &eglMinor))
+		{
+			std::cout << "ERROR::HEADLESS::EGL_INITIALIZE_FAILED" << std::endl;
+			return false;
+		}
+
+		// We never create an EGLSurface, everything is rendered into framebuffer objects
+		const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+		if (extensions == NULL || strstr(extensions, "EGL_KHR_surfaceless_context") == NULL)
+		{
+			std::cout << "ERROR::HEADLESS::EGL_KHR_surfaceless_context_NOT_SUPPORTED" << std::endl;
+			return false;
+		}
+
+		const EGLint configAttribs[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_RED_SIZE, 8,
+			EGL_GREEN_SIZE, 8,
+			EGL_BLUE_SIZE, 8,
+			EGL_DEPTH_SIZE, 24,
+			EGL_NONE
+		};
+		EGLConfig config;
+		EGLint numConfigs = 0;
+		if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0)
+		{
+			std::cout << "ERROR::HEADLESS::NO_MATCHING_EGL_CONFIG" << std::endl;
+			return false;
+		}
+
+		if (!eglBindAPI(EGL_OPENGL_API))
+		{
+			std::cout << "ERROR::HEADLESS::OPENGL_API_NOT_SUPPORTED" << std::endl;
+			return false;
+		}
+
+		// Same as the windowed path: explicitly use core profile
+		const EGLint contextAttribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION_KHR, majorVersion,
+			EGL_CONTEXT_MINOR_VERSION_KHR, minorVersion,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+			EGL_NONE
+		};
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+		if (context == EGL_NO_CONTEXT)
+		{
+			std::cout << "ERROR::HEADLESS::CONTEXT_CREATION_FAILED (OpenGL " << majorVersion << "." << minorVersion << " core)" << std::endl;
+			return false;
+		}
+
+		if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+		{
+			std::cout << "ERROR::HEADLESS::MAKE_CURRENT_FAILED" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	void destroy()
+	{
+		if (display != EGL_NO_DISPLAY)
+		{
+			eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			if (context != EGL_NO_CONTEXT)
+			{
+				eglDestroyContext(display, context);
+			}
+			eglTerminate(display);
+		}
+		display = EGL_NO_DISPLAY;
+		context = EGL_NO_CONTEXT;
+	}
+
+	// Loader function for GLAD
+	static void* getProcAddress(const char* name)
+	{
+		return (void*)eglGetProcAddress(name);
+	}
+
+private:
+	EGLDisplay display;
+	EGLContext context;
+#else
+	bool create(int majorVersion, int minorVersion)
+	{
+		std::cout << "ERROR::HEADLESS::NOT_SUPPORTED_ON_THIS_PLATFORM (requires EGL on Linux)" << std::endl;
+		return false;
+	}
+
+	void destroy()
+	{
+	}
+
+	static void* getProcAddress(const char* name)
+	{
+		return NULL;
+	}
+#endif
+};
+
+#endif
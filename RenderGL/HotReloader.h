@@ -0,0 +1,71 @@
+#ifndef HOT_RELOADER_H
+#define HOT_RELOADER_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "FileWatcher.h"
+#include "ShaderPermutationCache.h"
+#include "TextureManager.h"
+
+#define DEFAULT_HOT_RELOAD_BUDGET_MS 2.0f // Reload work per frame, beyond the (cheap) swaps
+
+// Reloads shaders and textures whose files change while the application runs. Files are watched on a background thread
+// (FileWatcher), textures are decoded on the loader's threads and shaders compile on the driver's threads where it has
+// KHR_parallel_shader_compile. update() runs at a frame boundary and only swaps in what's ready, plus a budgeted amount of
+// new work, so editing an asset doesn't stall rendering. A shader that doesn't compile is reported and the old program stays
+class HotReloader
+{
+public:
+	// Either cache may be null
+	HotReloader(ShaderPermutationCache* shaders_in, TextureManager* textures_in = nullptr, float budgetMilliseconds_in = DEFAULT_HOT_RELOAD_BUDGET_MS) :
+		shaders(shaders_in),
+		textures(textures_in),
+		budgetMilliseconds(budgetMilliseconds_in),
+		lastUpdateMilliseconds(0.0f)
+	{
+	}
+
+	// Watch the directories (with their subdirectories), paths relative to the working directory like the assets' own
+	bool start(const std::vector<std::string>& directories)
+	{
+		return watcher.start(directories);
+	}
+
+	// Call once per frame, before drawing. Returns how many assets were swapped in
+	unsigned int update()
+	{
+		auto start = std::chrono::steady_clock::now();
+		std::vector<std::string> changes = watcher.takeChanges();
+		if (shaders)
+		{
+			shaders->reloadChanged(changes);
+		}
+		if (textures)
+		{
+			for (const std::string& path : changes)
+			{
+				textures->reload(path); // Ignored unless it's a cached texture
+			}
+		}
+		unsigned int swapped = shaders ? shaders->updateReloads(budgetMilliseconds) : 0;
+		lastUpdateMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return swapped;
+	}
+
+	// Time the last update() took, to keep an eye on reload hitches
+	float getLastUpdateMilliseconds() const
+	{
+		return lastUpdateMilliseconds;
+	}
+
+private:
+	FileWatcher watcher;
+	ShaderPermutationCache* shaders;
+	TextureManager* textures;
+	float budgetMilliseconds;
+	float lastUpdateMilliseconds;
+};
+
+#endif
@@ -0,0 +1,349 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+// Parsed JSON document, just enough to read small metadata documents such as a glTF header
+struct JsonValue
+{
+	enum Type
+	{
+		JSON_NULL,
+		JSON_BOOL,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT
+	};
+
+	Type type = JSON_NULL;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> elements; // Array elements, or object member values
+	std::vector<std::string> keys;   // Object member names, in the same order as elements
+
+	// Object member, null if there is none (or this isn't an object)
+	const JsonValue* find(const char* key) const
+	{
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			if (keys[i] == key)
+			{
+				return &elements[i];
+			}
+		}
+		return nullptr;
+	}
+
+	// Array element, null if out of range (or this isn't an array)
+	const JsonValue* at(size_t index) const
+	{
+		return type == JSON_ARRAY && index < elements.size() ? &elements[index] : nullptr;
+	}
+
+	// Numeric member, fallback if it's missing or not a number
+	double getNumber(const char* key, double fallback) const
+	{
+		const JsonValue* member = find(key);
+		return member && member->type == JSON_NUMBER ? member->number : fallback;
+	}
+};
+
+// Recursive descent parser (RFC 8259). Doesn't validate UTF-8, \u escapes outside the BMP are kept as two separately encoded halves
+class JsonParser
+{
+public:
+	// False if the text isn't a single valid JSON value
+	static bool parse(const char* text, size_t size, JsonValue& value)
+	{
+		JsonParser parser(text, text + size);
+		if (!parser.parseValue(value, 0))
+		{
+			return false;
+		}
+		parser.skipWhitespace();
+		return parser.current == parser.end;
+	}
+
+private:
+	JsonParser(const char* begin, const char* end_in) :
+		current(begin),
+		end(end_in)
+	{
+	}
+
+	bool parseValue(JsonValue& value, int depth)
+	{
+		const int maxDepth = 64;
+		skipWhitespace();
+		if (current == end || depth > maxDepth)
+		{
+			return false;
+		}
+		switch (*current)
+		{
+		case '{':
+			return parseObject(value, depth);
+		case '[':
+			return parseArray(value, depth);
+		case '"':
+			value.type = JsonValue::JSON_STRING;
+			return parseString(value.string);
+		case 't':
+			value.type = JsonValue::JSON_BOOL;
+			value.boolean = true;
+			return parseLiteral("true");
+		case 'f':
+			value.type = JsonValue::JSON_BOOL;
+			return parseLiteral("false");
+		case 'n':
+			value.type = JsonValue::JSON_NULL;
+			return parseLiteral("null");
+		default:
+			return parseNumber(value);
+		}
+	}
+
+	bool parseObject(JsonValue& value, int depth)
+	{
+		value.type = JsonValue::JSON_OBJECT;
+		current++; // {
+		skipWhitespace();
+		if (current != end && *current == '}')
+		{
+			current++;
+			return true;
+		}
+		while (true)
+		{
+			skipWhitespace();
+			std::string key;
+			if (current == end || *current != '"' || !parseString(key))
+			{
+				return false;
+			}
+			skipWhitespace();
+			if (current == end || *current != ':')
+			{
+				return false;
+			}
+			current++;
+			value.keys.push_back(key);
+			value.elements.push_back(JsonValue());
+			if (!parseValue(value.elements.back(), depth + 1))
+			{
+				return false;
+			}
+			skipWhitespace();
+			if (current != end && *current == ',')
+			{
+				current++;
+				continue;
+			}
+			if (current != end && *current == '}')
+			{
+				current++;
+				return true;
+			}
+			return false;
+		}
+	}
+
+	bool parseArray(JsonValue& value, int depth)
+	{
+		value.type = JsonValue::JSON_ARRAY;
+		current++; // [
+		skipWhitespace();
+		if (current != end && *current == ']')
+		{
+			current++;
+			return true;
+		}
+		while (true)
+		{
+			value.elements.push_back(JsonValue());
+			if (!parseValue(value.elements.back(), depth + 1))
+			{
+				return false;
+			}
+			skipWhitespace();
+			if (current != end && *current == ',')
+			{
+				current++;
+				continue;
+			}
+			if (current != end && *current == ']')
+			{
+				current++;
+				return true;
+			}
+			return false;
+		}
+	}
+
+	bool parseString(std::string& string)
+	{
+		current++; // "
+		while (current != end)
+		{
+			char c = *current++;
+			if (c == '"')
+			{
+				return true;
+			}
+			if ((unsigned char)c < 0x20)
+			{
+				return false;
+			}
+			if (c != '\\')
+			{
+				string += c;
+				continue;
+			}
+			if (current == end)
+			{
+				return false;
+			}
+			switch (*current++)
+			{
+			case '"': string += '"'; break;
+			case '\\': string += '\\'; break;
+			case '/': string += '/'; break;
+			case 'b': string += '\b'; break;
+			case 'f': string += '\f'; break;
+			case 'n': string += '\n'; break;
+			case 'r': string += '\r'; break;
+			case 't': string += '\t'; break;
+			case 'u':
+			{
+				if (end - current < 4)
+				{
+					return false;
+				}
+				unsigned int codePoint = 0;
+				for (int i = 0; i < 4; i++)
+				{
+					char digit = *current++;
+					codePoint <<= 4;
+					if (digit >= '0' && digit <= '9') codePoint |= digit - '0';
+					else if (digit >= 'a' && digit <= 'f') codePoint |= digit - 'a' + 10;
+					else if (digit >= 'A' && digit <= 'F') codePoint |= digit - 'A' + 10;
+					else return false;
+				}
+				appendUtf8(string, codePoint);
+				break;
+			}
+			default:
+				return false;
+			}
+		}
+		return false;
+	}
+
+	bool parseNumber(JsonValue& value)
+	{
+		// Validate the grammar, strtod does the conversion (it would also accept hex, inf, leading '+'...)
+		const char* start = current;
+		if (current != end && *current == '-')
+		{
+			current++;
+		}
+		if (current == end || !isDigit(*current))
+		{
+			return false;
+		}
+		if (*current == '0')
+		{
+			current++;
+		}
+		else
+		{
+			skipDigits();
+		}
+		if (current != end && *current == '.')
+		{
+			current++;
+			if (current == end || !isDigit(*current))
+			{
+				return false;
+			}
+			skipDigits();
+		}
+		if (current != end && (*current == 'e' || *current == 'E'))
+		{
+			current++;
+			if (current != end && (*current == '+' || *current == '-'))
+			{
+				current++;
+			}
+			if (current == end || !isDigit(*current))
+			{
+				return false;
+			}
+			skipDigits();
+		}
+		value.type = JsonValue::JSON_NUMBER;
+		value.number = strtod(std::string(start, current).c_str(), nullptr);
+		return true;
+	}
+
+	bool parseLiteral(const char* literal)
+	{
+		size_t length = strlen(literal);
+		if ((size_t)(end - current) < length || strncmp(current, literal, length) != 0)
+		{
+			return false;
+		}
+		current += length;
+		return true;
+	}
+
+	void skipWhitespace()
+	{
+		while (current != end && (*current == ' ' || *current == '\t' || *current == '\n' || *current == '\r'))
+		{
+			current++;
+		}
+	}
+
+	void skipDigits()
+	{
+		while (current != end && isDigit(*current))
+		{
+			current++;
+		}
+	}
+
+	static bool isDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	static void appendUtf8(std::string& string, unsigned int codePoint)
+	{
+		if (codePoint < 0x80)
+		{
+			string += (char)codePoint;
+		}
+		else if (codePoint < 0x800)
+		{
+			string += (char)(0xC0 | (codePoint >> 6));
+			string += (char)(0x80 | (codePoint & 0x3F));
+		}
+		else
+		{
+			string += (char)(0xE0 | (codePoint >> 12));
+			string += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+			string += (char)(0x80 | (codePoint & 0x3F));
+		}
+	}
+
+	const char* current;
+	const char* end;
+};
+
+#endif
@@ -0,0 +1,589 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <unordered_map>
+
+#include "glm/glm.hpp"
+#include "MeshOptimizer.h"
+#include "VertexQuantization.h"
+#include "GLExtensions.h"
+
+struct Vertex
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+};
+
+enum PositionFormat
+{
+	POSITION_FLOAT32, // 3 x 32-bit float
+	POSITION_HALF,    // 3 x 16-bit float (+ 2 bytes padding)
+	POSITION_UNORM16  // 3 x 16-bit normalized within the mesh's bounding box (+ 2 bytes padding)
+};
+
+enum NormalFormat
+{
+	NORMAL_FLOAT32,        // 3 x 32-bit float
+	NORMAL_INT_2_10_10_10, // GL_INT_2_10_10_10_REV, 10 bits per component
+	NORMAL_OCTAHEDRAL      // 2 x 16-bit normalized, octahedral encoding
+};
+
+// How a Mesh stores its vertices on the GPU
+struct VertexFormat
+{
+	PositionFormat positionFormat = POSITION_FLOAT32;
+	NormalFormat normalFormat = NORMAL_FLOAT32;
+
+	size_t getPositionSize() const
+	{
+		return positionFormat == POSITION_FLOAT32 ? 3 * sizeof(float) : 4 * sizeof(unsigned short);
+	}
+	size_t getNormalSize() const
+	{
+		return normalFormat == NORMAL_FLOAT32 ? 3 * sizeof(float) : sizeof(unsigned int);
+	}
+	size_t getVertexSize() const
+	{
+		return getPositionSize() + getNormalSize();
+	}
+};
+
+// Before/after numbers of MeshData::optimize()
+struct MeshOptimizationReport
+{
+	size_t unindexedVertexCount = 0; // Vertices processed when drawn without an index buffer
+	size_t vertexCount = 0;
+	size_t triangleCount = 0;
+	float acmrBefore = 0.0f; // Average cache miss ratio, see computeACMR()
+	float acmrAfter = 0.0f;
+};
+
+// A level of detail: a range of the index buffer, drawing the same vertices with fewer triangles
+struct MeshLod
+{
+	unsigned int indexOffset = 0;
+	unsigned int indexCount = 0;
+	float error = 0.0f; // How far this level may deviate from the full detail one, in mesh units (see simplifyMesh())
+	unsigned int meshletOffset = 0; // Clusters of this level in the mesh's meshlets, none until buildMeshlets()
+	unsigned int meshletCount = 0;
+};
+
+// A cluster of nearby triangles (a range of the index buffer) with the bounds to cull it as a whole, see Meshlets.h
+struct Meshlet
+{
+	unsigned int indexOffset = 0;
+	unsigned int indexCount = 0;
+	glm::vec4 boundingSphere = glm::vec4(0.0f); // Mesh space, xyz = center, w = radius
+	glm::vec3 coneAxis = glm::vec3(0.0f);       // Average facing of the triangles
+	float coneCutoff = 1.0f; // Sine of the normal cone's half angle, 1 -> too wide to ever face away as a whole
+};
+
+// CPU side indexed triangle mesh
+struct MeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	std::vector<MeshLod> lods; // Levels in indices, finest first. Empty -> all of indices is the only level (see generateLods())
+	std::vector<Meshlet> meshlets; // Clusters of all levels, see buildMeshlets(). Reordering the triangles (optimize()) invalidates them
+
+	// Build an indexed mesh from a non-indexed triangle list of interleaved position + normal floats, merging identical vertices
+	static MeshData fromTriangleList(const float* data, size_t vertexCount, size_t floatsPerVertex = 6)
+	{
+		MeshData mesh;
+		mesh.indices.reserve(vertexCount);
+
+		// Bitwise identical vertices are the same vertex
+		std::unordered_map<std::string, unsigned int> uniqueVertices;
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			Vertex vertex;
+			vertex.position = glm::vec3(data[i * floatsPerVertex + 0], data[i * floatsPerVertex + 1], data[i * floatsPerVertex + 2]);
+			vertex.normal = glm::vec3(data[i * floatsPerVertex + 3], data[i * floatsPerVertex + 4], data[i * floatsPerVertex + 5]);
+
+			std::string key((const char*)&vertex, sizeof(Vertex));
+			std::unordered_map<std::string, unsigned int>::iterator found = uniqueVertices.find(key);
+			if (found == uniqueVertices.end())
+			{
+				found = uniqueVertices.insert(std::make_pair(key, (unsigned int)mesh.vertices.size())).first;
+				mesh.vertices.push_back(vertex);
+			}
+			mesh.indices.push_back(found->second);
+		}
+		return mesh;
+	}
+
+	// Reorder triangles for the vertex cache and less overdraw (within each level of detail), then vertices for fetch locality
+	MeshOptimizationReport optimize()
+	{
+		std::vector<MeshLod> levels = lods;
+		if (levels.empty())
+		{
+			levels.resize(1);
+			levels[0].indexCount = (unsigned int)indices.size();
+		}
+		MeshOptimizationReport report;
+		report.unindexedVertexCount = levels[0].indexCount;
+		report.vertexCount = vertices.size();
+		report.triangleCount = levels[0].indexCount / 3;
+		report.acmrBefore = computeACMR(indices, vertices.size());
+
+		std::vector<glm::vec3> positions(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			positions[i] = vertices[i].position;
+		}
+		for (const MeshLod& lod : levels)
+		{
+			std::vector<unsigned int> levelIndices(indices.begin() + lod.indexOffset, indices.begin() + lod.indexOffset + lod.indexCount);
+			levelIndices = optimizeVertexCache(levelIndices, vertices.size());
+			levelIndices = optimizeOverdraw(levelIndices, positions);
+			std::copy(levelIndices.begin(), levelIndices.end(), indices.begin() + lod.indexOffset);
+		}
+
+		size_t usedVertexCount = 0;
+		std::vector<unsigned int> remap = optimizeVertexFetch(indices, vertices.size(), usedVertexCount);
+		std::vector<Vertex> reordered(usedVertexCount);
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			if (remap[i] != ~0u)
+			{
+				reordered[remap[i]] = vertices[i];
+			}
+		}
+		vertices.swap(reordered);
+
+		report.vertexCount = vertices.size();
+		report.acmrAfter = computeACMR(indices, vertices.size());
+		return report;
+	}
+
+	// Sphere around the bounding box (xyz = center, w = radius), not minimal but cheap and good enough for culling
+	glm::vec4 computeBoundingSphere() const
+	{
+		glm::vec3 boundsMin(0.0f);
+		glm::vec3 boundsMax(0.0f);
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			boundsMin = i == 0 ? vertices[i].position : glm::min(boundsMin, vertices[i].position);
+			boundsMax = i == 0 ? vertices[i].position : glm::max(boundsMax, vertices[i].position);
+		}
+		glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		float radius = 0.0f;
+		for (const Vertex& vertex : vertices)
+		{
+			radius = std::max(radius, glm::length(vertex.position - center));
+		}
+		return glm::vec4(center, radius);
+	}
+};
+
+inline void printMeshOptimizationReport(const char* name, const MeshOptimizationReport& report)
+{
+	std::cout << "Mesh " << name << ": " << report.triangleCount << " triangles, " << report.unindexedVertexCount << " -> " << report.vertexCount
+		<< " vertices, ACMR " << report.acmrBefore << " -> " << report.acmrAfter << std::endl;
+}
+
+// Dequantization (position = stored * scale + offset) of positions in the given format within the given bounds.
+// Normalized positions are relative to the bounding box
+inline void getPositionDequantization(const VertexFormat& format, const glm::vec3& boundsMin, const glm::vec3& boundsMax, glm::vec3& scale, glm::vec3& offset)
+{
+	scale = glm::vec3(1.0f);
+	offset = glm::vec3(0.0f);
+	if (format.positionFormat == POSITION_UNORM16)
+	{
+		offset = boundsMin;
+		scale = glm::max(boundsMax - boundsMin, glm::vec3(1e-20f));
+	}
+}
+
+// Write a vertex in the given format (format.getVertexSize() bytes), positions quantized for the given dequantization
+inline void packVertex(const Vertex& source, const VertexFormat& format, const glm::vec3& positionScale, const glm::vec3& positionOffset, unsigned char* vertex)
+{
+	const glm::vec3& position = source.position;
+	if (format.positionFormat == POSITION_FLOAT32)
+	{
+		memcpy(vertex, &position, 3 * sizeof(float));
+	}
+	else
+	{
+		unsigned short components[4] = { 0, 0, 0, 0 };
+		for (int c = 0; c < 3; c++)
+		{
+			components[c] = format.positionFormat == POSITION_HALF ? floatToHalf(position[c]) : quantizeUnorm16((position[c] - positionOffset[c]) / positionScale[c]);
+		}
+		memcpy(vertex, components, sizeof(components));
+	}
+
+	unsigned char* normal = vertex + format.getPositionSize();
+	if (format.normalFormat == NORMAL_FLOAT32)
+	{
+		memcpy(normal, &source.normal, 3 * sizeof(float));
+	}
+	else if (format.normalFormat == NORMAL_INT_2_10_10_10)
+	{
+		unsigned int packedNormal = packSnorm2_10_10_10(source.normal);
+		memcpy(normal, &packedNormal, sizeof(packedNormal));
+	}
+	else
+	{
+		glm::vec2 octahedral = encodeOctahedral(source.normal);
+		short components[2] = { quantizeSnorm16(octahedral.x), quantizeSnorm16(octahedral.y) };
+		memcpy(normal, components, sizeof(components));
+	}
+}
+
+// Screen space error allowed when picking a level of detail, in pixels
+#define DEFAULT_LOD_PIXEL_ERROR 1.0f
+
+// Pixels covered by one world unit at distance 1 from the camera, for a vertical field of view (degrees) and a viewport height in pixels.
+// Something of size s at distance d covers s * scale / d pixels
+inline float getLodProjectionScale(float fovDegrees, float viewportHeight)
+{
+	return viewportHeight / (2.0f * tanf(glm::radians(fovDegrees) * 0.5f));
+}
+
+// Indexed mesh on the GPU, with vertices in the given (possibly quantized) format. Indices are stored as 16-bit when the vertex count allows it.
+// Shaders reconstruct positions as aPos * positionScale + positionOffset and decode octahedral normals, see setDecodeUniforms() in main.cpp
+class Mesh
+{
+public:
+	Mesh(const MeshData& data, VertexFormat format_in = VertexFormat()) :
+		VBO(0),
+		EBO(0),
+		indexCount((unsigned int)data.indices.size()),
+		indexType(GL_UNSIGNED_INT),
+		format(format_in),
+		vertexCount(data.vertices.size()),
+		positionScale(1.0f),
+		positionOffset(0.0f)
+	{
+		std::vector<unsigned char> packedVertices = packVertices(data.vertices);
+		glGenBuffers(1, &VBO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, packedVertices.size(), packedVertices.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glGenBuffers(1, &EBO);
+		if (data.vertices.size() <= 0xFFFF)
+		{
+			std::vector<unsigned short> shortIndices(data.indices.begin(), data.indices.end());
+			indexType = GL_UNSIGNED_SHORT;
+			uploadIndices(shortIndices.data(), shortIndices.size() * sizeof(unsigned short));
+		}
+		else
+		{
+			uploadIndices(data.indices.data(), data.indices.size() * sizeof(unsigned int));
+		}
+		setLods(data.lods);
+		meshlets = data.meshlets;
+	}
+	// Buffers sized for the counts but not filled, write them through mapBuffers() (e.g. from importer threads, a mapped buffer is plain
+	// memory) to skip the MeshData and packed copies. UNORM16 positions are relative to the bounds, so they have to be known up front
+	Mesh(size_t vertexCount_in, size_t indexCount_in, const glm::vec3& boundsMin, const glm::vec3& boundsMax, VertexFormat format_in = VertexFormat()) :
+		VBO(0),
+		EBO(0),
+		indexCount((unsigned int)indexCount_in),
+		indexType(vertexCount_in <= 0xFFFF ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT),
+		format(format_in),
+		vertexCount(vertexCount_in),
+		positionScale(1.0f),
+		positionOffset(0.0f)
+	{
+		setBounds(boundsMin, boundsMax);
+		glGenBuffers(1, &VBO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, getVertexBufferSize(), NULL, GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glGenBuffers(1, &EBO);
+		uploadIndices(NULL, getIndexBufferSize());
+		setLods(std::vector<MeshLod>());
+	}
+	~Mesh()
+	{
+		glDeleteVertexArrays((GLsizei)vertexArrays.size(), vertexArrays.data());
+		glDeleteBuffers(1, &VBO);
+		glDeleteBuffers(1, &EBO);
+	}
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
+	// Create a VAO reading this mesh: positions at location 0, normals at location 1 if requested, plus the index buffer.
+	// Leaves it bound, so per-instance attributes can be added. The mesh owns it
+	unsigned int createVertexArray(bool withNormals = true)
+	{
+		unsigned int VAO;
+		glGenVertexArrays(1, &VAO);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		GLsizei stride = (GLsizei)format.getVertexSize();
+		switch (format.positionFormat)
+		{
+		case POSITION_FLOAT32:
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+			break;
+		case POSITION_HALF:
+			glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, stride, (void*)0);
+			break;
+		case POSITION_UNORM16:
+			glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)0);
+			break;
+		}
+		glEnableVertexAttribArray(0);
+		if (withNormals)
+		{
+			void* normalOffset = (void*)format.getPositionSize();
+			switch (format.normalFormat)
+			{
+			case NORMAL_FLOAT32:
+				glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, normalOffset);
+				break;
+			case NORMAL_INT_2_10_10_10:
+				glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, normalOffset);
+				break;
+			case NORMAL_OCTAHEDRAL:
+				glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, normalOffset);
+				break;
+			}
+			glEnableVertexAttribArray(1);
+		}
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO); // Part of the VAO's state
+		vertexArrays.push_back(VAO);
+		return VAO;
+	}
+
+	// Draw a level of detail with one of this mesh's VAOs bound
+	void draw(unsigned int lod = 0)
+	{
+		glDrawElements(GL_TRIANGLES, lods[lod].indexCount, indexType, getIndexPointer(lod));
+	}
+	void drawInstanced(unsigned int instanceCount, unsigned int lod = 0)
+	{
+		glDrawElementsInstanced(GL_TRIANGLES, lods[lod].indexCount, indexType, getIndexPointer(lod), instanceCount);
+	}
+	// Draw several index ranges (e.g. the meshlets that survived culling) in one call
+	void drawRanges(const std::vector<GLsizei>& counts, const std::vector<unsigned int>& firstIndices)
+	{
+		rangePointers.resize(firstIndices.size());
+		for (size_t i = 0; i < firstIndices.size(); i++)
+		{
+			rangePointers[i] = (const void*)(firstIndices[i] * getIndexSize());
+		}
+		glMultiDrawElements(GL_TRIANGLES, counts.data(), indexType, rangePointers.data(), (GLsizei)counts.size());
+	}
+	// Draw with drawCount tightly packed DrawElementsIndirectCommands from the bound GL_DRAW_INDIRECT_BUFFER, written by the GPU
+	// (see GpuDrivenRenderer.h). Needs GLExtensions::gpuDrivenDrawing
+	void drawIndirect(GLsizei drawCount)
+	{
+		getGLExtensions().multiDrawElementsIndirect(GL_TRIANGLES, indexType, nullptr, drawCount, 0);
+	}
+
+	// Indices of all levels of detail together
+	unsigned int getIndexCount()
+	{
+		return indexCount;
+	}
+
+	// Levels of detail within the index buffer, finest first. Without any the whole index buffer is the only level
+	void setLods(const std::vector<MeshLod>& lods_in)
+	{
+		lods = lods_in;
+		if (lods.empty())
+		{
+			lods.resize(1);
+			lods[0].indexCount = indexCount;
+		}
+	}
+	unsigned int getLodCount() const
+	{
+		return (unsigned int)lods.size();
+	}
+	const MeshLod& getLod(unsigned int lod) const
+	{
+		return lods[lod];
+	}
+	// Empty unless the mesh was made from MeshData with meshlets
+	const std::vector<Meshlet>& getMeshlets() const
+	{
+		return meshlets;
+	}
+
+	// Coarsest level of detail whose error stays within maxPixelError pixels on screen, for an instance scaled by objectScale whose closest
+	// point is distance away from the camera. projectionScale comes from getLodProjectionScale()
+	unsigned int selectLod(float distance, float objectScale, float projectionScale, float maxPixelError) const
+	{
+		float pixelsPerUnit = objectScale * projectionScale / std::max(distance, 1e-6f);
+		for (unsigned int lod = (unsigned int)lods.size() - 1; lod > 0; lod--)
+		{
+			if (lods[lod].error * pixelsPerUnit <= maxPixelError)
+			{
+				return lod;
+			}
+		}
+		return 0;
+	}
+
+	// Position dequantization: position = stored * scale + offset
+	glm::vec3 getPositionScale()
+	{
+		return positionScale;
+	}
+	glm::vec3 getPositionOffset()
+	{
+		return positionOffset;
+	}
+	bool hasOctahedralNormals()
+	{
+		return format.normalFormat == NORMAL_OCTAHEDRAL;
+	}
+
+	size_t getVertexBufferSize()
+	{
+		return vertexCount * format.getVertexSize();
+	}
+	size_t getIndexBufferSize()
+	{
+		return indexCount * getIndexSize();
+	}
+	size_t getVertexCount()
+	{
+		return vertexCount;
+	}
+	bool hasShortIndices()
+	{
+		return indexType == GL_UNSIGNED_SHORT;
+	}
+
+	// Map both buffers for writing, with their previous contents discarded. Indices are unsigned short or unsigned int, see hasShortIndices().
+	// Any thread may write the memory, but only the thread with the context may map and unmap. False (nothing mapped) on failure
+	bool mapBuffers(unsigned char*& vertices, void*& indices)
+	{
+		vertices = (unsigned char*)mapBuffer(VBO, getVertexBufferSize());
+		indices = mapBuffer(EBO, getIndexBufferSize());
+		if (!vertices || !indices)
+		{
+			unmapBuffers();
+			std::cout << "ERROR::MESH::MAP_FAILED" << std::endl;
+			return false;
+		}
+		return true;
+	}
+	// False if the contents were lost while mapped (the driver may drop them, e.g. on a mode switch), they have to be written again
+	bool unmapBuffers()
+	{
+		bool intact = true;
+		for (unsigned int buffer : { VBO, EBO })
+		{
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+			GLint mapped = GL_FALSE;
+			glGetBufferParameteriv(GL_COPY_WRITE_BUFFER, GL_BUFFER_MAPPED, &mapped);
+			if (mapped && glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_FALSE)
+			{
+				intact = false;
+			}
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		return intact;
+	}
+
+	// Write a vertex in this mesh's format (format.getVertexSize() bytes)
+	void packVertex(const Vertex& source, unsigned char* vertex) const
+	{
+		::packVertex(source, format, positionScale, positionOffset, vertex);
+	}
+
+	// Scale, then translate the mesh in addition to its dequantization, without touching the vertices (shaders apply it)
+	void transformPositions(float scale, const glm::vec3& translation)
+	{
+		positionScale *= scale;
+		positionOffset = positionOffset * scale + translation;
+		for (MeshLod& lod : lods)
+		{
+			lod.error *= scale;
+		}
+		for (Meshlet& meshlet : meshlets)
+		{
+			meshlet.boundingSphere = glm::vec4(glm::vec3(meshlet.boundingSphere) * scale + translation, meshlet.boundingSphere.w * scale);
+		}
+	}
+
+private:
+	std::vector<unsigned char> packVertices(const std::vector<Vertex>& vertices)
+	{
+		glm::vec3 boundsMin(0.0f);
+		glm::vec3 boundsMax(0.0f);
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			boundsMin = i == 0 ? vertices[i].position : glm::min(boundsMin, vertices[i].position);
+			boundsMax = i == 0 ? vertices[i].position : glm::max(boundsMax, vertices[i].position);
+		}
+		setBounds(boundsMin, boundsMax);
+
+		size_t stride = format.getVertexSize();
+		std::vector<unsigned char> packed(vertices.size() * stride, 0);
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			packVertex(vertices[i], &packed[i * stride]);
+		}
+		return packed;
+	}
+
+	void setBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		getPositionDequantization(format, boundsMin, boundsMax, positionScale, positionOffset);
+	}
+
+	void* getIndexPointer(unsigned int lod)
+	{
+		return (void*)(lods[lod].indexOffset * getIndexSize());
+	}
+
+	size_t getIndexSize() const
+	{
+		return indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+	}
+
+	void* mapBuffer(unsigned int buffer, size_t size)
+	{
+		if (size == 0)
+		{
+			return NULL;
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		void* memory = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, (GLsizeiptr)size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		return memory;
+	}
+
+	void uploadIndices(const void* data, size_t size)
+	{
+		// Filled through the array buffer target, since the element buffer binding is part of whichever VAO is bound
+		glBindBuffer(GL_ARRAY_BUFFER, EBO);
+		glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	unsigned int VBO;
+	unsigned int EBO;
+	unsigned int indexCount;
+	GLenum indexType;
+	std::vector<MeshLod> lods;
+	std::vector<Meshlet> meshlets;
+	std::vector<const void*> rangePointers;
+	std::vector<unsigned int> vertexArrays;
+
+	VertexFormat format;
+	size_t vertexCount;
+	glm::vec3 positionScale;
+	glm::vec3 positionOffset;
+};
+
+#endif
@@ -0,0 +1,570 @@
+#ifndef MESH_CODEC_H
+#define MESH_CODEC_H
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESH_CODEC_SSE 1
+#include <emmintrin.h>
+#endif
+
+// Lossless compression of index and vertex buffers, in the style of meshoptimizer's codecs (Kapoulkine, "Efficient compression of
+// vertex and index data"): delta coding against what the decoder has already seen plus byte aligned variable length codes instead of
+// an entropy coder, so decoding is a single pass of a few GB/s on one core. A general purpose compressor can still go on top.
+//
+// Indices: one code byte per triangle. Triangles of a cache optimized mesh mostly share an edge with one of the last few triangles
+// (15 entry edge FIFO) and bring at most one vertex that's either the next unused one (vertex fetch optimized order) or one of the
+// last 16 (vertex FIFO). Anything else is a zigzag varint delta from the last such vertex. Triangles may come out rotated (same winding).
+//
+// Vertices: split into byte lanes (byte k of every vertex), each lane is delta coded against the previous vertex and the zigzagged
+// deltas are bit packed in groups of 16 with 0, 2, 4 or 8 bits each. Neighbouring vertices of an optimized mesh are close in space,
+// so the high bytes of their quantized coordinates rarely change. Decoding is SIMD (SSE2) with a scalar fallback.
+// Vertices are processed in blocks, each of them decoded into a stack buffer and copied out in one piece, which suits write
+// combined (mapped GPU buffer) memory
+
+#define MESH_INDEX_CODEC_HEADER 0xD0u  // High nibble identifies the stream, low nibble is the version
+#define MESH_VERTEX_CODEC_HEADER 0xB0u
+#define MESH_INDEX_CODEC_PADDING 16     // Zero bytes after an index stream, so the decoder checks its bounds once per triangle
+#define MESH_VERTEX_CODEC_BLOCK_SIZE 256
+#define MESH_VERTEX_CODEC_MAX_VERTEX_SIZE 64 // Bytes, must also be a multiple of 4
+
+// FIFOs of recently seen edges and vertices, updated the same way by the encoder and the decoder
+struct IndexCodecState
+{
+	unsigned int edges[16][2];
+	unsigned int vertices[16];
+	unsigned int edgeOffset = 0;
+	unsigned int vertexOffset = 0;
+	unsigned int next = 0; // Lowest vertex no triangle has used yet (if they use vertices in order)
+	unsigned int last = 0; // Last explicitly coded vertex
+
+	IndexCodecState()
+	{
+		memset(edges, 0xFF, sizeof(edges)); // Never matches, and out of range for a corrupt stream referencing it
+		memset(vertices, 0xFF, sizeof(vertices));
+	}
+
+	void pushEdge(unsigned int a, unsigned int b)
+	{
+		edges[edgeOffset & 15][0] = a;
+		edges[edgeOffset & 15][1] = b;
+		edgeOffset++;
+	}
+	void pushVertex(unsigned int vertex)
+	{
+		vertices[vertexOffset & 15] = vertex;
+		vertexOffset++;
+	}
+
+	// Age of an edge in the FIFO (0 = newest), -1 if it's not in there. Only 15 entries are addressable
+	int findEdge(unsigned int a, unsigned int b) const
+	{
+		for (unsigned int i = 0; i < 15; i++)
+		{
+			const unsigned int* edge = edges[(edgeOffset - 1 - i) & 15];
+			if (edge[0] == a && edge[1] == b)
+			{
+				return (int)i;
+			}
+		}
+		return -1;
+	}
+	// Same for vertices, 14 entries are addressable (codes 1-14)
+	int findVertex(unsigned int vertex) const
+	{
+		for (unsigned int i = 0; i < 14; i++)
+		{
+			if (vertices[(vertexOffset - 1 - i) & 15] == vertex)
+			{
+				return (int)i;
+			}
+		}
+		return -1;
+	}
+};
+
+inline unsigned int zigzagEncode(int value)
+{
+	return ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+}
+inline int zigzagDecode(unsigned int value)
+{
+	return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+inline void writeVarint(std::vector<unsigned char>& out, unsigned int value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((unsigned char)value);
+}
+// At most 5 bytes, the caller makes sure they are there
+inline unsigned int readVarint(const unsigned char*& data)
+{
+	unsigned int value = 0;
+	for (unsigned int shift = 0; shift < 35; shift += 7)
+	{
+		unsigned char byte = *data++;
+		value |= (unsigned int)(byte & 0x7F) << shift;
+		if (byte < 0x80)
+		{
+			break;
+		}
+	}
+	return value;
+}
+
+// 4 bit code of a vertex: 0 = the next unused vertex, 1-14 = vertex FIFO entry, 15 = explicit delta (appended to explicit)
+inline unsigned int encodeIndexCodecVertex(unsigned int vertex, IndexCodecState& state, std::vector<unsigned char>& explicitDeltas)
+{
+	if (vertex == state.next)
+	{
+		state.next++;
+		state.pushVertex(vertex);
+		return 0;
+	}
+	int age = state.findVertex(vertex);
+	if (age >= 0)
+	{
+		return (unsigned int)age + 1;
+	}
+	writeVarint(explicitDeltas, zigzagEncode((int)(vertex - state.last)));
+	state.last = vertex;
+	state.pushVertex(vertex);
+	return 15;
+}
+
+inline unsigned int decodeIndexCodecVertex(unsigned int code, IndexCodecState& state, const unsigned char*& data)
+{
+	if (code < 15)
+	{
+		// Without branches, which would be unpredictable: the slot written to is the oldest entry, no code can address that
+		unsigned int isNext = code == 0;
+		unsigned int vertex = isNext ? state.next : state.vertices[(state.vertexOffset - code) & 15];
+		state.next += isNext;
+		state.vertices[state.vertexOffset & 15] = vertex;
+		state.vertexOffset += isNext;
+		return vertex;
+	}
+	unsigned int vertex = state.last + (unsigned int)zigzagDecode(readVarint(data));
+	state.last = vertex;
+	state.pushVertex(vertex);
+	return vertex;
+}
+
+// Triangle list -> stream: header byte, a code byte per triangle, then the extra bytes of the triangles that need them, then padding
+inline void encodeIndexBuffer(const unsigned int* indices, size_t indexCount, std::vector<unsigned char>& encoded)
+{
+	size_t triangleCount = indexCount / 3;
+	encoded.assign(1 + triangleCount, 0);
+	encoded[0] = (unsigned char)MESH_INDEX_CODEC_HEADER;
+	IndexCodecState state;
+	std::vector<unsigned char> explicitDeltas;
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		unsigned int a = indices[triangle * 3 + 0];
+		unsigned int b = indices[triangle * 3 + 1];
+		unsigned int c = indices[triangle * 3 + 2];
+
+		// Rotate the triangle so a shared edge comes first
+		int edge = state.findEdge(a, b);
+		if (edge < 0 && (edge = state.findEdge(b, c)) >= 0)
+		{
+			unsigned int first = a;
+			a = b;
+			b = c;
+			c = first;
+		}
+		else if (edge < 0 && (edge = state.findEdge(c, a)) >= 0)
+		{
+			unsigned int first = c;
+			c = b;
+			b = a;
+			a = first;
+		}
+
+		explicitDeltas.clear();
+		if (edge >= 0)
+		{
+			unsigned int codeC = encodeIndexCodecVertex(c, state, explicitDeltas);
+			encoded[1 + triangle] = (unsigned char)((edge << 4) | codeC);
+			state.pushEdge(c, b);
+			state.pushEdge(a, c);
+		}
+		else
+		{
+			unsigned int codeA = encodeIndexCodecVertex(a, state, explicitDeltas);
+			unsigned int codeB = encodeIndexCodecVertex(b, state, explicitDeltas);
+			unsigned int codeC = encodeIndexCodecVertex(c, state, explicitDeltas);
+			encoded[1 + triangle] = (unsigned char)(0xF0 | codeA);
+			encoded.push_back((unsigned char)((codeB << 4) | codeC));
+			state.pushEdge(b, a);
+			state.pushEdge(c, b);
+			state.pushEdge(a, c);
+		}
+		encoded.insert(encoded.end(), explicitDeltas.begin(), explicitDeltas.end());
+	}
+	encoded.resize(encoded.size() + MESH_INDEX_CODEC_PADDING, 0);
+}
+
+// False if the stream is corrupt or references a vertex >= vertexCount (destination may be partially written then)
+template <typename Index>
+inline bool decodeIndexBuffer(Index* destination, size_t indexCount, size_t vertexCount, const unsigned char* data, size_t size)
+{
+	size_t triangleCount = indexCount / 3;
+	if (indexCount % 3 != 0 || size < 1 + triangleCount + MESH_INDEX_CODEC_PADDING || data[0] != MESH_INDEX_CODEC_HEADER)
+	{
+		return false;
+	}
+	const unsigned char* codes = data + 1;
+	const unsigned char* extra = codes + triangleCount;
+	const unsigned char* extraEnd = data + size - MESH_INDEX_CODEC_PADDING; // A triangle reads at most 16 extra bytes
+	IndexCodecState state;
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		if (extra > extraEnd)
+		{
+			return false;
+		}
+		unsigned int code = codes[triangle];
+		unsigned int a, b, c;
+		if (code < 0xF0)
+		{
+			const unsigned int* edge = state.edges[(state.edgeOffset - 1 - (code >> 4)) & 15];
+			a = edge[0];
+			b = edge[1];
+			c = decodeIndexCodecVertex(code & 15, state, extra);
+			state.pushEdge(c, b);
+			state.pushEdge(a, c);
+		}
+		else
+		{
+			unsigned int codes2 = *extra++;
+			a = decodeIndexCodecVertex(code & 15, state, extra);
+			b = decodeIndexCodecVertex(codes2 >> 4, state, extra);
+			c = decodeIndexCodecVertex(codes2 & 15, state, extra);
+			state.pushEdge(b, a);
+			state.pushEdge(c, b);
+			state.pushEdge(a, c);
+		}
+		if (a >= vertexCount || b >= vertexCount || c >= vertexCount)
+		{
+			return false;
+		}
+		destination[triangle * 3 + 0] = (Index)a;
+		destination[triangle * 3 + 1] = (Index)b;
+		destination[triangle * 3 + 2] = (Index)c;
+	}
+	return extra <= extraEnd;
+}
+
+inline unsigned char zigzagEncodeByte(unsigned char delta)
+{
+	return (unsigned char)((delta << 1) ^ (unsigned char)((signed char)delta >> 7));
+}
+
+// Vertices -> stream: header byte, the first vertex as is, then per block of up to MESH_VERTEX_CODEC_BLOCK_SIZE vertices and per byte
+// lane the 2 bit sizes of its groups (4 per byte) followed by their packed deltas. The first vertex is its own predecessor
+inline void encodeVertexBuffer(const unsigned char* vertices, size_t vertexCount, size_t vertexSize, std::vector<unsigned char>& encoded)
+{
+	encoded.assign(1, (unsigned char)MESH_VERTEX_CODEC_HEADER);
+	if (vertexCount == 0)
+	{
+		return;
+	}
+	encoded.insert(encoded.end(), vertices, vertices + vertexSize);
+	unsigned char deltas[MESH_VERTEX_CODEC_BLOCK_SIZE];
+	for (size_t blockStart = 0; blockStart < vertexCount; blockStart += MESH_VERTEX_CODEC_BLOCK_SIZE)
+	{
+		size_t count = std::min<size_t>(MESH_VERTEX_CODEC_BLOCK_SIZE, vertexCount - blockStart);
+		size_t groupCount = (count + 15) / 16;
+		for (size_t k = 0; k < vertexSize; k++)
+		{
+			const unsigned char* previous = &vertices[(blockStart == 0 ? 0 : blockStart - 1) * vertexSize + k];
+			memset(deltas, 0, sizeof(deltas)); // The last group is padded with zero deltas
+			for (size_t i = 0; i < count; i++)
+			{
+				const unsigned char* current = &vertices[(blockStart + i) * vertexSize + k];
+				deltas[i] = zigzagEncodeByte((unsigned char)(*current - *previous));
+				previous = current;
+			}
+
+			size_t header = encoded.size();
+			encoded.resize(header + (groupCount + 3) / 4, 0);
+			for (size_t group = 0; group < groupCount; group++)
+			{
+				const unsigned char* values = &deltas[group * 16];
+				unsigned char maxValue = *std::max_element(values, values + 16);
+				unsigned int bits = maxValue == 0 ? 0 : maxValue < 4 ? 1 : maxValue < 16 ? 2 : 3;
+				encoded[header + group / 4] |= (unsigned char)(bits << ((group % 4) * 2));
+				if (bits == 1)
+				{
+					unsigned char packed[4] = { 0, 0, 0, 0 };
+					for (int i = 0; i < 16; i++)
+					{
+						packed[i / 4] |= (unsigned char)(values[i] << ((i % 4) * 2));
+					}
+					encoded.insert(encoded.end(), packed, packed + 4);
+				}
+				else if (bits == 2)
+				{
+					unsigned char packed[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+					for (int i = 0; i < 16; i++)
+					{
+						packed[i / 2] |= (unsigned char)(values[i] << ((i % 2) * 4));
+					}
+					encoded.insert(encoded.end(), packed, packed + 8);
+				}
+				else if (bits == 3)
+				{
+					encoded.insert(encoded.end(), values, values + 16);
+				}
+			}
+		}
+	}
+}
+
+#if defined(MESH_CODEC_SSE)
+// Decode a group of 16 deltas of a lane, continuing from the lane's previous value. Returns the last value. Both are broadcast to
+// all 16 bytes, so the dependency from group to group never leaves the SIMD registers
+inline __m128i decodeVertexGroup(unsigned int bits, const unsigned char*& data, unsigned char* values, __m128i previous)
+{
+	// Each lane mostly keeps its width from group to group (noisy low bytes 8 bits, high bytes 0 or 2), so the switch predicts well
+	__m128i zigzag;
+	switch (bits)
+	{
+	case 0:
+		_mm_store_si128((__m128i*)values, previous);
+		return previous;
+	case 1:
+	{
+		int packed;
+		memcpy(&packed, data, sizeof(packed));
+		data += 4;
+		// Values 4i..4i+3 are the 2 bit fields of byte i, split the fields into 4 vectors and interleave them back into order
+		__m128i source = _mm_cvtsi32_si128(packed);
+		__m128i mask = _mm_set1_epi8(3);
+		__m128i field0 = _mm_and_si128(source, mask);
+		__m128i field1 = _mm_and_si128(_mm_srli_epi16(source, 2), mask);
+		__m128i field2 = _mm_and_si128(_mm_srli_epi16(source, 4), mask);
+		__m128i field3 = _mm_and_si128(_mm_srli_epi16(source, 6), mask);
+		zigzag = _mm_unpacklo_epi16(_mm_unpacklo_epi8(field0, field1), _mm_unpacklo_epi8(field2, field3));
+		break;
+	}
+	case 2:
+	{
+		__m128i source = _mm_loadl_epi64((const __m128i*)data);
+		data += 8;
+		__m128i mask = _mm_set1_epi8(15);
+		zigzag = _mm_unpacklo_epi8(_mm_and_si128(source, mask), _mm_and_si128(_mm_srli_epi16(source, 4), mask));
+		break;
+	}
+	default:
+		zigzag = _mm_loadu_si128((const __m128i*)data);
+		data += 16;
+		break;
+	}
+	__m128i one = _mm_set1_epi8(1);
+	__m128i delta = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(zigzag, 1), _mm_set1_epi8(0x7F)), _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(zigzag, one)));
+	// Prefix sum of the deltas in 4 steps
+	delta = _mm_add_epi8(delta, _mm_slli_si128(delta, 1));
+	delta = _mm_add_epi8(delta, _mm_slli_si128(delta, 2));
+	delta = _mm_add_epi8(delta, _mm_slli_si128(delta, 4));
+	delta = _mm_add_epi8(delta, _mm_slli_si128(delta, 8));
+	__m128i result = _mm_add_epi8(delta, previous);
+	_mm_store_si128((__m128i*)values, result);
+	result = _mm_unpackhi_epi8(result, result);
+	result = _mm_unpackhi_epi16(result, result);
+	return _mm_shuffle_epi32(result, 0xFF);
+}
+#else
+// Decode a group of 16 deltas of a lane, continuing from the lane's previous value. Returns the last value
+inline unsigned char decodeVertexGroup(unsigned int bits, const unsigned char*& data, unsigned char* values, unsigned char previous)
+{
+	unsigned char zigzag[16];
+	switch (bits)
+	{
+	case 0:
+		memset(zigzag, 0, sizeof(zigzag));
+		break;
+	case 1:
+		for (int i = 0; i < 16; i++)
+		{
+			zigzag[i] = (unsigned char)((data[i / 4] >> ((i % 4) * 2)) & 3);
+		}
+		data += 4;
+		break;
+	case 2:
+		for (int i = 0; i < 16; i++)
+		{
+			zigzag[i] = (unsigned char)((data[i / 2] >> ((i % 2) * 4)) & 15);
+		}
+		data += 8;
+		break;
+	default:
+		memcpy(zigzag, data, sizeof(zigzag));
+		data += 16;
+		break;
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		previous = (unsigned char)(previous + ((zigzag[i] >> 1) ^ -(zigzag[i] & 1)));
+		values[i] = previous;
+	}
+	return previous;
+}
+#endif
+
+#if defined(MESH_CODEC_SSE)
+// 16 bytes of 4 consecutive lanes -> 4 registers, each with 4 vertices' worth of 4 bytes
+inline void transposeVertexLanes4(const unsigned char* lanes, __m128i* quads)
+{
+	__m128i lane0 = _mm_load_si128((const __m128i*)&lanes[0 * MESH_VERTEX_CODEC_BLOCK_SIZE]);
+	__m128i lane1 = _mm_load_si128((const __m128i*)&lanes[1 * MESH_VERTEX_CODEC_BLOCK_SIZE]);
+	__m128i lane2 = _mm_load_si128((const __m128i*)&lanes[2 * MESH_VERTEX_CODEC_BLOCK_SIZE]);
+	__m128i lane3 = _mm_load_si128((const __m128i*)&lanes[3 * MESH_VERTEX_CODEC_BLOCK_SIZE]);
+	__m128i lanes01Low = _mm_unpacklo_epi8(lane0, lane1);
+	__m128i lanes01High = _mm_unpackhi_epi8(lane0, lane1);
+	__m128i lanes23Low = _mm_unpacklo_epi8(lane2, lane3);
+	__m128i lanes23High = _mm_unpackhi_epi8(lane2, lane3);
+	quads[0] = _mm_unpacklo_epi16(lanes01Low, lanes23Low);
+	quads[1] = _mm_unpackhi_epi16(lanes01Low, lanes23Low);
+	quads[2] = _mm_unpacklo_epi16(lanes01High, lanes23High);
+	quads[3] = _mm_unpackhi_epi16(lanes01High, lanes23High);
+}
+#endif
+
+// Lanes (MESH_VERTEX_CODEC_BLOCK_SIZE bytes each) back to whole vertices, for groupCount groups of 16
+inline void transposeVertexLanes(const unsigned char* lanes, size_t groupCount, size_t vertexSize, unsigned char* vertices)
+{
+#if defined(MESH_CODEC_SSE)
+	for (size_t i = 0; i < groupCount * 16; i += 16)
+	{
+		// 4 lanes of 16 vertices -> 16 vertices of 4 bytes, in 4 registers of 4 vertices. Two such sets of lanes are interleaved
+		// further so every vertex gets 8 bytes at once
+		for (size_t k = 0; k < vertexSize; k += 8)
+		{
+			__m128i quadsLow[4];
+			__m128i quadsHigh[4];
+			transposeVertexLanes4(&lanes[k * MESH_VERTEX_CODEC_BLOCK_SIZE + i], quadsLow);
+			unsigned char* out = &vertices[i * vertexSize + k];
+			if (k + 4 == vertexSize)
+			{
+				for (int q = 0; q < 4; q++)
+				{
+					__m128i quad = quadsLow[q];
+					for (int j = 0; j < 4; j++)
+					{
+						int word = _mm_cvtsi128_si32(quad);
+						memcpy(out, &word, sizeof(word));
+						out += vertexSize;
+						quad = _mm_srli_si128(quad, 4);
+					}
+				}
+				break;
+			}
+			transposeVertexLanes4(&lanes[(k + 4) * MESH_VERTEX_CODEC_BLOCK_SIZE + i], quadsHigh);
+			for (int q = 0; q < 4; q++)
+			{
+				__m128i pairs01 = _mm_unpacklo_epi32(quadsLow[q], quadsHigh[q]);
+				__m128i pairs23 = _mm_unpackhi_epi32(quadsLow[q], quadsHigh[q]);
+				_mm_storel_epi64((__m128i*)out, pairs01);
+				_mm_storel_epi64((__m128i*)(out + vertexSize), _mm_unpackhi_epi64(pairs01, pairs01));
+				_mm_storel_epi64((__m128i*)(out + 2 * vertexSize), pairs23);
+				_mm_storel_epi64((__m128i*)(out + 3 * vertexSize), _mm_unpackhi_epi64(pairs23, pairs23));
+				out += 4 * vertexSize;
+			}
+		}
+	}
+#else
+	for (size_t i = 0; i < groupCount * 16; i++)
+	{
+		for (size_t k = 0; k < vertexSize; k++)
+		{
+			vertices[i * vertexSize + k] = lanes[k * MESH_VERTEX_CODEC_BLOCK_SIZE + i];
+		}
+	}
+#endif
+}
+
+// False if the stream is corrupt, not exactly vertexCount vertices or vertexSize is unsupported (destination may be partially written then)
+inline bool decodeVertexBuffer(unsigned char* destination, size_t vertexCount, size_t vertexSize, const unsigned char* data, size_t size)
+{
+	static const unsigned char groupSizes[4] = { 0, 4, 8, 16 };
+	const unsigned char* end = data + size;
+	if (vertexSize == 0 || vertexSize % 4 != 0 || vertexSize > MESH_VERTEX_CODEC_MAX_VERTEX_SIZE || size < 1 || data[0] != MESH_VERTEX_CODEC_HEADER)
+	{
+		return false;
+	}
+	data++;
+	if (vertexCount == 0)
+	{
+		return data == end;
+	}
+	if ((size_t)(end - data) < vertexSize)
+	{
+		return false;
+	}
+	unsigned char previous[MESH_VERTEX_CODEC_MAX_VERTEX_SIZE];
+	memcpy(previous, data, vertexSize);
+	data += vertexSize;
+
+	alignas(16) unsigned char lanes[MESH_VERTEX_CODEC_MAX_VERTEX_SIZE * MESH_VERTEX_CODEC_BLOCK_SIZE];
+	alignas(16) unsigned char block[MESH_VERTEX_CODEC_MAX_VERTEX_SIZE * MESH_VERTEX_CODEC_BLOCK_SIZE];
+	for (size_t blockStart = 0; blockStart < vertexCount; blockStart += MESH_VERTEX_CODEC_BLOCK_SIZE)
+	{
+		size_t count = std::min<size_t>(MESH_VERTEX_CODEC_BLOCK_SIZE, vertexCount - blockStart);
+		size_t groupCount = (count + 15) / 16;
+		size_t headerSize = (groupCount + 3) / 4;
+		// Only blocks near the end of the stream need their lanes' sizes checked one by one
+		bool checkLanes = (size_t)(end - data) < vertexSize * (headerSize + groupCount * 16);
+		for (size_t k = 0; k < vertexSize; k++)
+		{
+			const unsigned char* header = data;
+			if (checkLanes)
+			{
+				if ((size_t)(end - data) < headerSize)
+				{
+					return false;
+				}
+				size_t payloadSize = 0;
+				for (size_t i = 0; i < headerSize; i++)
+				{
+					payloadSize += groupSizes[header[i] & 3] + groupSizes[(header[i] >> 2) & 3] + groupSizes[(header[i] >> 4) & 3] + groupSizes[header[i] >> 6];
+				}
+				if ((size_t)(end - data - headerSize) < payloadSize)
+				{
+					return false;
+				}
+			}
+			data += headerSize;
+			unsigned char* lane = &lanes[k * MESH_VERTEX_CODEC_BLOCK_SIZE];
+#if defined(MESH_CODEC_SSE)
+			__m128i last = _mm_set1_epi8((char)previous[k]);
+#else
+			unsigned char last = previous[k];
+#endif
+			for (size_t group = 0; group < groupCount; group++)
+			{
+				unsigned int bits = (header[group / 4] >> ((group % 4) * 2)) & 3;
+				last = decodeVertexGroup(bits, data, &lane[group * 16], last);
+			}
+#if defined(MESH_CODEC_SSE)
+			previous[k] = (unsigned char)_mm_cvtsi128_si32(last);
+#else
+			previous[k] = last;
+#endif
+		}
+		transposeVertexLanes(lanes, groupCount, vertexSize, block);
+		memcpy(&destination[blockStart * vertexSize], block, count * vertexSize);
+	}
+	return data == end;
+}
+
+#endif
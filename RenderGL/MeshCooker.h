@@ -0,0 +1,323 @@
+#ifndef MESH_COOKER_H
+#define MESH_COOKER_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "glm/glm.hpp"
+#include "Mesh.h"
+#include "MeshImporter.h"
+#include "MeshCodec.h"
+#include "MeshSimplifier.h"
+#include "ThreadPool.h"
+
+// Offline mesh cooking: source meshes (OBJ, glTF) are imported once, optimized for the vertex cache, overdraw and vertex fetch,
+// packed in a GPU vertex format and stored with compressed vertex and index streams (MeshCodec.h). Loading one is reading a few
+// times fewer bytes and decoding them straight into the mapped buffers of a Mesh, no parsing, deduplication or normal computation.
+//
+// Container (.rmesh, little endian): CookedMeshHeader, lodCount CookedMeshLods, then the encoded vertex stream and the encoded index stream
+// (all levels of detail). The bounds are stored rather than the dequantization, normalized positions are reconstructed from them like Mesh does
+
+#define COOKED_MESH_MAGIC 0x48534D52u // "RMSH"
+#define COOKED_MESH_VERSION 2u
+
+struct CookedMeshHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t positionFormat; // PositionFormat
+	uint32_t normalFormat;   // NormalFormat
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	float boundsMin[3];
+	float boundsMax[3];
+	float boundingSphere[4]; // Center of the bounds, radius to the farthest vertex
+	uint32_t vertexStreamSize;
+	uint32_t indexStreamSize;
+	uint32_t lodCount; // At least 1, the full detail level
+};
+
+// See MeshLod, errors are in the units of the stored (not fitted) positions
+struct CookedMeshLod
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	float error;
+};
+
+// A container that is in memory already
+struct CookedMeshView
+{
+	VertexFormat format;
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+	glm::vec4 boundingSphere = glm::vec4(0.0f);
+	std::vector<MeshLod> lods;
+	const unsigned char* vertexStream = nullptr;
+	size_t vertexStreamSize = 0;
+	const unsigned char* indexStream = nullptr;
+	size_t indexStreamSize = 0;
+};
+
+struct MeshCookStats
+{
+	MeshOptimizationReport optimization;
+	size_t vertexBytes = 0; // Packed, as the GPU stores them
+	size_t indexBytes = 0;  // 16 or 32 bit, as the GPU stores them
+	size_t encodedVertexBytes = 0;
+	size_t encodedIndexBytes = 0;
+};
+
+struct CookedMeshLoadStats
+{
+	size_t fileSize = 0;
+	size_t vertexCount = 0;
+	size_t triangleCount = 0;
+	size_t decodedBytes = 0; // Vertex + index buffer sizes
+	float readMilliseconds = 0.0f;
+	float decodeMilliseconds = 0.0f; // Into the mapped buffers, including mapping and unmapping
+};
+
+inline void printCookedMeshLoadStats(const std::string& name, const CookedMeshLoadStats& stats)
+{
+	std::cout << "Mesh " << name << ": " << stats.triangleCount << " triangles, " << stats.vertexCount << " vertices, " << stats.fileSize / (1024.0 * 1024.0)
+		<< " MB cooked loaded in " << stats.readMilliseconds + stats.decodeMilliseconds << " ms (read " << stats.readMilliseconds << ", decode " << stats.decodeMilliseconds
+		<< " ms, " << stats.decodedBytes / (1024.0 * 1024.0 * 1024.0) / std::max(stats.decodeMilliseconds / 1000.0, 1e-9) << " GB/s)" << std::endl;
+}
+
+// Optimize the mesh (in place) and turn it into a container in memory, with its levels of detail if it has any
+inline MeshCookStats cookMeshData(MeshData& mesh, VertexFormat format, std::vector<unsigned char>& bytes)
+{
+	MeshCookStats stats;
+	stats.optimization = mesh.optimize();
+
+	glm::vec3 boundsMin(0.0f);
+	glm::vec3 boundsMax(0.0f);
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		boundsMin = i == 0 ? mesh.vertices[i].position : glm::min(boundsMin, mesh.vertices[i].position);
+		boundsMax = i == 0 ? mesh.vertices[i].position : glm::max(boundsMax, mesh.vertices[i].position);
+	}
+	glm::vec4 boundingSphere = mesh.computeBoundingSphere();
+	glm::vec3 positionScale;
+	glm::vec3 positionOffset;
+	getPositionDequantization(format, boundsMin, boundsMax, positionScale, positionOffset);
+
+	size_t stride = format.getVertexSize();
+	std::vector<unsigned char> packedVertices(mesh.vertices.size() * stride);
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		packVertex(mesh.vertices[i], format, positionScale, positionOffset, &packedVertices[i * stride]);
+	}
+	std::vector<unsigned char> vertexStream;
+	std::vector<unsigned char> indexStream;
+	encodeVertexBuffer(packedVertices.data(), mesh.vertices.size(), stride, vertexStream);
+	encodeIndexBuffer(mesh.indices.data(), mesh.indices.size(), indexStream);
+
+	CookedMeshHeader header;
+	header.magic = COOKED_MESH_MAGIC;
+	header.version = COOKED_MESH_VERSION;
+	header.positionFormat = (uint32_t)format.positionFormat;
+	header.normalFormat = (uint32_t)format.normalFormat;
+	header.vertexCount = (uint32_t)mesh.vertices.size();
+	header.indexCount = (uint32_t)mesh.indices.size();
+	memcpy(header.boundsMin, &boundsMin, sizeof(header.boundsMin));
+	memcpy(header.boundsMax, &boundsMax, sizeof(header.boundsMax));
+	memcpy(header.boundingSphere, &boundingSphere, sizeof(header.boundingSphere));
+	header.vertexStreamSize = (uint32_t)vertexStream.size();
+	header.indexStreamSize = (uint32_t)indexStream.size();
+	header.lodCount = (uint32_t)std::max<size_t>(mesh.lods.size(), 1);
+
+	std::vector<CookedMeshLod> lods(header.lodCount);
+	for (size_t i = 0; i < lods.size(); i++)
+	{
+		lods[i].indexOffset = mesh.lods.empty() ? 0 : mesh.lods[i].indexOffset;
+		lods[i].indexCount = mesh.lods.empty() ? header.indexCount : mesh.lods[i].indexCount;
+		lods[i].error = mesh.lods.empty() ? 0.0f : mesh.lods[i].error;
+	}
+
+	bytes.resize(sizeof(header) + lods.size() * sizeof(CookedMeshLod));
+	memcpy(bytes.data(), &header, sizeof(header));
+	memcpy(bytes.data() + sizeof(header), lods.data(), lods.size() * sizeof(CookedMeshLod));
+	bytes.insert(bytes.end(), vertexStream.begin(), vertexStream.end());
+	bytes.insert(bytes.end(), indexStream.begin(), indexStream.end());
+
+	stats.vertexBytes = packedVertices.size();
+	stats.indexBytes = mesh.indices.size() * (mesh.vertices.size() <= 0xFFFF ? sizeof(unsigned short) : sizeof(unsigned int));
+	stats.encodedVertexBytes = vertexStream.size();
+	stats.encodedIndexBytes = indexStream.size();
+	return stats;
+}
+
+// Streams of a container in memory (a file read whole or an asset pack mapping), without copying them.
+// False if the bytes are not a valid container
+inline bool parseCookedMesh(const unsigned char* bytes, size_t size, CookedMeshView& view)
+{
+	CookedMeshHeader header;
+	if (size < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(&header, bytes, sizeof(header));
+	if (header.magic != COOKED_MESH_MAGIC || header.version != COOKED_MESH_VERSION || header.positionFormat > POSITION_UNORM16 || header.normalFormat > NORMAL_OCTAHEDRAL
+		|| header.vertexCount == 0 || header.indexCount % 3 != 0 || header.lodCount == 0 || header.lodCount > header.indexCount / 3 + 1
+		|| sizeof(header) + header.lodCount * sizeof(CookedMeshLod) + (size_t)header.vertexStreamSize + header.indexStreamSize != size)
+	{
+		return false;
+	}
+	const unsigned char* lodTable = bytes + sizeof(header);
+	view.lods.resize(header.lodCount);
+	for (size_t i = 0; i < view.lods.size(); i++)
+	{
+		CookedMeshLod lod;
+		memcpy(&lod, lodTable + i * sizeof(lod), sizeof(lod));
+		if (lod.indexCount % 3 != 0 || lod.indexOffset > header.indexCount || lod.indexCount > header.indexCount - lod.indexOffset)
+		{
+			return false;
+		}
+		view.lods[i].indexOffset = lod.indexOffset;
+		view.lods[i].indexCount = lod.indexCount;
+		view.lods[i].error = lod.error;
+	}
+	view.format.positionFormat = (PositionFormat)header.positionFormat;
+	view.format.normalFormat = (NormalFormat)header.normalFormat;
+	view.vertexCount = header.vertexCount;
+	view.indexCount = header.indexCount;
+	view.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	view.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+	view.boundingSphere = glm::vec4(header.boundingSphere[0], header.boundingSphere[1], header.boundingSphere[2], header.boundingSphere[3]);
+	view.vertexStream = lodTable + header.lodCount * sizeof(CookedMeshLod);
+	view.vertexStreamSize = header.vertexStreamSize;
+	view.indexStream = view.vertexStream + header.vertexStreamSize;
+	view.indexStreamSize = header.indexStreamSize;
+	return true;
+}
+
+// Decode both streams, indices as unsigned short or unsigned int. False if a stream is corrupt
+inline bool decodeCookedMesh(const CookedMeshView& view, unsigned char* vertices, void* indices, bool shortIndices)
+{
+	if (!decodeVertexBuffer(vertices, view.vertexCount, view.format.getVertexSize(), view.vertexStream, view.vertexStreamSize))
+	{
+		return false;
+	}
+	if (shortIndices)
+	{
+		return decodeIndexBuffer((unsigned short*)indices, view.indexCount, view.vertexCount, view.indexStream, view.indexStreamSize);
+	}
+	return decodeIndexBuffer((unsigned int*)indices, view.indexCount, view.vertexCount, view.indexStream, view.indexStreamSize);
+}
+
+// Import a source mesh (see MeshImporter), cook it with the given vertex format (and a chain of levels of detail) and write the container
+inline bool cookMesh(const std::string& meshFilePath, const std::string& cookedFilePath, VertexFormat format, bool withLods, ThreadPool* pool = nullptr)
+{
+	MeshImporter importer(pool);
+	MeshData mesh;
+	if (!importer.import(meshFilePath, mesh))
+	{
+		std::cout << "Failed to cook mesh: " << meshFilePath << std::endl;
+		return false;
+	}
+	if (withLods)
+	{
+		auto start = std::chrono::steady_clock::now();
+		generateLods(mesh);
+		printMeshLods(meshFilePath, mesh.lods, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+	std::vector<unsigned char> bytes;
+	MeshCookStats stats = cookMeshData(mesh, format, bytes);
+
+	std::ofstream file(cookedFilePath, std::ios::binary);
+	if (!file || !file.write((const char*)bytes.data(), bytes.size()))
+	{
+		std::cout << "Failed to write cooked mesh: " << cookedFilePath << std::endl;
+		return false;
+	}
+	std::cout << "Cooked " << meshFilePath << " (" << stats.optimization.triangleCount << " triangles, " << stats.optimization.vertexCount << " vertices, ACMR "
+		<< stats.optimization.acmrBefore << " -> " << stats.optimization.acmrAfter << ") into " << cookedFilePath << ": " << importer.getStats().fileSize / (1024.0 * 1024.0)
+		<< " MB -> " << bytes.size() / (1024.0 * 1024.0) << " MB" << std::endl;
+	std::cout << "  vertices " << stats.vertexBytes << " -> " << stats.encodedVertexBytes << " bytes (" << (double)stats.vertexBytes / stats.encodedVertexBytes
+		<< ":1), indices " << stats.indexBytes << " -> " << stats.encodedIndexBytes << " bytes (" << stats.encodedIndexBytes * 8.0 / std::max<size_t>(mesh.indices.size() / 3, 1)
+		<< " bits per triangle)" << std::endl;
+	return true;
+}
+
+// Read a container and decode it straight into the buffers of a new Mesh, in the vertex format it was cooked with. If fitToUnitCube,
+// it's centered and scaled into [-0.5, 0.5]^3 like MeshImporter::setFitToUnitCube() does, through the mesh's position transform.
+// boundingSphere is the (fitted) sphere stored with it. Needs the GL context on the calling thread
+inline std::unique_ptr<Mesh> loadCookedMesh(const std::string& path, bool fitToUnitCube, glm::vec4& boundingSphere, CookedMeshLoadStats& stats)
+{
+	auto start = std::chrono::steady_clock::now();
+	std::vector<char> bytes;
+	if (!MeshImporter::readFile(path, bytes))
+	{
+		std::cout << "ERROR::MESH_COOKER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+		return nullptr;
+	}
+	stats = CookedMeshLoadStats();
+	stats.fileSize = bytes.size();
+	stats.readMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	CookedMeshView view;
+	if (!parseCookedMesh((const unsigned char*)bytes.data(), bytes.size(), view))
+	{
+		std::cout << "ERROR::MESH_COOKER::INVALID_CONTAINER " << path << std::endl;
+		return nullptr;
+	}
+	std::unique_ptr<Mesh> mesh(new Mesh(view.vertexCount, view.indexCount, view.boundsMin, view.boundsMax, view.format));
+	mesh->setLods(view.lods);
+	start = std::chrono::steady_clock::now();
+	const int maxAttempts = 3;
+	for (int attempt = 1; ; attempt++)
+	{
+		unsigned char* vertices = nullptr;
+		void* indices = nullptr;
+		if (!mesh->mapBuffers(vertices, indices))
+		{
+			return nullptr;
+		}
+		bool decoded = decodeCookedMesh(view, vertices, indices, mesh->hasShortIndices());
+		bool intact = mesh->unmapBuffers();
+		if (!decoded)
+		{
+			std::cout << "ERROR::MESH_COOKER::CORRUPT_STREAM " << path << std::endl;
+			return nullptr;
+		}
+		if (intact)
+		{
+			break;
+		}
+		if (attempt == maxAttempts)
+		{
+			std::cout << "ERROR::MESH_COOKER::BUFFER_CONTENTS_LOST " << path << std::endl;
+			return nullptr;
+		}
+	}
+	stats.decodeMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	stats.vertexCount = view.vertexCount;
+	stats.triangleCount = view.lods[0].indexCount / 3;
+	stats.decodedBytes = mesh->getVertexBufferSize() + mesh->getIndexBufferSize();
+
+	boundingSphere = view.boundingSphere;
+	if (fitToUnitCube)
+	{
+		glm::vec3 extent = view.boundsMax - view.boundsMin;
+		glm::vec3 offset = -(view.boundsMin + view.boundsMax) * 0.5f;
+		float scale = 1.0f / std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-20f));
+		mesh->transformPositions(scale, offset * scale);
+		boundingSphere = glm::vec4((glm::vec3(boundingSphere) + offset) * scale, boundingSphere.w * scale);
+	}
+	return mesh;
+}
+
+#endif
@@ -0,0 +1,1019 @@
+#ifndef MESH_IMPORTER_H
+#define MESH_IMPORTER_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#include <cstdint>
+#include <cmath>
+
+#include "glm/glm.hpp"
+#include "Mesh.h"
+#include "ThreadPool.h"
+#include "Json.h"
+
+#define DEFAULT_MESH_IMPORT_CHUNK_SIZE (4 * 1024 * 1024) // Bytes of OBJ text per parse task
+#define MESH_IMPORT_BATCH_SIZE 65536 // Vertices/indices per conversion and packing task
+#define MESH_IMPORT_NO_INDEX 0xFFFFFFFFu // OBJ corner without a normal
+
+enum MeshFileType
+{
+	MESH_FILE_UNKNOWN,
+	MESH_FILE_OBJ,    // Wavefront OBJ, text
+	MESH_FILE_GLB,   // Binary glTF 2.0
+	MESH_FILE_COOKED // Cooked container, loaded with loadCookedMesh() (MeshCooker.h) instead of the importer
+};
+
+// By extension (case insensitive)
+inline MeshFileType getMeshFileType(const std::string& path)
+{
+	size_t dot = path.find_last_of('.');
+	std::string extension = dot == std::string::npos ? std::string() : path.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+	if (extension == "obj")
+	{
+		return MESH_FILE_OBJ;
+	}
+	if (extension == "glb")
+	{
+		return MESH_FILE_GLB;
+	}
+	if (extension == "rmesh")
+	{
+		return MESH_FILE_COOKED;
+	}
+	return MESH_FILE_UNKNOWN;
+}
+
+// Numbers of the last import
+struct MeshImportStats
+{
+	size_t fileSize = 0;
+	size_t vertexCount = 0;
+	size_t triangleCount = 0;
+	bool computedNormals = false;   // The file had no (or incomplete) normals, they were computed from the faces
+	float readMilliseconds = 0.0f;
+	float parseMilliseconds = 0.0f; // Text/binary to positions, normals and triangle corners
+	float buildMilliseconds = 0.0f; // Normals, vertex deduplication, bounds
+	float writeMilliseconds = 0.0f; // Into the MeshData, or packed into the mapped GPU buffers
+};
+
+inline void printMeshImportStats(const std::string& name, const MeshImportStats& stats)
+{
+	std::cout << "Mesh " << name << ": " << stats.triangleCount << " triangles, " << stats.vertexCount << " vertices" << (stats.computedNormals ? " (computed normals)" : "")
+		<< ", " << stats.fileSize / (1024.0 * 1024.0) << " MB imported in " << stats.readMilliseconds + stats.parseMilliseconds + stats.buildMilliseconds + stats.writeMilliseconds
+		<< " ms (read " << stats.readMilliseconds << ", parse " << stats.parseMilliseconds << ", build " << stats.buildMilliseconds << ", write " << stats.writeMilliseconds << ")" << std::endl;
+}
+
+// Indexed triangles as they come out of a file: one normal per position
+struct ImportedGeometry
+{
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<unsigned int> indices;
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+};
+
+// Imports OBJ and binary glTF meshes, with the work spread over a thread pool. OBJ text is split into line aligned chunks that are parsed
+// in parallel and stitched together by offsetting each chunk's vertex numbering, glTF accessors are converted in parallel ranges.
+// Vertices are then written either into a MeshData or, packed in the GPU vertex format, straight into the mapped buffers of a Mesh.
+// OBJ faces are fan triangulated, texture coordinates, materials and groups are ignored. glTF node transforms are not applied, all
+// triangle primitives of all meshes are merged. Missing normals are computed (area weighted)
+class MeshImporter
+{
+public:
+	// No pool -> everything runs on the calling thread
+	MeshImporter(ThreadPool* pool_in = nullptr, size_t chunkSize_in = DEFAULT_MESH_IMPORT_CHUNK_SIZE) :
+		pool(pool_in),
+		chunkSize(std::max<size_t>(chunkSize_in, 1024)),
+		fitToUnitCube(false),
+		positionOffset(0.0f),
+		positionScale(1.0f),
+		boundingSphere(0.0f)
+	{
+	}
+
+	// Center and scale imported meshes into [-0.5, 0.5]^3 like the built-in cube. Scans come in all sizes and units
+	void setFitToUnitCube(bool fit)
+	{
+		fitToUnitCube = fit;
+	}
+
+	bool import(const std::string& path, MeshData& mesh)
+	{
+		ImportedGeometry geometry;
+		if (!load(path, geometry))
+		{
+			return false;
+		}
+		auto start = std::chrono::steady_clock::now();
+		setTransform(geometry);
+		mesh.vertices.resize(geometry.positions.size());
+		writeVertices(geometry, [&](size_t i, const Vertex& vertex) { mesh.vertices[i] = vertex; });
+		mesh.indices.swap(geometry.indices);
+		stats.writeMilliseconds = getMillisecondsSince(start);
+		return true;
+	}
+
+	// Streams the vertices into the buffers of a new Mesh without an intermediate copy. Needs the GL context on the calling thread
+	std::unique_ptr<Mesh> importToGPU(const std::string& path, VertexFormat format = VertexFormat())
+	{
+		ImportedGeometry geometry;
+		if (!load(path, geometry))
+		{
+			return nullptr;
+		}
+		auto start = std::chrono::steady_clock::now();
+		setTransform(geometry);
+		std::unique_ptr<Mesh> mesh(new Mesh(geometry.positions.size(), geometry.indices.size(), transform(geometry.boundsMin), transform(geometry.boundsMax), format));
+		size_t stride = format.getVertexSize();
+		const int maxAttempts = 3;
+		for (int attempt = 1; ; attempt++)
+		{
+			unsigned char* vertices = nullptr;
+			void* indices = nullptr;
+			if (!mesh->mapBuffers(vertices, indices))
+			{
+				return nullptr;
+			}
+			writeVertices(geometry, [&](size_t i, const Vertex& vertex) { mesh->packVertex(vertex, vertices + i * stride); });
+			bool shortIndices = mesh->hasShortIndices();
+			parallelFor(geometry.indices.size(), MESH_IMPORT_BATCH_SIZE, [&](size_t begin, size_t end)
+			{
+				if (shortIndices)
+				{
+					std::copy(geometry.indices.begin() + begin, geometry.indices.begin() + end, (unsigned short*)indices + begin);
+				}
+				else
+				{
+					memcpy((unsigned int*)indices + begin, &geometry.indices[begin], (end - begin) * sizeof(unsigned int));
+				}
+			});
+			if (mesh->unmapBuffers())
+			{
+				break;
+			}
+			if (attempt == maxAttempts)
+			{
+				std::cout << "ERROR::MESH_IMPORTER::BUFFER_CONTENTS_LOST " << path << std::endl;
+				return nullptr;
+			}
+		}
+		stats.writeMilliseconds = getMillisecondsSince(start);
+		return mesh;
+	}
+
+	// Parse a file that's already in memory, without writing the result anywhere (the importer's CPU work, see runMeshImportBenchmark())
+	bool parse(const char* data, size_t size, MeshFileType type, ImportedGeometry& geometry)
+	{
+		float readMilliseconds = stats.readMilliseconds; // Set by load()
+		stats = MeshImportStats();
+		stats.fileSize = size;
+		stats.readMilliseconds = readMilliseconds;
+		auto start = std::chrono::steady_clock::now();
+		bool parsed = type == MESH_FILE_OBJ ? parseObj(data, size, geometry) : type == MESH_FILE_GLB ? parseGlb(data, size, geometry) : false;
+		if (!parsed)
+		{
+			return false;
+		}
+		if (geometry.indices.empty())
+		{
+			std::cout << "ERROR::MESH_IMPORTER::NO_TRIANGLES" << std::endl;
+			return false;
+		}
+		computeBounds(geometry);
+		stats.buildMilliseconds = getMillisecondsSince(start) - stats.parseMilliseconds;
+		stats.vertexCount = geometry.positions.size();
+		stats.triangleCount = geometry.indices.size() / 3;
+		return true;
+	}
+
+	const MeshImportStats& getStats() const
+	{
+		return stats;
+	}
+
+	// Of the last imported mesh, as written (fitted if enabled). Center of the bounding box, radius to the farthest vertex
+	glm::vec4 getBoundingSphere() const
+	{
+		return boundingSphere;
+	}
+
+	static bool readFile(const std::string& path, std::vector<char>& data)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file)
+		{
+			return false;
+		}
+		std::streamsize size = file.tellg();
+		file.seekg(0);
+		data.resize((size_t)size);
+		return size == 0 || (bool)file.read(data.data(), size);
+	}
+
+private:
+	bool load(const std::string& path, ImportedGeometry& geometry)
+	{
+		MeshFileType type = getMeshFileType(path);
+		if (type == MESH_FILE_UNKNOWN || type == MESH_FILE_COOKED)
+		{
+			std::cout << "ERROR::MESH_IMPORTER::UNKNOWN_FILE_TYPE " << path << " (expected .obj or .glb)" << std::endl;
+			return false;
+		}
+		auto start = std::chrono::steady_clock::now();
+		std::vector<char> data;
+		if (!readFile(path, data))
+		{
+			std::cout << "ERROR::MESH_IMPORTER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+			return false;
+		}
+		stats.readMilliseconds = getMillisecondsSince(start);
+		if (!parse(data.data(), data.size(), type, geometry))
+		{
+			std::cout << "ERROR::MESH_IMPORTER::IMPORT_FAILED " << path << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// Run body(begin, end) over [0, count) in batches on the pool's threads and wait for all of them
+	void parallelFor(size_t count, size_t batchSize, const std::function<void(size_t, size_t)>& body)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+		if (!pool || count <= batchSize)
+		{
+			body(0, count);
+			return;
+		}
+		size_t remaining = (count + batchSize - 1) / batchSize;
+		std::mutex mutex;
+		std::condition_variable done;
+		for (size_t begin = 0; begin < count; begin += batchSize)
+		{
+			size_t end = std::min(count, begin + batchSize);
+			pool->submit([&, begin, end]()
+			{
+				body(begin, end);
+				std::lock_guard<std::mutex> lock(mutex);
+				remaining--;
+				done.notify_one(); // Under the lock, so the waiter can't return and destroy it first
+			});
+		}
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [&]() { return remaining == 0; });
+	}
+
+	/*
+	* OBJ
+	*/
+
+	struct ObjChunk
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		std::vector<unsigned int> positionIndices; // Triangle corners, 0-based
+		std::vector<unsigned int> normalIndices;   // Empty until a face has a normal reference, then one per corner, MESH_IMPORT_NO_INDEX where a corner has none
+		// Negative (relative) references can only be resolved once the chunk's place in the file is known: corner + index relative to the chunk's first element
+		std::vector<std::pair<size_t, long long>> positionFixups;
+		std::vector<std::pair<size_t, long long>> normalFixups;
+		const char* error = nullptr; // First line that couldn't be parsed
+	};
+
+	bool parseObj(const char* data, size_t size, ImportedGeometry& geometry)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		// Chunk boundaries are moved forward to the next line start
+		size_t chunkCount = std::max<size_t>(1, size / chunkSize);
+		std::vector<size_t> chunkStarts(chunkCount + 1, size);
+		for (size_t i = 0; i < chunkCount; i++)
+		{
+			size_t offset = i * (size / chunkCount);
+			if (offset > 0 && data[offset - 1] != '\n')
+			{
+				const char* newline = (const char*)memchr(data + offset, '\n', size - offset);
+				offset = newline ? newline - data + 1 : size;
+			}
+			chunkStarts[i] = i > 0 ? std::max(offset, chunkStarts[i - 1]) : 0;
+		}
+		std::vector<ObjChunk> chunks(chunkCount);
+		parallelFor(chunkCount, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				parseObjChunk(data + chunkStarts[i], data + chunkStarts[i + 1], chunks[i]);
+			}
+		});
+
+		// Each chunk's vertices and corners go after the previous chunks'
+		std::vector<size_t> positionBases(chunkCount);
+		std::vector<size_t> normalBases(chunkCount);
+		std::vector<size_t> cornerBases(chunkCount);
+		size_t positionCount = 0;
+		size_t normalCount = 0;
+		size_t cornerCount = 0;
+		for (size_t i = 0; i < chunkCount; i++)
+		{
+			if (chunks[i].error)
+			{
+				std::cout << "ERROR::MESH_IMPORTER::OBJ_SYNTAX_ERROR line " << std::count(data, chunks[i].error, '\n') + 1 << std::endl;
+				return false;
+			}
+			positionBases[i] = positionCount;
+			normalBases[i] = normalCount;
+			cornerBases[i] = cornerCount;
+			positionCount += chunks[i].positions.size();
+			normalCount += chunks[i].normals.size();
+			cornerCount += chunks[i].positionIndices.size();
+		}
+		if (positionCount > MESH_IMPORT_NO_INDEX)
+		{
+			std::cout << "ERROR::MESH_IMPORTER::TOO_MANY_VERTICES" << std::endl;
+			return false;
+		}
+
+		geometry.positions.resize(positionCount);
+		geometry.indices.resize(cornerCount);
+		// Without any normal references there's nothing to check or remap, the normals get computed
+		bool normalReferences = false;
+		for (const ObjChunk& chunk : chunks)
+		{
+			normalReferences |= !chunk.normalIndices.empty();
+		}
+		std::vector<glm::vec3> normals(normalCount);
+		std::vector<unsigned int> normalIndices(normalReferences ? cornerCount : 0);
+		parallelFor(chunkCount, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				ObjChunk& chunk = chunks[i];
+				for (const std::pair<size_t, long long>& fixup : chunk.positionFixups)
+				{
+					long long index = (long long)positionBases[i] + fixup.second;
+					chunk.positionIndices[fixup.first] = index >= 0 ? (unsigned int)index : MESH_IMPORT_NO_INDEX; // Caught as out of range below
+				}
+				for (const std::pair<size_t, long long>& fixup : chunk.normalFixups)
+				{
+					long long index = (long long)normalBases[i] + fixup.second;
+					chunk.normalIndices[fixup.first] = index >= 0 ? (unsigned int)index : (unsigned int)normalCount;
+				}
+				std::copy(chunk.positions.begin(), chunk.positions.end(), geometry.positions.begin() + positionBases[i]);
+				std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + normalBases[i]);
+				std::copy(chunk.positionIndices.begin(), chunk.positionIndices.end(), geometry.indices.begin() + cornerBases[i]);
+				if (normalReferences)
+				{
+					chunk.normalIndices.resize(chunk.positionIndices.size(), MESH_IMPORT_NO_INDEX);
+					std::copy(chunk.normalIndices.begin(), chunk.normalIndices.end(), normalIndices.begin() + cornerBases[i]);
+				}
+				chunk = ObjChunk(); // Free it while the others are still copied
+			}
+		});
+
+		// Check the references and find out how the normals are used
+		std::atomic<bool> outOfRange(false);
+		std::atomic<bool> missingNormals(!normalReferences);
+		std::atomic<bool> separateNormalIndices(false);
+		parallelFor(cornerCount, MESH_IMPORT_BATCH_SIZE, [&](size_t begin, size_t end)
+		{
+			bool batchOutOfRange = false;
+			bool batchMissingNormals = false;
+			bool batchSeparateNormalIndices = false;
+			for (size_t i = begin; i < end; i++)
+			{
+				batchOutOfRange |= geometry.indices[i] >= positionCount;
+			}
+			for (size_t i = begin; normalReferences && i < end; i++)
+			{
+				batchOutOfRange |= normalIndices[i] != MESH_IMPORT_NO_INDEX && normalIndices[i] >= normalCount;
+				batchMissingNormals |= normalIndices[i] == MESH_IMPORT_NO_INDEX;
+				batchSeparateNormalIndices |= normalIndices[i] != geometry.indices[i];
+			}
+			outOfRange = outOfRange || batchOutOfRange;
+			missingNormals = missingNormals || batchMissingNormals;
+			separateNormalIndices = separateNormalIndices || batchSeparateNormalIndices;
+		});
+		if (outOfRange)
+		{
+			std::cout << "ERROR::MESH_IMPORTER::INDEX_OUT_OF_RANGE" << std::endl;
+			return false;
+		}
+		stats.parseMilliseconds = getMillisecondsSince(start);
+
+		if (missingNormals)
+		{
+			computeNormals(geometry);
+		}
+		else if (!separateNormalIndices && normalCount >= positionCount)
+		{
+			normals.resize(positionCount); // Exporters often number positions and normals the same way, no remapping needed
+			geometry.normals.swap(normals);
+		}
+		else
+		{
+			mergeVertices(geometry, normals, normalIndices);
+		}
+		return true;
+	}
+
+	void parseObjChunk(const char* begin, const char* end, ObjChunk& chunk)
+	{
+		// Growing the arrays would copy them over and over, room for as much as typical lines would give (only the used part gets touched)
+		size_t size = end - begin;
+		chunk.positions.reserve(size / 16);
+		chunk.positionIndices.reserve(size / 4);
+		std::vector<long long> facePositions;
+		std::vector<long long> faceNormals;
+		const char* p = begin;
+		while (p < end)
+		{
+			// Values are parsed up to the end of the line without looking for it first, the parsers stop at '\n'
+			const char* line = p;
+			p = skipSpaces(p, end);
+			bool valid = true;
+			if (end - p > 2 && p[0] == 'v' && isSpace(p[1]))
+			{
+				glm::vec3 position;
+				p += 2;
+				valid = parseFloat(p, end, position.x) && parseFloat(p, end, position.y) && parseFloat(p, end, position.z);
+				chunk.positions.push_back(position); // Extra components (w, vertex colors) are ignored
+			}
+			else if (end - p > 3 && p[0] == 'v' && p[1] == 'n' && isSpace(p[2]))
+			{
+				glm::vec3 normal;
+				p += 3;
+				valid = parseFloat(p, end, normal.x) && parseFloat(p, end, normal.y) && parseFloat(p, end, normal.z);
+				chunk.normals.push_back(normal);
+			}
+			else if (end - p > 2 && p[0] == 'f' && isSpace(p[1]))
+			{
+				p += 2;
+				valid = parseFace(p, end, chunk, facePositions, faceNormals);
+			}
+			if (!valid && !chunk.error)
+			{
+				chunk.error = line;
+			}
+			while (p < end && *p != '\n')
+			{
+				p++; // Rest of the line, or a line that isn't geometry
+			}
+			p++;
+		}
+	}
+
+	// Corners as "v", "v/vt", "v//vn" or "v/vt/vn", triangulated as a fan. Normal references are only kept per corner once a face has one
+	static bool parseFace(const char*& p, const char* end, ObjChunk& chunk, std::vector<long long>& positions, std::vector<long long>& normals)
+	{
+		positions.clear();
+		normals.clear();
+		bool hasNormals = false;
+		while (true)
+		{
+			p = skipSpaces(p, end);
+			if (p == end || *p == '\n' || *p == '\r' || *p == '#')
+			{
+				break;
+			}
+			long long position = 0;
+			long long texcoord = 0;
+			long long normal = 0; // 0 -> none, OBJ numbering starts at 1
+			if (!parseIndex(p, end, position) || position == 0)
+			{
+				return false;
+			}
+			if (p < end && *p == '/')
+			{
+				p++;
+				if (p < end && *p != '/' && !parseIndex(p, end, texcoord))
+				{
+					return false;
+				}
+				if (p < end && *p == '/')
+				{
+					p++;
+					if (!parseIndex(p, end, normal) || normal == 0)
+					{
+						return false;
+					}
+				}
+			}
+			if (p < end && !isSpace(*p) && *p != '\n' && *p != '\r')
+			{
+				return false;
+			}
+			positions.push_back(position);
+			normals.push_back(normal);
+			hasNormals |= normal != 0;
+		}
+		if (positions.size() < 3)
+		{
+			return false;
+		}
+		bool keepNormals = hasNormals || !chunk.normalIndices.empty();
+		if (keepNormals)
+		{
+			chunk.normalIndices.resize(chunk.positionIndices.size(), MESH_IMPORT_NO_INDEX); // Earlier corners had none
+		}
+		for (size_t i = 1; i + 1 < positions.size(); i++)
+		{
+			size_t corners[3] = { 0, i, i + 1 };
+			for (size_t corner : corners)
+			{
+				addReference(positions[corner], chunk.positions.size(), chunk.positionIndices, chunk.positionFixups);
+				if (!keepNormals)
+				{
+					continue;
+				}
+				if (normals[corner] == 0)
+				{
+					chunk.normalIndices.push_back(MESH_IMPORT_NO_INDEX);
+				}
+				else
+				{
+					addReference(normals[corner], chunk.normals.size(), chunk.normalIndices, chunk.normalFixups);
+				}
+			}
+		}
+		return true;
+	}
+
+	static void addReference(long long reference, size_t chunkElementCount, std::vector<unsigned int>& indices, std::vector<std::pair<size_t, long long>>& fixups)
+	{
+		if (reference > 0)
+		{
+			indices.push_back((unsigned int)std::min(reference - 1, (long long)MESH_IMPORT_NO_INDEX - 1)); // Too large is caught as out of range
+		}
+		else
+		{
+			fixups.push_back(std::make_pair(indices.size(), (long long)chunkElementCount + reference));
+			indices.push_back(0);
+		}
+	}
+
+	static bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	static const char* skipSpaces(const char* p, const char* end)
+	{
+		while (p < end && isSpace(*p))
+		{
+			p++;
+		}
+		return p;
+	}
+
+	static bool parseIndex(const char*& p, const char* end, long long& value)
+	{
+		bool negative = p < end && *p == '-';
+		p += negative ? 1 : 0;
+		const char* digits = p;
+		value = 0;
+		while (p < end && *p >= '0' && *p <= '9' && p - digits < 18)
+		{
+			value = value * 10 + (*p++ - '0');
+		}
+		value = negative ? -value : value;
+		return p > digits;
+	}
+
+	// Decimal float with optional exponent, faster than strtof (no locale, no hex/inf/nan) and within an ulp of it
+	static bool parseFloat(const char*& p, const char* end, float& value)
+	{
+		static const double powersOf10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+		p = skipSpaces(p, end);
+		bool negative = p < end && *p == '-';
+		p += p < end && (*p == '-' || *p == '+') ? 1 : 0;
+		uint64_t mantissa = 0;
+		int exponent = 0;
+		int digitCount = 0;
+		for (; p < end && *p >= '0' && *p <= '9'; p++, digitCount++)
+		{
+			if (mantissa < 100000000000000000ull)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+			}
+			else
+			{
+				exponent++; // Beyond double precision anyway
+			}
+		}
+		if (p < end && *p == '.')
+		{
+			for (p++; p < end && *p >= '0' && *p <= '9'; p++, digitCount++)
+			{
+				if (mantissa < 100000000000000000ull)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					exponent--;
+				}
+			}
+		}
+		if (digitCount == 0)
+		{
+			return false;
+		}
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			p++;
+			long long explicitExponent = 0;
+			if (p < end && *p == '+')
+			{
+				p++;
+			}
+			if (!parseIndex(p, end, explicitExponent))
+			{
+				return false;
+			}
+			exponent += (int)std::max(-1000ll, std::min(1000ll, explicitExponent));
+		}
+		double result = (double)mantissa;
+		int magnitude = std::abs(exponent);
+		double scale = magnitude <= 22 ? powersOf10[magnitude] : std::pow(10.0, magnitude);
+		result = exponent < 0 ? result / scale : result * scale;
+		value = (float)(negative ? -result : result);
+		return true;
+	}
+
+	/*
+	* glTF
+	*/
+
+	struct GlbAccessor
+	{
+		const unsigned char* data = nullptr;
+		size_t count = 0;
+		size_t stride = 0;
+		int componentType = 0;
+	};
+
+	bool parseGlb(const char* data, size_t size, ImportedGeometry& geometry)
+	{
+		auto start = std::chrono::steady_clock::now();
+		const uint32_t glbMagic = 0x46546C67; // "glTF"
+		const uint32_t jsonChunkType = 0x4E4F534A; // "JSON"
+		const uint32_t binChunkType = 0x004E4942;  // "BIN\0"
+		uint32_t header[3];
+		if (size < sizeof(header))
+		{
+			std::cout << "ERROR::MESH_IMPORTER::GLB_TRUNCATED" << std::endl;
+			return false;
+		}
+		memcpy(header, data, sizeof(header));
+		if (header[0] != glbMagic || header[1] != 2)
+		{
+			std::cout << "ERROR::MESH_IMPORTER::NOT_A_GLTF_2_BINARY" << std::endl;
+			return false;
+		}
+
+		const char* json = nullptr;
+		size_t jsonSize = 0;
+		const unsigned char* bin = nullptr;
+		size_t binSize = 0;
+		size_t length = std::min<size_t>(size, header[2]);
+		for (size_t offset = sizeof(header); offset + 8 <= length;)
+		{
+			uint32_t chunkHeader[2];
+			memcpy(chunkHeader, data + offset, sizeof(chunkHeader));
+			offset += sizeof(chunkHeader);
+			if (chunkHeader[0] > length - offset)
+			{
+				std::cout << "ERROR::MESH_IMPORTER::GLB_TRUNCATED" << std::endl;
+				return false;
+			}
+			if (chunkHeader[1] == jsonChunkType && !json)
+			{
+				json = data + offset;
+				jsonSize = chunkHeader[0];
+			}
+			else if (chunkHeader[1] == binChunkType && !bin)
+			{
+				bin = (const unsigned char*)data + offset;
+				binSize = chunkHeader[0];
+			}
+			offset += (chunkHeader[0] + 3) & ~3u; // Chunks are 4 byte aligned
+		}
+		JsonValue document;
+		if (!json || !JsonParser::parse(json, jsonSize, document))
+		{
+			std::cout << "ERROR::MESH_IMPORTER::GLB_INVALID_JSON" << std::endl;
+			return false;
+		}
+
+		// Collect the triangle primitives, then convert them at their place in the merged mesh
+		struct Primitive
+		{
+			GlbAccessor positions;
+			GlbAccessor normals;
+			GlbAccessor indices;
+			size_t vertexBase;
+			size_t indexBase;
+		};
+		std::vector<Primitive> primitives;
+		size_t vertexCount = 0;
+		size_t indexCount = 0;
+		bool missingNormals = false;
+		const JsonValue* meshes = document.find("meshes");
+		for (size_t m = 0; meshes && m < meshes->elements.size(); m++)
+		{
+			const JsonValue* meshPrimitives = meshes->elements[m].find("primitives");
+			for (size_t p = 0; meshPrimitives && p < meshPrimitives->elements.size(); p++)
+			{
+				const JsonValue& source = meshPrimitives->elements[p];
+				const JsonValue* attributes = source.find("attributes");
+				const JsonValue* position = attributes ? attributes->find("POSITION") : nullptr;
+				const JsonValue* normal = attributes ? attributes->find("NORMAL") : nullptr;
+				const JsonValue* indices = source.find("indices");
+				if (source.getNumber("mode", 4) != 4 || !position)
+				{
+					std::cout << "ERROR::MESH_IMPORTER::GLB_UNSUPPORTED_PRIMITIVE (only triangle lists with positions)" << std::endl;
+					return false;
+				}
+				Primitive primitive;
+				if (!getGlbAccessor(document, *position, bin, binSize, "VEC3", primitive.positions) || primitive.positions.componentType != GL_FLOAT
+					|| (normal && (!getGlbAccessor(document, *normal, bin, binSize, "VEC3", primitive.normals) || primitive.normals.componentType != GL_FLOAT))
+					|| (indices && (!getGlbAccessor(document, *indices, bin, binSize, "SCALAR", primitive.indices) || primitive.indices.componentType == GL_FLOAT)))
+				{
+					std::cout << "ERROR::MESH_IMPORTER::GLB_UNSUPPORTED_ACCESSOR (float positions/normals, unsigned indices, no sparse accessors or external buffers)" << std::endl;
+					return false;
+				}
+				if (normal && primitive.normals.count != primitive.positions.count)
+				{
+					std::cout << "ERROR::MESH_IMPORTER::GLB_ATTRIBUTE_COUNT_MISMATCH" << std::endl;
+					return false;
+				}
+				missingNormals |= !normal;
+				primitive.vertexBase = vertexCount;
+				primitive.indexBase = indexCount;
+				vertexCount += primitive.positions.count;
+				indexCount += (indices ? primitive.indices.count : primitive.positions.count) / 3 * 3;
+				primitives.push_back(primitive);
+			}
+		}
+		if (vertexCount > MESH_IMPORT_NO_INDEX)
+		{
+			std::cout << "ERROR::MESH_IMPORTER::TOO_MANY_VERTICES" << std::endl;
+			return false;
+		}
+
+		geometry.positions.resize(vertexCount);
+		geometry.normals.resize(missingNormals ? 0 : vertexCount);
+		geometry.indices.resize(indexCount);
+		std::atomic<bool> outOfRange(false);
+		for (const Primitive& primitive : primitives)
+		{
+			parallelFor(primitive.positions.count, MESH_IMPORT_BATCH_SIZE, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					memcpy(&geometry.positions[primitive.vertexBase + i], primitive.positions.data + i * primitive.positions.stride, sizeof(glm::vec3));
+					if (!missingNormals)
+					{
+						memcpy(&geometry.normals[primitive.vertexBase + i], primitive.normals.data + i * primitive.normals.stride, sizeof(glm::vec3));
+					}
+				}
+			});
+			size_t primitiveIndexCount = (primitive.indices.data ? primitive.indices.count : primitive.positions.count) / 3 * 3;
+			parallelFor(primitiveIndexCount, MESH_IMPORT_BATCH_SIZE, [&](size_t begin, size_t end)
+			{
+				bool batchOutOfRange = false;
+				for (size_t i = begin; i < end; i++)
+				{
+					size_t index = primitive.indices.data ? readGlbIndex(primitive.indices, i) : i;
+					batchOutOfRange |= index >= primitive.positions.count;
+					geometry.indices[primitive.indexBase + i] = (unsigned int)(primitive.vertexBase + index);
+				}
+				outOfRange = outOfRange || batchOutOfRange;
+			});
+		}
+		if (outOfRange)
+		{
+			std::cout << "ERROR::MESH_IMPORTER::INDEX_OUT_OF_RANGE" << std::endl;
+			return false;
+		}
+		stats.parseMilliseconds = getMillisecondsSince(start);
+
+		if (missingNormals)
+		{
+			computeNormals(geometry);
+		}
+		return true;
+	}
+
+	// Accessor in the GLB's binary chunk, checked to be within it
+	static bool getGlbAccessor(const JsonValue& document, const JsonValue& index, const unsigned char* bin, size_t binSize, const char* type, GlbAccessor& accessor)
+	{
+		const JsonValue* source = getElement(document.find("accessors"), index.type == JsonValue::JSON_NUMBER ? index.number : -1);
+		const JsonValue* accessorType = source ? source->find("type") : nullptr;
+		if (!source || !accessorType || accessorType->string != type || source->find("sparse") || !source->find("bufferView") || !bin)
+		{
+			return false;
+		}
+		const JsonValue* view = getElement(document.find("bufferViews"), source->getNumber("bufferView", -1));
+		const JsonValue* buffer = view ? getElement(document.find("buffers"), view->getNumber("buffer", -1)) : nullptr;
+		if (!view || view->getNumber("buffer", -1) != 0 || !buffer || buffer->find("uri"))
+		{
+			return false; // Only the GLB's own binary chunk
+		}
+
+		accessor.componentType = (int)source->getNumber("componentType", 0);
+		size_t componentSize = accessor.componentType == GL_UNSIGNED_BYTE ? 1 : accessor.componentType == GL_UNSIGNED_SHORT ? 2 : accessor.componentType == GL_UNSIGNED_INT || accessor.componentType == GL_FLOAT ? 4 : 0;
+		size_t elementSize = componentSize * (strcmp(type, "VEC3") == 0 ? 3 : 1);
+		accessor.count = (size_t)source->getNumber("count", 0);
+		accessor.stride = (size_t)view->getNumber("byteStride", (double)elementSize);
+		double viewOffset = view->getNumber("byteOffset", 0);
+		double viewLength = view->getNumber("byteLength", 0);
+		double accessorOffset = source->getNumber("byteOffset", 0);
+		if (elementSize == 0 || accessor.stride < elementSize || viewOffset < 0 || accessorOffset < 0 || viewOffset + viewLength > (double)binSize
+			|| (accessor.count > 0 && accessorOffset + (double)accessor.stride * (accessor.count - 1) + elementSize > viewLength))
+		{
+			return false;
+		}
+		accessor.data = bin + (size_t)viewOffset + (size_t)accessorOffset;
+		return true;
+	}
+
+	// Array element by a JSON number, null if there is no such element
+	static const JsonValue* getElement(const JsonValue* array, double index)
+	{
+		return array && index >= 0.0 && index < (double)array->elements.size() ? array->at((size_t)index) : nullptr;
+	}
+
+	static size_t readGlbIndex(const GlbAccessor& accessor, size_t i)
+	{
+		const unsigned char* element = accessor.data + i * accessor.stride;
+		if (accessor.componentType == GL_UNSIGNED_BYTE)
+		{
+			return *element;
+		}
+		if (accessor.componentType == GL_UNSIGNED_SHORT)
+		{
+			unsigned short index;
+			memcpy(&index, element, sizeof(index));
+			return index;
+		}
+		unsigned int index;
+		memcpy(&index, element, sizeof(index));
+		return index;
+	}
+
+	/*
+	* Building
+	*/
+
+	// Area weighted face normals summed per position. The scatter is serial, threads would race on shared vertices
+	void computeNormals(ImportedGeometry& geometry)
+	{
+		stats.computedNormals = true;
+		std::vector<glm::vec3>& normals = geometry.normals;
+		normals.assign(geometry.positions.size(), glm::vec3(0.0f));
+		const std::vector<unsigned int>& indices = geometry.indices;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			const glm::vec3& a = geometry.positions[indices[i + 0]];
+			glm::vec3 faceNormal = glm::cross(geometry.positions[indices[i + 1]] - a, geometry.positions[indices[i + 2]] - a);
+			normals[indices[i + 0]] += faceNormal;
+			normals[indices[i + 1]] += faceNormal;
+			normals[indices[i + 2]] += faceNormal;
+		}
+		parallelFor(normals.size(), MESH_IMPORT_BATCH_SIZE, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				float length = glm::length(normals[i]);
+				normals[i] = length > 0.0f ? normals[i] / length : glm::vec3(0.0f, 1.0f, 0.0f); // Unused or only in degenerate triangles
+			}
+		});
+	}
+
+	// One vertex per distinct (position, normal) reference pair, through an open addressing hash table
+	void mergeVertices(ImportedGeometry& geometry, const std::vector<glm::vec3>& normals, const std::vector<unsigned int>& normalIndices)
+	{
+		size_t tableSize = 16;
+		while (tableSize < geometry.indices.size() * 2)
+		{
+			tableSize *= 2;
+		}
+		const uint64_t emptySlot = ~0ull;
+		std::vector<uint64_t> keys(tableSize, emptySlot);
+		std::vector<unsigned int> vertices(tableSize);
+		std::vector<glm::vec3> mergedPositions;
+		std::vector<glm::vec3> mergedNormals;
+		for (size_t i = 0; i < geometry.indices.size(); i++)
+		{
+			uint64_t key = (uint64_t)geometry.indices[i] << 32 | normalIndices[i];
+			size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & (tableSize - 1);
+			while (keys[slot] != emptySlot && keys[slot] != key)
+			{
+				slot = (slot + 1) & (tableSize - 1);
+			}
+			if (keys[slot] == emptySlot)
+			{
+				keys[slot] = key;
+				vertices[slot] = (unsigned int)mergedPositions.size();
+				mergedPositions.push_back(geometry.positions[geometry.indices[i]]);
+				mergedNormals.push_back(normals[normalIndices[i]]);
+			}
+			geometry.indices[i] = vertices[slot];
+		}
+		geometry.positions.swap(mergedPositions);
+		geometry.normals.swap(mergedNormals);
+	}
+
+	void computeBounds(ImportedGeometry& geometry)
+	{
+		std::mutex mutex;
+		geometry.boundsMin = geometry.positions.empty() ? glm::vec3(0.0f) : geometry.positions[0];
+		geometry.boundsMax = geometry.boundsMin;
+		parallelFor(geometry.positions.size(), MESH_IMPORT_BATCH_SIZE, [&](size_t begin, size_t end)
+		{
+			glm::vec3 boundsMin = geometry.positions[begin];
+			glm::vec3 boundsMax = boundsMin;
+			for (size_t i = begin; i < end; i++)
+			{
+				boundsMin = glm::min(boundsMin, geometry.positions[i]);
+				boundsMax = glm::max(boundsMax, geometry.positions[i]);
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			geometry.boundsMin = glm::min(geometry.boundsMin, boundsMin);
+			geometry.boundsMax = glm::max(geometry.boundsMax, boundsMax);
+		});
+	}
+
+	/*
+	* Writing
+	*/
+
+	void setTransform(const ImportedGeometry& geometry)
+	{
+		positionOffset = glm::vec3(0.0f);
+		positionScale = 1.0f;
+		if (fitToUnitCube)
+		{
+			glm::vec3 extent = geometry.boundsMax - geometry.boundsMin;
+			positionOffset = -(geometry.boundsMin + geometry.boundsMax) * 0.5f;
+			positionScale = 1.0f / std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-20f));
+		}
+	}
+
+	glm::vec3 transform(const glm::vec3& position) const
+	{
+		return (position + positionOffset) * positionScale;
+	}
+
+	// Hands every (transformed) vertex to write, in parallel, and computes the bounding sphere on the way
+	void writeVertices(const ImportedGeometry& geometry, const std::function<void(size_t, const Vertex&)>& write)
+	{
+		glm::vec3 center = transform((geometry.boundsMin + geometry.boundsMax) * 0.5f);
+		std::mutex mutex;
+		float radius = 0.0f;
+		parallelFor(geometry.positions.size(), MESH_IMPORT_BATCH_SIZE, [&](size_t begin, size_t end)
+		{
+			float batchRadius = 0.0f;
+			for (size_t i = begin; i < end; i++)
+			{
+				Vertex vertex;
+				vertex.position = transform(geometry.positions[i]);
+				vertex.normal = geometry.normals[i];
+				write(i, vertex);
+				batchRadius = std::max(batchRadius, glm::length(vertex.position - center));
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			radius = std::max(radius, batchRadius);
+		});
+		boundingSphere = glm::vec4(center, radius);
+	}
+
+	static float getMillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	ThreadPool* pool;
+	size_t chunkSize;
+	bool fitToUnitCube;
+	glm::vec3 positionOffset;
+	float positionScale;
+	glm::vec4 boundingSphere;
+	MeshImportStats stats;
+};
+
+#endif
@@ -0,0 +1,259 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <vector>
+#include <algorithm>
+
+#include "glm/glm.hpp"
+
+// Index buffer optimizations for the GPU's post-transform vertex cache, all operating on triangle lists.
+// Typical post-transform caches behave roughly like a FIFO of 16-32 vertices, 16 is a conservative default.
+#define DEFAULT_VERTEX_CACHE_SIZE 16
+
+// Average cache miss ratio: transformed vertices per triangle with a FIFO cache of cacheSize entries.
+// 3.0 is the worst case (no reuse), ~0.5 the best a closed mesh can get
+inline float computeACMR(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = DEFAULT_VERTEX_CACHE_SIZE)
+{
+	if (indices.empty())
+	{
+		return 0.0f;
+	}
+
+	// A vertex is in the FIFO if it was inserted less than cacheSize misses ago
+	std::vector<unsigned int> insertionTime(vertexCount, 0);
+	unsigned int time = cacheSize + 1;
+	unsigned int misses = 0;
+	for (unsigned int index : indices)
+	{
+		if (time - insertionTime[index] > cacheSize)
+		{
+			insertionTime[index] = time++;
+			misses++;
+		}
+	}
+	return (float)misses / (indices.size() / 3);
+}
+
+// Vertex -> adjacent triangles, stored as one flat array
+struct TriangleAdjacency
+{
+	std::vector<unsigned int> counts;
+	std::vector<unsigned int> offsets;
+	std::vector<unsigned int> triangles;
+
+	TriangleAdjacency(const std::vector<unsigned int>& indices, size_t vertexCount) : counts(vertexCount, 0), offsets(vertexCount, 0), triangles(indices.size())
+	{
+		for (unsigned int index : indices)
+		{
+			counts[index]++;
+		}
+		unsigned int offset = 0;
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			offsets[v] = offset;
+			offset += counts[v];
+		}
+		std::vector<unsigned int> fill(offsets);
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			triangles[fill[indices[i]]++] = (unsigned int)(i / 3);
+		}
+	}
+};
+
+// Reorder triangles for the post-transform vertex cache with Tipsify (Sander, Nehab & Barczak 2007, "Fast Triangle Reordering for
+// Vertex Locality and Reduced Overdraw"): fan out around a vertex, then continue with the cached neighbour that stays in the cache longest
+inline std::vector<unsigned int> optimizeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = DEFAULT_VERTEX_CACHE_SIZE)
+{
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	if (indices.empty())
+	{
+		return result;
+	}
+
+	TriangleAdjacency adjacency(indices, vertexCount);
+	std::vector<unsigned int> liveTriangles(adjacency.counts);
+	std::vector<unsigned int> cacheTimestamps(vertexCount, 0);
+	std::vector<bool> emitted(indices.size() / 3, false);
+	std::vector<unsigned int> deadEndStack;
+	std::vector<unsigned int> candidates;
+
+	unsigned int time = cacheSize + 1;
+	unsigned int cursor = 0;
+	int fanningVertex = (int)indices[0];
+	while (fanningVertex >= 0)
+	{
+		// Emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		const unsigned int* neighbours = &adjacency.triangles[adjacency.offsets[fanningVertex]];
+		for (unsigned int n = 0; n < adjacency.counts[fanningVertex]; n++)
+		{
+			unsigned int triangle = neighbours[n];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+			for (unsigned int corner = 0; corner < 3; corner++)
+			{
+				unsigned int vertex = indices[triangle * 3 + corner];
+				result.push_back(vertex);
+				deadEndStack.push_back(vertex);
+				candidates.push_back(vertex);
+				liveTriangles[vertex]--;
+				if (time - cacheTimestamps[vertex] > cacheSize)
+				{
+					cacheTimestamps[vertex] = time++;
+				}
+			}
+			emitted[triangle] = true;
+		}
+
+		// Next fanning vertex: the candidate that will still be in the cache after its remaining triangles are emitted, and entered the cache earliest
+		int bestVertex = -1;
+		int bestPriority = -1;
+		for (unsigned int vertex : candidates)
+		{
+			if (liveTriangles[vertex] == 0)
+			{
+				continue;
+			}
+			int priority = 0;
+			if (time - cacheTimestamps[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+			{
+				priority = (int)(time - cacheTimestamps[vertex]);
+			}
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				bestVertex = (int)vertex;
+			}
+		}
+
+		// Dead end: go back to recently used vertices, otherwise continue with the next vertex in input order
+		while (bestVertex < 0 && !deadEndStack.empty())
+		{
+			unsigned int vertex = deadEndStack.back();
+			deadEndStack.pop_back();
+			if (liveTriangles[vertex] > 0)
+			{
+				bestVertex = (int)vertex;
+			}
+		}
+		while (bestVertex < 0 && cursor < vertexCount)
+		{
+			if (liveTriangles[cursor] > 0)
+			{
+				bestVertex = (int)cursor;
+			}
+			cursor++;
+		}
+		fanningVertex = bestVertex;
+	}
+	return result;
+}
+
+// Reorder triangle clusters so that ones facing outwards are drawn first, as they're likely to occlude the rest (less overdraw).
+// Clusters are split where the vertex cache would start over (a triangle missing on all 3 vertices), so the order within each cluster
+// and therefore most of the cache efficiency of optimizeVertexCache() is kept
+inline std::vector<unsigned int> optimizeOverdraw(const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions, unsigned int cacheSize = DEFAULT_VERTEX_CACHE_SIZE)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return indices;
+	}
+
+	// Find cluster boundaries
+	std::vector<size_t> clusterStarts;
+	std::vector<unsigned int> insertionTime(positions.size(), 0);
+	unsigned int time = cacheSize + 1;
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		unsigned int misses = 0;
+		for (unsigned int corner = 0; corner < 3; corner++)
+		{
+			unsigned int index = indices[triangle * 3 + corner];
+			if (time - insertionTime[index] > cacheSize)
+			{
+				insertionTime[index] = time++;
+				misses++;
+			}
+		}
+		if (triangle == 0 || misses == 3)
+		{
+			clusterStarts.push_back(triangle);
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+
+	// Area weighted centroid of the whole mesh
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		const glm::vec3& a = positions[indices[triangle * 3 + 0]];
+		const glm::vec3& b = positions[indices[triangle * 3 + 1]];
+		const glm::vec3& c = positions[indices[triangle * 3 + 2]];
+		float area = glm::length(glm::cross(b - a, c - a));
+		meshCentroid += (a + b + c) * (area / 3.0f);
+		meshArea += area;
+	}
+	meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : meshCentroid;
+
+	// How much each cluster faces away from the mesh center
+	size_t clusterCount = clusterStarts.size() - 1;
+	std::vector<float> sortKeys(clusterCount);
+	std::vector<unsigned int> clusterOrder(clusterCount);
+	for (size_t cluster = 0; cluster < clusterCount; cluster++)
+	{
+		glm::vec3 centroid(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+		for (size_t triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; triangle++)
+		{
+			const glm::vec3& a = positions[indices[triangle * 3 + 0]];
+			const glm::vec3& b = positions[indices[triangle * 3 + 1]];
+			const glm::vec3& c = positions[indices[triangle * 3 + 2]];
+			glm::vec3 areaNormal = glm::cross(b - a, c - a);
+			float triangleArea = glm::length(areaNormal);
+			centroid += (a + b + c) * (triangleArea / 3.0f);
+			normal += areaNormal;
+			area += triangleArea;
+		}
+		centroid = area > 0.0f ? centroid / area : centroid;
+		float normalLength = glm::length(normal);
+		normal = normalLength > 0.0f ? normal / normalLength : normal;
+		sortKeys[cluster] = glm::dot(centroid - meshCentroid, normal);
+		clusterOrder[cluster] = (unsigned int)cluster;
+	}
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](unsigned int a, unsigned int b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	for (unsigned int cluster : clusterOrder)
+	{
+		result.insert(result.end(), indices.begin() + clusterStarts[cluster] * 3, indices.begin() + clusterStarts[cluster + 1] * 3);
+	}
+	return result;
+}
+
+// Renumber vertices in the order the index buffer first uses them, so vertex fetches walk the vertex buffer mostly linearly.
+// Returns the new index of every old vertex (~0u for unused ones) and rewrites indices in place
+inline std::vector<unsigned int> optimizeVertexFetch(std::vector<unsigned int>& indices, size_t vertexCount, size_t& usedVertexCount)
+{
+	std::vector<unsigned int> remap(vertexCount, ~0u);
+	unsigned int nextVertex = 0;
+	for (unsigned int& index : indices)
+	{
+		if (remap[index] == ~0u)
+		{
+			remap[index] = nextVertex++;
+		}
+		index = remap[index];
+	}
+	usedVertexCount = nextVertex;
+	return remap;
+}
+
+#endif
@@ -0,0 +1,382 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <string>
+#include <vector>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+
+#include "glm/glm.hpp"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+
+// Level of detail generation: a chain of ever coarser index buffers over the same vertices, made by collapsing edges in the order of their
+// quadric error (Garland & Heckbert 1997, "Surface Simplification Using Quadric Error Metrics"). The collapses are half-edge collapses (a
+// vertex moves onto one of its neighbors), so no vertices are created and all levels draw from the one vertex buffer.
+
+// Each level aims for this fraction of the previous level's triangles
+#define DEFAULT_LOD_REDUCTION 0.5f
+// Levels including the full detail one
+#define DEFAULT_MAX_LOD_COUNT 8
+// Levels stop once they get this coarse
+#define DEFAULT_LOD_MIN_TRIANGLES 32
+// Weight of the normals against the positions, which are scaled to a unit sized mesh: turning the normals of an area by one radian costs about
+// as much as moving it by sqrt(weight) of the mesh size
+#define DEFAULT_SIMPLIFY_NORMAL_WEIGHT 0.01f
+
+// Area weighted sum of squared distances to the planes of the triangles collapsed into a vertex (p^T A p + 2 b.p + c), plus the same for
+// the vertex normal against the normals it replaced (normalWeight |n|^2 - 2 normalSum.n + normalSquares)
+struct SimplifierQuadric
+{
+	float a00 = 0.0f, a11 = 0.0f, a22 = 0.0f, a01 = 0.0f, a02 = 0.0f, a12 = 0.0f;
+	float b0 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+	float c = 0.0f;
+	float weight = 0.0f; // Area
+	glm::vec3 normalSum = glm::vec3(0.0f);
+	float normalSquares = 0.0f;
+	float normalWeight = 0.0f;
+
+	// Plane normal.p + distance = 0
+	void addPlane(const glm::vec3& normal, float distance, float area)
+	{
+		a00 += area * normal.x * normal.x;
+		a11 += area * normal.y * normal.y;
+		a22 += area * normal.z * normal.z;
+		a01 += area * normal.x * normal.y;
+		a02 += area * normal.x * normal.z;
+		a12 += area * normal.y * normal.z;
+		b0 += area * normal.x * distance;
+		b1 += area * normal.y * distance;
+		b2 += area * normal.z * distance;
+		c += area * distance * distance;
+		weight += area;
+	}
+
+	void addNormal(const glm::vec3& normal, float area)
+	{
+		normalSum += normal * area;
+		normalSquares += glm::dot(normal, normal) * area;
+		normalWeight += area;
+	}
+
+	void add(const SimplifierQuadric& other)
+	{
+		a00 += other.a00; a11 += other.a11; a22 += other.a22;
+		a01 += other.a01; a02 += other.a02; a12 += other.a12;
+		b0 += other.b0; b1 += other.b1; b2 += other.b2;
+		c += other.c;
+		weight += other.weight;
+		normalSum += other.normalSum;
+		normalSquares += other.normalSquares;
+		normalWeight += other.normalWeight;
+	}
+
+	// Unnormalized error of a vertex at position with the given normal
+	float evaluate(const glm::vec3& position, const glm::vec3& normal, float normalFactor) const
+	{
+		float x = position.x, y = position.y, z = position.z;
+		float distances = a00 * x * x + a11 * y * y + a22 * z * z + 2.0f * (a01 * x * y + a02 * x * z + a12 * y * z) + 2.0f * (b0 * x + b1 * y + b2 * z) + c;
+		float normals = normalWeight * glm::dot(normal, normal) - 2.0f * glm::dot(normalSum, normal) + normalSquares;
+		return distances + normalFactor * normals;
+	}
+};
+
+struct SimplifierCollapse
+{
+	unsigned int from;
+	unsigned int to;
+	float error;
+};
+
+// RMS error (in the unit sized space) over the area of both vertices when from moves onto to
+inline float getCollapseError(const std::vector<SimplifierQuadric>& quadrics, const std::vector<glm::vec3>& positions, const std::vector<Vertex>& vertices,
+	unsigned int from, unsigned int to, float normalWeight)
+{
+	const glm::vec3& position = positions[to];
+	const glm::vec3& normal = vertices[to].normal;
+	float error = quadrics[from].evaluate(position, normal, normalWeight) + quadrics[to].evaluate(position, normal, normalWeight);
+	return sqrtf(std::max(error, 0.0f) / std::max(quadrics[from].weight + quadrics[to].weight, 1e-20f));
+}
+
+// A collapse is rejected if it flips (or turns by more than ~75 degrees) any triangle around from that doesn't disappear with it
+inline bool isCollapseValid(const std::vector<unsigned int>& indices, const TriangleAdjacency& adjacency, const std::vector<glm::vec3>& positions,
+	unsigned int from, unsigned int to)
+{
+	for (unsigned int i = 0; i < adjacency.counts[from]; i++)
+	{
+		const unsigned int* triangle = &indices[adjacency.triangles[adjacency.offsets[from] + i] * 3];
+		if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+		{
+			continue;
+		}
+		glm::vec3 corners[3];
+		glm::vec3 moved[3];
+		for (int k = 0; k < 3; k++)
+		{
+			corners[k] = positions[triangle[k]];
+			moved[k] = triangle[k] == from ? positions[to] : corners[k];
+		}
+		glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+		glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+		if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Remove triangles by collapsing edges, cheapest first, until at most targetIndexCount indices are left or every remaining collapse costs
+// more than targetError (in mesh units). Vertices on open borders and on normal seams (same position, different normals) stay where they
+// are, so the result has no cracks. Returns the new index buffer over the same vertices, error is the largest error of a collapse made
+inline std::vector<unsigned int> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, size_t targetIndexCount, float targetError,
+	float& error, float normalWeight = DEFAULT_SIMPLIFY_NORMAL_WEIGHT)
+{
+	error = 0.0f;
+	size_t vertexCount = vertices.size();
+	if (indices.size() <= targetIndexCount || vertexCount == 0)
+	{
+		return indices;
+	}
+
+	// Work in a unit sized space, so the normal weight and float precision don't depend on the mesh's units
+	glm::vec3 boundsMin = vertices[0].position;
+	glm::vec3 boundsMax = vertices[0].position;
+	for (const Vertex& vertex : vertices)
+	{
+		boundsMin = glm::min(boundsMin, vertex.position);
+		boundsMax = glm::max(boundsMax, vertex.position);
+	}
+	glm::vec3 size = boundsMax - boundsMin;
+	float extent = std::max(std::max(size.x, size.y), std::max(size.z, 1e-20f));
+	std::vector<glm::vec3> positions(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		positions[i] = (vertices[i].position - boundsMin) / extent;
+	}
+
+	// Bitwise identical vertices are interchangeable, so they become one. Different vertices at the same position are a seam
+	std::vector<unsigned int> canonical(vertexCount);
+	std::vector<unsigned char> locked(vertexCount, 0);
+	std::unordered_map<std::string, unsigned int> uniqueVertices;
+	std::unordered_map<std::string, unsigned int> uniquePositions;
+	uniqueVertices.reserve(vertexCount);
+	uniquePositions.reserve(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		std::string key((const char*)&vertices[i], sizeof(Vertex));
+		canonical[i] = uniqueVertices.insert(std::make_pair(key, (unsigned int)i)).first->second;
+		std::string positionKey((const char*)&vertices[i].position, sizeof(glm::vec3));
+		unsigned int first = uniquePositions.insert(std::make_pair(positionKey, canonical[i])).first->second;
+		if (first != canonical[i])
+		{
+			locked[first] = 1;
+			locked[canonical[i]] = 1;
+		}
+	}
+
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		unsigned int a = canonical[indices[i + 0]], b = canonical[indices[i + 1]], c = canonical[indices[i + 2]];
+		if (a != b && b != c && a != c)
+		{
+			result.push_back(a);
+			result.push_back(b);
+			result.push_back(c);
+		}
+	}
+
+	// Edges that aren't shared by exactly two triangles are on a border (or non-manifold)
+	std::unordered_map<uint64_t, unsigned int> edgeUses;
+	for (size_t i = 0; i < result.size(); i++)
+	{
+		unsigned int a = result[i];
+		unsigned int b = result[i % 3 == 2 ? i - 2 : i + 1];
+		edgeUses[((uint64_t)std::min(a, b) << 32) | std::max(a, b)]++;
+	}
+	for (const std::pair<const uint64_t, unsigned int>& edge : edgeUses)
+	{
+		if (edge.second != 2)
+		{
+			locked[edge.first >> 32] = 1;
+			locked[edge.first & 0xFFFFFFFFu] = 1;
+		}
+	}
+
+	std::vector<SimplifierQuadric> quadrics(vertexCount);
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		const glm::vec3& p0 = positions[result[i + 0]];
+		glm::vec3 normal = glm::cross(positions[result[i + 1]] - p0, positions[result[i + 2]] - p0);
+		float length = glm::length(normal);
+		if (length == 0.0f)
+		{
+			continue;
+		}
+		normal /= length;
+		float area = length * 0.5f;
+		for (int k = 0; k < 3; k++)
+		{
+			quadrics[result[i + k]].addPlane(normal, -glm::dot(normal, p0), area);
+			quadrics[result[i + k]].addNormal(vertices[result[i + k]].normal, area);
+		}
+	}
+
+	// Passes of independent collapses: all edges are ranked once per pass, then collapsed in order as long as their neighborhoods weren't
+	// touched by an earlier collapse of the same pass (so the ranking and the flip checks stay exact), and the index buffer is rebuilt
+	float maxError = targetError / extent;
+	size_t targetTriangleCount = targetIndexCount / 3;
+	std::vector<SimplifierCollapse> collapses;
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<unsigned char> touched(vertexCount);
+	while (result.size() / 3 > targetTriangleCount)
+	{
+		TriangleAdjacency adjacency(result, vertexCount);
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i++)
+		{
+			unsigned int a = result[i];
+			unsigned int b = result[i % 3 == 2 ? i - 2 : i + 1];
+			if (a > b || (locked[a] && locked[b])) // Interior edges are seen from both of their triangles, once is enough
+			{
+				continue;
+			}
+			SimplifierCollapse collapse = { a, b, FLT_MAX };
+			if (!locked[a])
+			{
+				collapse.error = getCollapseError(quadrics, positions, vertices, a, b, normalWeight);
+			}
+			if (!locked[b])
+			{
+				float reverseError = getCollapseError(quadrics, positions, vertices, b, a, normalWeight);
+				if (reverseError < collapse.error)
+				{
+					collapse = { b, a, reverseError };
+				}
+			}
+			if (collapse.error <= maxError)
+			{
+				collapses.push_back(collapse);
+			}
+		}
+		if (collapses.empty())
+		{
+			break;
+		}
+
+		// A collapse removes about two triangles. Going much past the ones needed would make this pass's picks worse than the next pass's,
+		// so only the cheapest are sorted. The rest only get a look if none of those could be made
+		size_t triangleCount = result.size() / 3;
+		size_t neededCollapses = (triangleCount - targetTriangleCount) / 2 + 1;
+		size_t sortedCount = std::min(neededCollapses + neededCollapses / 2, collapses.size());
+		auto cheaper = [](const SimplifierCollapse& a, const SimplifierCollapse& b) { return a.error < b.error; };
+		std::nth_element(collapses.begin(), collapses.begin() + (sortedCount - 1), collapses.end(), cheaper);
+		std::sort(collapses.begin(), collapses.begin() + sortedCount, cheaper);
+
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			remap[i] = (unsigned int)i;
+		}
+		std::fill(touched.begin(), touched.end(), 0);
+		size_t performed = 0;
+		for (size_t i = 0; i < collapses.size() && triangleCount > targetTriangleCount; i++)
+		{
+			if (i == sortedCount)
+			{
+				if (performed > 0)
+				{
+					break;
+				}
+				std::sort(collapses.begin() + sortedCount, collapses.end(), cheaper);
+			}
+			const SimplifierCollapse& collapse = collapses[i];
+			if (touched[collapse.from] || touched[collapse.to] || !isCollapseValid(result, adjacency, positions, collapse.from, collapse.to))
+			{
+				continue;
+			}
+			for (unsigned int i = 0; i < adjacency.counts[collapse.from]; i++)
+			{
+				const unsigned int* triangle = &result[adjacency.triangles[adjacency.offsets[collapse.from] + i] * 3];
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+				{
+					triangleCount--;
+				}
+				touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+			}
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			error = std::max(error, collapse.error);
+			performed++;
+		}
+		if (performed == 0)
+		{
+			break;
+		}
+
+		size_t write = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			unsigned int a = remap[result[i + 0]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+			if (a != b && b != c && a != c)
+			{
+				result[write++] = a;
+				result[write++] = b;
+				result[write++] = c;
+			}
+		}
+		result.resize(write);
+	}
+	error *= extent;
+	return result;
+}
+
+// Append coarser levels of detail to a single level mesh, each simplified from the one before, until maxLodCount levels exist or the
+// simplifier can't get at least halfway to the next target. Levels are index ranges (see MeshData::lods), their errors add up along the chain
+inline void generateLods(MeshData& mesh, unsigned int maxLodCount = DEFAULT_MAX_LOD_COUNT, float reduction = DEFAULT_LOD_REDUCTION,
+	size_t minTriangleCount = DEFAULT_LOD_MIN_TRIANGLES)
+{
+	MeshLod fullDetail;
+	fullDetail.indexCount = (unsigned int)mesh.indices.size();
+	mesh.lods.assign(1, fullDetail);
+
+	std::vector<unsigned int> previous = mesh.indices;
+	while (mesh.lods.size() < maxLodCount && previous.size() / 3 > minTriangleCount)
+	{
+		size_t targetIndexCount = (size_t)(previous.size() / 3 * reduction) * 3;
+		float error = 0.0f;
+		std::vector<unsigned int> simplified = simplifyMesh(mesh.vertices, previous, targetIndexCount, FLT_MAX, error);
+		if (simplified.size() > (previous.size() + targetIndexCount) / 2)
+		{
+			break;
+		}
+		MeshLod lod;
+		lod.indexOffset = (unsigned int)mesh.indices.size();
+		lod.indexCount = (unsigned int)simplified.size();
+		lod.error = mesh.lods.back().error + error;
+		mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+		mesh.lods.push_back(lod);
+		previous.swap(simplified);
+	}
+}
+
+inline void printMeshLods(const std::string& name, const std::vector<MeshLod>& lods, float milliseconds)
+{
+	std::cout << "Mesh " << name << ": " << lods.size() << " LODs in " << milliseconds << " ms";
+	for (size_t i = 0; i < lods.size(); i++)
+	{
+		std::cout << (i == 0 ? " (" : ", ") << lods[i].indexCount / 3 << " triangles";
+		if (i > 0)
+		{
+			std::cout << " error " << lods[i].error;
+		}
+	}
+	std::cout << (lods.empty() ? "" : ")") << std::endl;
+}
+
+#endif
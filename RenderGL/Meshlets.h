@@ -0,0 +1,289 @@
+#ifndef MESHLETS_H
+#define MESHLETS_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+
+#include "glm/glm.hpp"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "FrustumCulling.h"
+
+// Meshlets: each level of detail is split into clusters of nearby, similarly facing triangles that are culled as a whole, against the
+// frustum (bounding sphere) and for facing away from the camera (normal cone), before anything is submitted. Without mesh shaders a cluster
+// is a range of the index buffer, the ranges that survive are drawn with one glMultiDrawElements() per object.
+// Sizes are the common mesh shader limits (meshoptimizer's defaults for NVIDIA), so the clusters would carry over to a mesh shader path
+
+#define DEFAULT_MESHLET_MAX_VERTICES 64
+#define DEFAULT_MESHLET_MAX_TRIANGLES 124
+// How much a candidate triangle facing away from the cluster's average normal counts against it, in new vertices. Higher makes narrower
+// normal cones (more back-facing clusters), at the cost of less vertex reuse within a cluster
+#define DEFAULT_MESHLET_CONE_WEIGHT 1.0f
+
+// Per-frame cluster culling numbers
+struct MeshletCullStats
+{
+	size_t tested = 0;
+	size_t frustumCulled = 0;
+	size_t backfaceCulled = 0;
+	size_t submittedTriangles = 0;
+};
+
+// Unit normal of a triangle, or zero if it's degenerate. Nothing is drawn with face culling and the winding isn't consistent in every mesh
+// (the cube's isn't), so the normal is turned to the side the vertex normals, which the lighting uses, point to
+inline glm::vec3 getMeshletTriangleNormal(const std::vector<Vertex>& vertices, const unsigned int* triangle)
+{
+	const Vertex& v0 = vertices[triangle[0]];
+	const Vertex& v1 = vertices[triangle[1]];
+	const Vertex& v2 = vertices[triangle[2]];
+	glm::vec3 normal = glm::cross(v1.position - v0.position, v2.position - v0.position);
+	float length = glm::length(normal);
+	if (length == 0.0f)
+	{
+		return glm::vec3(0.0f);
+	}
+	return glm::dot(normal, v0.normal + v1.normal + v2.normal) < 0.0f ? normal / -length : normal / length;
+}
+
+// Sphere around the bounding box of the cluster's vertices, and the cone of its triangle normals
+inline Meshlet computeMeshletBounds(const std::vector<Vertex>& vertices, const unsigned int* indices, size_t indexCount)
+{
+	Meshlet meshlet;
+	meshlet.indexCount = (unsigned int)indexCount;
+
+	glm::vec3 boundsMin = vertices[indices[0]].position;
+	glm::vec3 boundsMax = boundsMin;
+	glm::vec3 normalSum(0.0f);
+	std::vector<glm::vec3> normals;
+	for (size_t i = 0; i < indexCount; i += 3)
+	{
+		const glm::vec3& p0 = vertices[indices[i + 0]].position;
+		const glm::vec3& p1 = vertices[indices[i + 1]].position;
+		const glm::vec3& p2 = vertices[indices[i + 2]].position;
+		boundsMin = glm::min(boundsMin, glm::min(p0, glm::min(p1, p2)));
+		boundsMax = glm::max(boundsMax, glm::max(p0, glm::max(p1, p2)));
+		glm::vec3 normal = getMeshletTriangleNormal(vertices, indices + i);
+		if (normal != glm::vec3(0.0f))
+		{
+			normals.push_back(normal);
+			normalSum += normal;
+		}
+	}
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	float radius = 0.0f;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		radius = std::max(radius, glm::length(vertices[indices[i]].position - center));
+	}
+	meshlet.boundingSphere = glm::vec4(center, radius);
+
+	// Every triangle faces away from a viewer whose direction to the cluster is within 90 degrees minus the cone's half angle of the axis.
+	// Cones wider than ~84 degrees would hardly ever be culled, they're left at a cutoff of 1 (never)
+	float normalLength = glm::length(normalSum);
+	if (normalLength > 0.0f)
+	{
+		meshlet.coneAxis = normalSum / normalLength;
+		float minDot = 1.0f;
+		for (const glm::vec3& normal : normals)
+		{
+			minDot = std::min(minDot, glm::dot(normal, meshlet.coneAxis));
+		}
+		meshlet.coneCutoff = minDot <= 0.1f ? 1.0f : sqrtf(1.0f - minDot * minDot);
+	}
+	return meshlet;
+}
+
+// Split the triangles of one index range into meshlets, reordering them so every meshlet is a contiguous range. Clusters grow along
+// triangle adjacency from the first unassigned triangle, picking the neighbor that adds the fewest vertices and faces most like the
+// cluster so far. Starting from the vertex cache order keeps the seeds (and so the clusters) spatially coherent
+inline void buildMeshletRange(const std::vector<Vertex>& vertices, unsigned int* indices, size_t indexCount, unsigned int indexOffset, unsigned int maxVertices,
+	unsigned int maxTriangles, std::vector<Meshlet>& meshlets)
+{
+	size_t triangleCount = indexCount / 3;
+	std::vector<unsigned int> source(indices, indices + indexCount);
+	TriangleAdjacency adjacency(source, vertices.size());
+
+	std::vector<glm::vec3> triangleNormals(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangleNormals[t] = getMeshletTriangleNormal(vertices, &source[t * 3]);
+	}
+
+	// Vertices and candidate triangles are marked with the meshlet they belong to / were queued for
+	std::vector<unsigned int> vertexMeshlet(vertices.size(), ~0u);
+	std::vector<unsigned int> candidateMeshlet(triangleCount, ~0u);
+	std::vector<unsigned char> assigned(triangleCount, 0);
+	std::vector<unsigned int> candidates;
+	size_t write = 0;
+	size_t seed = 0;
+	while (true)
+	{
+		while (seed < triangleCount && assigned[seed])
+		{
+			seed++;
+		}
+		if (seed == triangleCount)
+		{
+			break;
+		}
+		unsigned int id = (unsigned int)meshlets.size();
+		size_t meshletStart = write;
+		unsigned int meshletVertexCount = 0;
+		unsigned int meshletTriangleCount = 0;
+		glm::vec3 normalSum(0.0f);
+		candidates.clear();
+
+		size_t next = seed;
+		while (true)
+		{
+			assigned[next] = 1;
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int vertex = source[next * 3 + k];
+				indices[write++] = vertex;
+				if (vertexMeshlet[vertex] == id)
+				{
+					continue;
+				}
+				vertexMeshlet[vertex] = id;
+				meshletVertexCount++;
+				for (unsigned int i = 0; i < adjacency.counts[vertex]; i++)
+				{
+					unsigned int triangle = adjacency.triangles[adjacency.offsets[vertex] + i];
+					if (!assigned[triangle] && candidateMeshlet[triangle] != id)
+					{
+						candidateMeshlet[triangle] = id;
+						candidates.push_back(triangle);
+					}
+				}
+			}
+			normalSum += triangleNormals[next];
+			if (++meshletTriangleCount == maxTriangles)
+			{
+				break;
+			}
+
+			glm::vec3 axis = glm::length(normalSum) > 0.0f ? glm::normalize(normalSum) : glm::vec3(0.0f);
+			float bestScore = 0.0f;
+			size_t best = triangleCount;
+			size_t kept = 0;
+			for (unsigned int triangle : candidates)
+			{
+				if (assigned[triangle])
+				{
+					continue;
+				}
+				candidates[kept++] = triangle;
+				unsigned int newVertices = 0;
+				for (int k = 0; k < 3; k++)
+				{
+					newVertices += vertexMeshlet[source[triangle * 3 + k]] != id;
+				}
+				if (meshletVertexCount + newVertices > maxVertices)
+				{
+					continue;
+				}
+				float score = newVertices + (1.0f - glm::dot(triangleNormals[triangle], axis)) * DEFAULT_MESHLET_CONE_WEIGHT;
+				if (best == triangleCount || score < bestScore)
+				{
+					best = triangle;
+					bestScore = score;
+				}
+			}
+			candidates.resize(kept);
+			if (best == triangleCount)
+			{
+				break;
+			}
+			next = best;
+		}
+
+		Meshlet meshlet = computeMeshletBounds(vertices, indices + meshletStart, write - meshletStart);
+		meshlet.indexOffset = indexOffset + (unsigned int)meshletStart;
+		meshlets.push_back(meshlet);
+	}
+}
+
+// Split every level of detail of the mesh into meshlets (see MeshData::meshlets and MeshLod::meshletOffset). Reorders the triangles within
+// each level, so run it after optimize()
+inline void buildMeshlets(MeshData& mesh, unsigned int maxVertices = DEFAULT_MESHLET_MAX_VERTICES, unsigned int maxTriangles = DEFAULT_MESHLET_MAX_TRIANGLES)
+{
+	if (mesh.lods.empty())
+	{
+		mesh.lods.resize(1);
+		mesh.lods[0].indexCount = (unsigned int)mesh.indices.size();
+	}
+	mesh.meshlets.clear();
+	for (MeshLod& lod : mesh.lods)
+	{
+		lod.meshletOffset = (unsigned int)mesh.meshlets.size();
+		buildMeshletRange(mesh.vertices, mesh.indices.data() + lod.indexOffset, lod.indexCount, lod.indexOffset, maxVertices, maxTriangles, mesh.meshlets);
+		lod.meshletCount = (unsigned int)mesh.meshlets.size() - lod.meshletOffset;
+	}
+}
+
+inline void printMeshlets(const std::string& name, const MeshData& mesh, float milliseconds)
+{
+	const MeshLod& lod = mesh.lods[0];
+	size_t backfaceCullable = 0;
+	for (unsigned int i = 0; i < lod.meshletCount; i++)
+	{
+		backfaceCullable += mesh.meshlets[lod.meshletOffset + i].coneCutoff < 1.0f;
+	}
+	std::cout << "Mesh " << name << ": " << mesh.meshlets.size() << " meshlets in " << milliseconds << " ms, " << lod.meshletCount << " at full detail ("
+		<< lod.indexCount / 3.0f / std::max(lod.meshletCount, 1u) << " triangles each, " << backfaceCullable << " with a normal cone)" << std::endl;
+}
+
+// Append the index ranges of the meshlets of one level of detail that may be visible on an object drawn with model_mat, merging ranges
+// that follow each other. Meshlets outside the frustum, or whose triangles all face away from the camera, are skipped. The frustum and the
+// camera are moved into mesh space instead of moving every meshlet into world space. The cone test assumes a uniform scale
+inline void cullMeshlets(const std::vector<Meshlet>& meshlets, const MeshLod& lod, const glm::mat4& model_mat, const Frustum& frustum, const glm::vec3& cameraPosition,
+	std::vector<GLsizei>& counts, std::vector<unsigned int>& firstIndices, MeshletCullStats& stats)
+{
+	// Plane dot (model_mat * p) = (transpose(model_mat) * plane) dot p, still a world space distance, so the radius has to be scaled
+	Frustum meshFrustum;
+	glm::mat4 transposed = glm::transpose(model_mat);
+	for (int i = 0; i < 6; i++)
+	{
+		meshFrustum.planes[i] = transposed * frustum.planes[i];
+	}
+	float scale = std::max(glm::length(glm::vec3(model_mat[0])), std::max(glm::length(glm::vec3(model_mat[1])), glm::length(glm::vec3(model_mat[2]))));
+	glm::vec3 eye = glm::vec3(glm::inverse(model_mat) * glm::vec4(cameraPosition, 1.0f));
+
+	unsigned int rangeEnd = ~0u;
+	for (unsigned int i = lod.meshletOffset; i < lod.meshletOffset + lod.meshletCount; i++)
+	{
+		const Meshlet& meshlet = meshlets[i];
+		glm::vec3 center = glm::vec3(meshlet.boundingSphere);
+		stats.tested++;
+		if (!meshFrustum.intersectsSphere(center, meshlet.boundingSphere.w * scale))
+		{
+			stats.frustumCulled++;
+			continue;
+		}
+		glm::vec3 toCenter = center - eye;
+		if (glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.boundingSphere.w)
+		{
+			stats.backfaceCulled++;
+			continue;
+		}
+		if (meshlet.indexOffset == rangeEnd)
+		{
+			counts.back() += meshlet.indexCount;
+		}
+		else
+		{
+			counts.push_back(meshlet.indexCount);
+			firstIndices.push_back(meshlet.indexOffset);
+		}
+		rangeEnd = meshlet.indexOffset + meshlet.indexCount;
+		stats.submittedTriangles += meshlet.indexCount / 3;
+	}
+}
+
+#endif
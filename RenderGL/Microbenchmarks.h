@@ -0,0 +1,631 @@
+#ifndef MICROBENCHMARKS_H
+#define MICROBENCHMARKS_H
+
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "FrustumCulling.h"
+#include "BVH.h"
+#include "ThreadPool.h"
+#include "TextureLoader.h"
+#include "TextureManager.h"
+#include "MipGenerator.h"
+#include "AssetPack.h"
+#include "MeshImporter.h"
+#include "MeshCooker.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Benchmarks of individual systems, run instead of the renderer. Only the texture ones need an OpenGL context
+
+// Best of repeats runs of function, in milliseconds. The minimum is the least noisy estimate for short CPU bound work
+template <typename Function>
+double measureBestMilliseconds(unsigned int repeats, Function function)
+{
+	double best = 0.0;
+	for (unsigned int i = 0; i < repeats; i++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		function();
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		best = i == 0 ? milliseconds : std::min(best, milliseconds);
+	}
+	return best;
+}
+
+// Uniform in [0, 1), same LCG as the stress scene so runs are reproducible
+inline float nextBenchmarkRandom(unsigned int& state)
+{
+	state = state * 1664525u + 1013904223u;
+	return (state >> 8) * (1.0f / 16777216.0f);
+}
+
+// Frustum culling throughput: scalar reference vs the SIMD path, for spheres scattered around a camera looking down -Z
+inline void runCullingBenchmark()
+{
+	glm::mat4 view_mat = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection_mat = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+	Frustum frustum = Frustum::fromMatrix(projection_mat * view_mat);
+
+	std::cout << "Frustum culling (" << FrustumCuller::getSimdName() << ")" << std::endl;
+	const unsigned int objectCounts[] = { 10000, 100000, 1000000 };
+	for (unsigned int objectCount : objectCounts)
+	{
+		FrustumCuller culler;
+		unsigned int state = 1;
+		for (unsigned int i = 0; i < objectCount; i++)
+		{
+			glm::vec3 center(nextBenchmarkRandom(state) * 200.0f - 100.0f, nextBenchmarkRandom(state) * 200.0f - 100.0f, nextBenchmarkRandom(state) * 200.0f - 100.0f);
+			culler.addSphere(center, 0.5f + nextBenchmarkRandom(state) * 1.5f);
+		}
+
+		std::vector<unsigned int> visibleScalar;
+		std::vector<unsigned int> visibleSimd;
+		unsigned int repeats = std::max(3u, 10000000u / objectCount);
+		double scalarMilliseconds = measureBestMilliseconds(repeats, [&]() { culler.cullScalar(frustum, visibleScalar); });
+		double simdMilliseconds = measureBestMilliseconds(repeats, [&]() { culler.cull(frustum, visibleSimd); });
+
+		std::cout << "  " << objectCount << " objects, " << visibleSimd.size() << " visible: scalar " << objectCount / scalarMilliseconds
+			<< " objects/ms, " << FrustumCuller::getSimdName() << " " << objectCount / simdMilliseconds << " objects/ms ("
+			<< scalarMilliseconds / simdMilliseconds << "x)" << (visibleScalar == visibleSimd ? "" : " MISMATCH") << std::endl;
+	}
+}
+
+// BVH build (serial vs all cores), refit and query times, with the flat SIMD culler as the frustum culling baseline
+inline void runBVHBenchmark()
+{
+	glm::mat4 view_mat = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection_mat = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+	Frustum frustum = Frustum::fromMatrix(projection_mat * view_mat);
+	unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+	const unsigned int queryCount = 10000;
+
+	std::cout << "BVH (" << threadCount << " threads)" << std::endl;
+	const unsigned int objectCounts[] = { 10000, 100000, 1000000 };
+	for (unsigned int objectCount : objectCounts)
+	{
+		std::vector<AABB> bounds(objectCount);
+		FrustumCuller culler;
+		unsigned int state = 1;
+		for (unsigned int i = 0; i < objectCount; i++)
+		{
+			glm::vec3 center(nextBenchmarkRandom(state) * 200.0f - 100.0f, nextBenchmarkRandom(state) * 200.0f - 100.0f, nextBenchmarkRandom(state) * 200.0f - 100.0f);
+			float radius = 0.5f + nextBenchmarkRandom(state) * 1.5f;
+			bounds[i] = AABB::fromSphere(glm::vec4(center, radius));
+			culler.addSphere(center, radius * 1.7320508f); // Sphere around the box, so both find the same objects or more
+		}
+		unsigned int repeats = std::max(3u, 1000000u / objectCount);
+
+		BVH bvh;
+		double serialBuildMilliseconds = measureBestMilliseconds(repeats, [&]() { bvh.build(bounds, 1); });
+		double parallelBuildMilliseconds = measureBestMilliseconds(repeats, [&]() { bvh.build(bounds, threadCount); });
+		double refitMilliseconds = measureBestMilliseconds(repeats, [&]() { bvh.refit(bounds); });
+
+		// Incremental refit of a few objects moving slightly, like the orbiting light
+		std::vector<AABB> moved(bounds.begin(), bounds.begin() + queryCount / 10);
+		double updateMilliseconds = measureBestMilliseconds(repeats, [&]() {
+			for (unsigned int i = 0; i < moved.size(); i++)
+			{
+				moved[i].min.x += 0.01f;
+				moved[i].max.x += 0.01f;
+				bvh.updateObject(i, moved[i]);
+			}
+		});
+
+		std::vector<unsigned int> visibleBVH;
+		std::vector<unsigned int> visibleFlat;
+		double bvhCullMilliseconds = measureBestMilliseconds(repeats, [&]() { bvh.cullFrustum(frustum, visibleBVH); });
+		double flatCullMilliseconds = measureBestMilliseconds(repeats, [&]() { culler.cull(frustum, visibleFlat); });
+
+		// Rays from the origin in random directions, range queries around random points
+		std::vector<glm::vec3> directions(queryCount);
+		std::vector<glm::vec3> points(queryCount);
+		for (unsigned int i = 0; i < queryCount; i++)
+		{
+			directions[i] = glm::normalize(glm::vec3(nextBenchmarkRandom(state) - 0.5f, nextBenchmarkRandom(state) - 0.5f, nextBenchmarkRandom(state) - 0.5f) + glm::vec3(1e-4f));
+			points[i] = glm::vec3(nextBenchmarkRandom(state) * 200.0f - 100.0f, nextBenchmarkRandom(state) * 200.0f - 100.0f, nextBenchmarkRandom(state) * 200.0f - 100.0f);
+		}
+		unsigned int hits = 0;
+		double rayMilliseconds = measureBestMilliseconds(3, [&]() {
+			hits = 0;
+			RayHit hit;
+			for (const glm::vec3& direction : directions)
+			{
+				hits += bvh.raycast(glm::vec3(0.0f), direction, hit) ? 1 : 0;
+			}
+		});
+		size_t rangeResults = 0;
+		std::vector<unsigned int> inRange;
+		double rangeMilliseconds = measureBestMilliseconds(3, [&]() {
+			rangeResults = 0;
+			for (const glm::vec3& point : points)
+			{
+				bvh.queryRange(point, 5.0f, inRange);
+				rangeResults += inRange.size();
+			}
+		});
+
+		std::cout << "  " << objectCount << " objects, " << bvh.getNodeCount() << " nodes, SAH cost " << bvh.computeCost() << std::endl
+			<< "    build: " << serialBuildMilliseconds << " ms serial, " << parallelBuildMilliseconds << " ms parallel (" << serialBuildMilliseconds / parallelBuildMilliseconds << "x)" << std::endl
+			<< "    refit: " << refitMilliseconds << " ms full, " << updateMilliseconds * 1000.0 / moved.size() << " us per moved object" << std::endl
+			<< "    frustum: " << bvhCullMilliseconds << " ms BVH (" << visibleBVH.size() << " visible), " << flatCullMilliseconds << " ms flat SIMD (" << visibleFlat.size() << " visible)" << std::endl
+			<< "    rays: " << queryCount / rayMilliseconds << " rays/ms (" << hits << " hits)" << std::endl
+			<< "    range: " << queryCount / rangeMilliseconds << " queries/ms (" << rangeResults / (double)queryCount << " objects per query)" << std::endl;
+	}
+}
+
+// Drop a file's pages from the OS page cache, so the next read comes from disk. Only possible on POSIX systems
+inline bool evictFromPageCache(const std::string& path)
+{
+#if defined(_WIN32)
+	return false;
+#else
+	int descriptor = open(path.c_str(), O_RDONLY);
+	if (descriptor < 0)
+	{
+		return false;
+	}
+	bool evicted = posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	close(descriptor);
+	return evicted;
+#endif
+}
+
+// Path for a scratch file in the system's temporary directory, so benchmarks leave nothing behind in the asset tree
+inline std::string getTemporaryFilePath(const std::string& fileName)
+{
+#if defined(_WIN32)
+	const char* directory = std::getenv("TEMP");
+#else
+	const char* directory = std::getenv("TMPDIR");
+	if (!directory || !*directory)
+	{
+		directory = "/tmp";
+	}
+#endif
+	if (!directory || !*directory)
+	{
+		return fileName;
+	}
+	return std::string(directory) + "/" + fileName;
+}
+
+// Loading every asset in a pack from the pack (mapped, consumed in place) vs from the loose files it was built from (read into
+// strings like the Shader constructor does), both with a cold page cache and a warm one. Every byte is read once either way,
+// like glShaderSource/glCompressedTexImage2D would
+inline void runAssetPackBenchmark(const std::string& packPath)
+{
+	std::vector<std::string> names;
+	{
+		AssetPack pack;
+		if (!pack.open(packPath))
+		{
+			return;
+		}
+		for (size_t i = 0; i < pack.getEntryCount(); i++)
+		{
+			names.push_back(pack.getEntryName(i));
+		}
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		bool valid = pack.verify();
+		std::cout << "Asset pack " << packPath << ": " << names.size() << " assets, " << pack.getMappedSize() / 1024 << " KB, content hashes "
+			<< (valid ? "ok" : "MISMATCH") << " (verified in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms)" << std::endl;
+	}
+
+	volatile unsigned int checksum = 0; // Keeps the reads from being optimized away
+	auto loadLoose = [&]()
+	{
+		for (const std::string& name : names)
+		{
+			std::ifstream file(name);
+			std::stringstream stream;
+			stream << file.rdbuf();
+			std::string contents = stream.str();
+			unsigned int sum = 0;
+			for (char c : contents)
+			{
+				sum += (unsigned char)c;
+			}
+			checksum += sum;
+		}
+	};
+	auto loadPack = [&]()
+	{
+		AssetPack pack;
+		pack.open(packPath);
+		for (const std::string& name : names)
+		{
+			AssetView asset = pack.find(name);
+			unsigned int sum = 0;
+			for (size_t i = 0; i < asset.size; i++)
+			{
+				sum += asset.data[i];
+			}
+			checksum += sum;
+		}
+	};
+	auto evictAll = [&]()
+	{
+		bool evicted = evictFromPageCache(packPath);
+		for (const std::string& name : names)
+		{
+			evicted = evictFromPageCache(name) && evicted;
+		}
+		return evicted;
+	};
+
+	const unsigned int repeats = 5;
+	double coldLoose = 0.0;
+	double coldPack = 0.0;
+	bool cold = true;
+	for (unsigned int i = 0; i < repeats; i++)
+	{
+		cold = evictAll() && cold;
+		double milliseconds = measureBestMilliseconds(1, loadLoose);
+		coldLoose = i == 0 ? milliseconds : std::min(coldLoose, milliseconds);
+		cold = evictAll() && cold;
+		milliseconds = measureBestMilliseconds(1, loadPack);
+		coldPack = i == 0 ? milliseconds : std::min(coldPack, milliseconds);
+	}
+	double warmLoose = measureBestMilliseconds(repeats, loadLoose);
+	double warmPack = measureBestMilliseconds(repeats, loadPack);
+
+	if (cold)
+	{
+		std::cout << "  cold: loose files " << coldLoose << " ms, pack " << coldPack << " ms (" << coldLoose / coldPack << "x)" << std::endl;
+	}
+	else
+	{
+		std::cout << "  cold: not measured, the page cache can't be dropped here" << std::endl;
+	}
+	std::cout << "  warm: loose files " << warmLoose << " ms, pack " << warmPack << " ms (" << warmLoose / warmPack << "x)" << std::endl;
+}
+
+// Mip chain generation: glGenerateMipmap vs generateMipChain() with each filter, for RGBA images of 1K to 8K.
+// Uploading the image itself is timed separately, the CPU path then also has to upload the levels it computed
+inline void runMipBenchmark()
+{
+	std::cout << "Mip generation (" << (const char*)glGetString(GL_RENDERER) << ", " << FrustumCuller::getSimdName() << ")" << std::endl;
+	const int sizes[] = { 1024, 2048, 4096, 8192 };
+	const MipFilter filters[] = { MIP_FILTER_BOX, MIP_FILTER_KAISER, MIP_FILTER_LANCZOS };
+	const char* filterNames[] = { "box", "Kaiser", "Lanczos" };
+	unsigned int texture = 0;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	for (int size : sizes)
+	{
+		// Gradient plus noise, so neither filter gets a trivially uniform image
+		std::vector<unsigned char> image((size_t)size * size * 4);
+		unsigned int state = 1;
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				unsigned char* texel = &image[((size_t)y * size + x) * 4];
+				unsigned char noise = (unsigned char)(nextBenchmarkRandom(state) * 64.0f);
+				texel[0] = (unsigned char)(x * 191 / size + noise);
+				texel[1] = (unsigned char)(y * 191 / size + noise);
+				texel[2] = (unsigned char)((x ^ y) & 0x7F) + noise;
+				texel[3] = (x / 16 + y / 16) % 2 ? 255 : noise;
+			}
+		}
+		unsigned int repeats = size <= 2048 ? 3 : 1;
+
+		double uploadMilliseconds = measureBestMilliseconds(repeats, [&]() {
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.data());
+			glFinish();
+		});
+		double glMilliseconds = measureBestMilliseconds(repeats, [&]() {
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.data());
+			glGenerateMipmap(GL_TEXTURE_2D);
+			glFinish();
+		}) - uploadMilliseconds;
+		std::cout << "  " << size << "x" << size << ": upload " << uploadMilliseconds << " ms, glGenerateMipmap " << glMilliseconds << " ms" << std::endl;
+
+		for (int i = 0; i < 3; i++)
+		{
+			MipSettings settings;
+			settings.filter = filters[i];
+			settings.alphaCoverageReference = i == 0 ? 0.0f : 0.5f;
+			std::vector<MipLevel> mips;
+			double generateMilliseconds = measureBestMilliseconds(repeats, [&]() { mips = generateMipChain(image.data(), size, size, 4, settings); });
+			double levelUploadMilliseconds = measureBestMilliseconds(repeats, [&]() {
+				for (size_t level = 0; level < mips.size(); level++)
+				{
+					glTexImage2D(GL_TEXTURE_2D, (GLint)level + 1, GL_RGBA, mips[level].width, mips[level].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, mips[level].pixels.data());
+				}
+				glFinish();
+			});
+			std::cout << "    " << filterNames[i] << (settings.alphaCoverageReference > 0.0f ? " + alpha coverage" : "") << ": " << generateMilliseconds
+				<< " ms on the CPU + " << levelUploadMilliseconds << " ms uploading the levels (" << glMilliseconds / (generateMilliseconds + levelUploadMilliseconds) << "x)" << std::endl;
+		}
+	}
+	glDeleteTextures(1, &texture);
+}
+
+// Startup texture loading: imageCount images loaded synchronously with the Texture constructor, then through TextureLoader
+// with one decode thread and with one per core, through TextureManager (only the distinct images are loaded) and from cooked
+// containers (cooked next to the sources first, as <image>.rtex). Time until every texture is resident, and the memory the textures then take
+// with the decoded pixels released after upload (default) and retained
+inline void runTextureLoadingBenchmark(unsigned int imageCount)
+{
+	const char* imagePaths[] = { "textures/container.jpg", "textures/awesomeface.png" };
+
+	// The Texture constructor reports every image, keep the output readable
+	std::streambuf* coutBuffer = std::cout.rdbuf(NULL);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	double serialMilliseconds = 0.0;
+	TextureMemoryUsage released;
+	TextureMemoryUsage retained;
+	{
+		std::vector<std::unique_ptr<Texture>> textures;
+		for (unsigned int i = 0; i < imageCount; i++)
+		{
+			textures.emplace_back(new Texture(imagePaths[i % 2]));
+		}
+		glFinish();
+		serialMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		released = TextureMemory::getTotal();
+	}
+	{
+		std::vector<std::unique_ptr<Texture>> textures;
+		for (unsigned int i = 0; i < imageCount; i++)
+		{
+			textures.emplace_back(new Texture(imagePaths[i % 2], TEXTURE_RETAIN_PIXELS));
+		}
+		retained = TextureMemory::getTotal();
+	}
+	start = std::chrono::steady_clock::now();
+	TextureCacheStats cacheStats;
+	size_t cachedTextureCount = 0;
+	TextureMemoryUsage cached;
+	{
+		TextureManager manager;
+		std::vector<std::shared_ptr<Texture>> textures;
+		for (unsigned int i = 0; i < imageCount; i++)
+		{
+			textures.push_back(manager.get(imagePaths[i % 2]));
+		}
+		glFinish();
+		cacheStats = manager.getStats();
+		cachedTextureCount = manager.getTextureCount();
+		cached = TextureMemory::getTotal();
+	}
+	double cachedMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::string cookedPaths[2];
+	for (int i = 0; i < 2; i++)
+	{
+		cookedPaths[i] = getTemporaryFilePath("RenderGL_benchmark_" + std::to_string(i) + ".rtex");
+		cookTexture(imagePaths[i], cookedPaths[i]);
+	}
+	start = std::chrono::steady_clock::now();
+	TextureMemoryUsage cooked;
+	{
+		std::vector<std::unique_ptr<Texture>> textures;
+		for (unsigned int i = 0; i < imageCount; i++)
+		{
+			textures.emplace_back(new Texture(cookedPaths[i % 2]));
+		}
+		glFinish();
+		cooked = TextureMemory::getTotal();
+	}
+	double cookedMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	for (int i = 0; i < 2; i++)
+	{
+		std::remove(cookedPaths[i].c_str());
+	}
+
+	std::cout.rdbuf(coutBuffer);
+	std::cout.clear();
+	std::cout << "Texture loading, " << imageCount << " images" << std::endl
+		<< "  synchronous: " << serialMilliseconds << " ms" << std::endl
+		<< "  cached: " << cachedMilliseconds << " ms, " << cachedTextureCount << " textures (" << cacheStats.misses << " loads, " << cacheStats.pathHits << " path hits, "
+		<< cacheStats.contentHits << " content hits), " << cached.gpuBytes / 1024 << " KB GPU" << std::endl
+		<< "  cooked" << (Texture::isS3TCSupported() ? "" : " (no S3TC, decompressed on load)") << ": " << cookedMilliseconds << " ms, " << cooked.gpuBytes / 1024 << " KB GPU" << std::endl
+		<< "  memory: " << released.cpuBytes / 1024 << " KB CPU, " << released.gpuBytes / 1024 << " KB GPU released after upload, "
+		<< retained.cpuBytes / 1024 << " KB CPU, " << retained.gpuBytes / 1024 << " KB GPU retained" << std::endl;
+
+	std::vector<unsigned int> threadCounts(1, 1);
+	if (std::thread::hardware_concurrency() > 1)
+	{
+		threadCounts.push_back(std::thread::hardware_concurrency());
+	}
+	for (unsigned int run = 0; run < threadCounts.size() * 2; run++)
+	{
+		// Each thread count with glGenerateMipmap, then with the mip chains computed on the decode threads
+		unsigned int threadCount = threadCounts[run / 2];
+		bool cpuMips = run % 2 == 1;
+		ThreadPool pool(threadCount);
+		start = std::chrono::steady_clock::now();
+		unsigned int frames = 0;
+		{
+			TextureLoader loader(pool);
+			if (cpuMips)
+			{
+				loader.enableCPUMips(MipSettings());
+			}
+			std::vector<std::shared_ptr<Texture>> textures;
+			for (unsigned int i = 0; i < imageCount; i++)
+			{
+				textures.push_back(loader.load(imagePaths[i % 2]));
+			}
+			double requestMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			// What the render loop would do: one budgeted update per frame
+			while (loader.getPendingCount() > 0)
+			{
+				if (loader.update() > 0)
+				{
+					frames++;
+				}
+				else
+				{
+					std::this_thread::yield();
+				}
+			}
+			glFinish();
+			std::cout << "  " << threadCount << " decode thread(s)" << (cpuMips ? ", CPU mips" : "") << ": " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+				<< " ms, requests returned after " << requestMilliseconds << " ms, uploads spread over " << frames << " frames" << std::endl;
+		}
+	}
+}
+
+// Mesh import throughput on an OBJ or GLB file, best suited to large ones (scans of hundreds of MB). The file is read once, then
+// parsed from memory by one thread and by more, in MB of file per second. Building (normals, vertex merging) is reported separately,
+// it's mostly serial. Every thread count has to produce exactly the single threaded result
+inline void runMeshImportBenchmark(const std::string& path)
+{
+	std::vector<char> data;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (!MeshImporter::readFile(path, data))
+	{
+		std::cout << "ERROR::MESH_IMPORTER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+		return;
+	}
+	double readMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	double megabytes = data.size() / (1024.0 * 1024.0);
+	std::cout << "Mesh import " << path << ": " << megabytes << " MB, read in " << readMilliseconds << " ms" << std::endl;
+
+	// Powers of two up to one thread per core, at least one multi-threaded run so the chunked path is always checked
+	unsigned int maxThreadCount = std::max(2u, std::thread::hardware_concurrency());
+	std::vector<unsigned int> threadCounts(1, 1);
+	for (unsigned int threadCount = 2; threadCount < maxThreadCount; threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
+	}
+	threadCounts.push_back(maxThreadCount);
+
+	ImportedGeometry reference;
+	double singleThreadedMilliseconds = 0.0;
+	for (unsigned int threadCount : threadCounts)
+	{
+		std::unique_ptr<ThreadPool> pool(threadCount > 1 ? new ThreadPool(threadCount) : nullptr);
+		MeshImporter importer(pool.get());
+		const unsigned int repeats = 3;
+		MeshImportStats best;
+		for (unsigned int i = 0; i < repeats; i++)
+		{
+			ImportedGeometry geometry;
+			if (!importer.parse(data.data(), data.size(), getMeshFileType(path), geometry))
+			{
+				return;
+			}
+			const MeshImportStats& stats = importer.getStats();
+			if (i == 0 || stats.parseMilliseconds < best.parseMilliseconds)
+			{
+				best = stats;
+			}
+			if (threadCount == 1 && i == 0)
+			{
+				reference = std::move(geometry);
+			}
+			else if (i == 0 && (geometry.indices != reference.indices || geometry.positions.size() != reference.positions.size()
+				|| memcmp(geometry.positions.data(), reference.positions.data(), geometry.positions.size() * sizeof(glm::vec3)) != 0
+				|| memcmp(geometry.normals.data(), reference.normals.data(), geometry.normals.size() * sizeof(glm::vec3)) != 0))
+			{
+				std::cout << "ERROR::MESH_IMPORTER::RESULT_DIFFERS_FROM_SINGLE_THREADED (" << threadCount << " threads)" << std::endl;
+			}
+		}
+		if (threadCount == 1)
+		{
+			singleThreadedMilliseconds = best.parseMilliseconds;
+			std::cout << "  " << best.triangleCount << " triangles, " << best.vertexCount << " vertices" << (best.computedNormals ? " (computed normals)" : "") << std::endl;
+		}
+		std::cout << "  " << threadCount << " thread(s): parse " << best.parseMilliseconds << " ms (" << megabytes / (best.parseMilliseconds / 1000.0) << " MB/s, "
+			<< singleThreadedMilliseconds / best.parseMilliseconds << "x), build " << best.buildMilliseconds << " ms" << std::endl;
+	}
+}
+
+// Compression and single-threaded decoding speed of the mesh codecs (MeshCodec.h), on a cooked mesh or on a source mesh that is cooked
+// in memory with the given vertex format first. Decodes into plain memory, so it's the codecs alone without mapping GPU buffers
+inline void runMeshCodecBenchmark(const std::string& path, VertexFormat format)
+{
+	std::vector<unsigned char> bytes;
+	if (getMeshFileType(path) == MESH_FILE_COOKED)
+	{
+		std::vector<char> data;
+		if (!MeshImporter::readFile(path, data))
+		{
+			std::cout << "ERROR::MESH_COOKER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+			return;
+		}
+		bytes.assign(data.begin(), data.end());
+	}
+	else
+	{
+		ThreadPool pool;
+		MeshImporter importer(&pool);
+		MeshData mesh;
+		if (!importer.import(path, mesh))
+		{
+			return;
+		}
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		cookMeshData(mesh, format, bytes);
+		std::cout << "Mesh codecs " << path << ": cooked in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+	}
+	CookedMeshView view;
+	if (!parseCookedMesh(bytes.data(), bytes.size(), view))
+	{
+		std::cout << "ERROR::MESH_COOKER::INVALID_CONTAINER " << path << std::endl;
+		return;
+	}
+
+	size_t vertexSize = view.format.getVertexSize();
+	bool shortIndices = view.vertexCount <= 0xFFFF;
+	std::vector<unsigned char> vertices(view.vertexCount * vertexSize);
+	std::vector<unsigned int> indices(view.indexCount); // Also the storage for 16-bit indices
+	size_t indexBytes = view.indexCount * (shortIndices ? sizeof(unsigned short) : sizeof(unsigned int));
+	size_t triangleCount = std::max<size_t>(view.indexCount / 3, 1);
+	std::cout << "Mesh codecs " << path << ": " << view.indexCount / 3 << " triangles, " << view.vertexCount << " vertices (" << vertexSize << " bytes each)" << std::endl;
+	std::cout << "  vertices " << vertices.size() << " -> " << view.vertexStreamSize << " bytes (" << (double)vertices.size() / view.vertexStreamSize << ":1), indices "
+		<< indexBytes << " -> " << view.indexStreamSize << " bytes (" << view.indexStreamSize * 8.0 / triangleCount << " bits per triangle)" << std::endl;
+
+	const unsigned int repeats = 10;
+	double vertexMilliseconds = 0.0;
+	double indexMilliseconds = 0.0;
+	for (unsigned int i = 0; i < repeats; i++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		bool decoded = decodeVertexBuffer(vertices.data(), view.vertexCount, vertexSize, view.vertexStream, view.vertexStreamSize);
+		std::chrono::steady_clock::time_point vertexEnd = std::chrono::steady_clock::now();
+		decoded = decoded && (shortIndices ? decodeIndexBuffer((unsigned short*)indices.data(), view.indexCount, view.vertexCount, view.indexStream, view.indexStreamSize)
+			: decodeIndexBuffer(indices.data(), view.indexCount, view.vertexCount, view.indexStream, view.indexStreamSize));
+		std::chrono::steady_clock::time_point indexEnd = std::chrono::steady_clock::now();
+		if (!decoded)
+		{
+			std::cout << "ERROR::MESH_COOKER::CORRUPT_STREAM " << path << std::endl;
+			return;
+		}
+		double vertexTime = std::chrono::duration<double, std::milli>(vertexEnd - start).count();
+		double indexTime = std::chrono::duration<double, std::milli>(indexEnd - vertexEnd).count();
+		vertexMilliseconds = i == 0 ? vertexTime : std::min(vertexMilliseconds, vertexTime);
+		indexMilliseconds = i == 0 ? indexTime : std::min(indexMilliseconds, indexTime);
+	}
+	const double gigabyte = 1024.0 * 1024.0 * 1024.0;
+	std::cout << "  decode (1 thread): vertices " << vertexMilliseconds << " ms (" << vertices.size() / gigabyte / (vertexMilliseconds / 1000.0) << " GB/s), indices "
+		<< indexMilliseconds << " ms (" << indexBytes / gigabyte / (indexMilliseconds / 1000.0) << " GB/s), total "
+		<< (vertices.size() + indexBytes) / gigabyte / ((vertexMilliseconds + indexMilliseconds) / 1000.0) << " GB/s" << std::endl;
+
+	// The vertex encoding is deterministic, so the decoded vertices have to encode into the same stream again
+	std::vector<unsigned char> reencoded;
+	encodeVertexBuffer(vertices.data(), view.vertexCount, vertexSize, reencoded);
+	if (reencoded.size() != view.vertexStreamSize || memcmp(reencoded.data(), view.vertexStream, reencoded.size()) != 0)
+	{
+		std::cout << "ERROR::MESH_CODEC::VERTEX_ROUND_TRIP_MISMATCH" << std::endl;
+	}
+}
+
+#endif
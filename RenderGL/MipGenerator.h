@@ -0,0 +1,387 @@
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_GENERATOR_SSE 1
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define MIP_GENERATOR_AVX2 1
+#include <immintrin.h>
+#endif
+
+// CPU mip chain generation, a replacement for glGenerateMipmap (whose filter is up to the driver and which is slow on software
+// GL) that can run on the texture loading threads. Every level is computed from the previous one in linear float RGBA:
+// separable 2:1 downsampling, vertical pass first (whole rows, 8 floats at a time with AVX2) then horizontal (one RGBA texel
+// per SSE register). Texels outside the image repeat the edge
+
+enum MipFilter
+{
+	MIP_FILTER_BOX,     // 2x2 average, what drivers usually do
+	MIP_FILTER_KAISER,  // Kaiser windowed sinc, 8 taps: sharper, little ringing (default)
+	MIP_FILTER_LANCZOS  // Lanczos 2, 8 taps: sharpest, some ringing
+};
+
+struct MipSettings
+{
+	MipFilter filter = MIP_FILTER_KAISER;
+	bool srgb = true;                    // RGB are sRGB encoded, so they are filtered after decoding to linear. Alpha is always linear
+	float alphaCoverageReference = 0.0f; // > 0: scale the alpha of every level so the fraction of texels with alpha >= this stays
+	                                     // the same as in the image (alpha tested foliage/fences would thin out with distance otherwise)
+};
+
+// One level below the image, tightly packed with the image's channel count
+struct MipLevel
+{
+	int width = 0;
+	int height = 0;
+	std::vector<unsigned char> pixels;
+};
+
+// Filter taps for a 2:1 reduction: destination texel x is the weighted sum of source texels 2x + firstOffset ... 2x + firstOffset + tapCount - 1
+struct MipKernel
+{
+	int firstOffset = 0;
+	int tapCount = 0;
+	float weights[8];
+};
+
+inline float mipSinc(float x)
+{
+	if (std::abs(x) < 1e-5f)
+	{
+		return 1.0f;
+	}
+	float pix = 3.14159265f * x;
+	return std::sin(pix) / pix;
+}
+
+// Modified Bessel function of the first kind, order 0 (power series)
+inline float mipBesselI0(float x)
+{
+	float sum = 1.0f;
+	float term = 1.0f;
+	for (int k = 1; k < 20; k++)
+	{
+		term *= (x / (2.0f * k)) * (x / (2.0f * k));
+		sum += term;
+	}
+	return sum;
+}
+
+inline MipKernel makeMipKernel(MipFilter filter)
+{
+	MipKernel kernel;
+	if (filter == MIP_FILTER_BOX)
+	{
+		kernel.firstOffset = 0;
+		kernel.tapCount = 2;
+		kernel.weights[0] = 0.5f;
+		kernel.weights[1] = 0.5f;
+		return kernel;
+	}
+
+	// Source texels 3.5 to 0.5 texels left and right of the destination texel center, t in destination texels
+	kernel.firstOffset = -3;
+	kernel.tapCount = 8;
+	const float radius = 2.0f;
+	const float beta = 4.0f;
+	float sum = 0.0f;
+	for (int k = 0; k < 8; k++)
+	{
+		float t = (k - 3.5f) * 0.5f;
+		float window = filter == MIP_FILTER_LANCZOS ? mipSinc(t / radius)
+			: mipBesselI0(beta * std::sqrt(std::max(0.0f, 1.0f - (t / radius) * (t / radius)))) / mipBesselI0(beta);
+		kernel.weights[k] = mipSinc(t) * window;
+		sum += kernel.weights[k];
+	}
+	for (int k = 0; k < 8; k++)
+	{
+		kernel.weights[k] /= sum;
+	}
+	return kernel;
+}
+
+// sRGB <-> linear for 8 bit values, table driven
+struct MipColorTables
+{
+	float toLinear[256];
+	unsigned char fromLinear[4096]; // Indexed by linear * 4095
+
+	MipColorTables()
+	{
+		for (int i = 0; i < 256; i++)
+		{
+			float c = i / 255.0f;
+			toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		for (int i = 0; i < 4096; i++)
+		{
+			float c = i / 4095.0f;
+			float encoded = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+			fromLinear[i] = (unsigned char)std::min(255.0f, encoded * 255.0f + 0.5f);
+		}
+	}
+
+	static const MipColorTables& get()
+	{
+		static MipColorTables tables;
+		return tables;
+	}
+};
+
+// result[i] = sum over taps of weights[k] * rows[k][i], for count floats
+inline void filterMipRows(const float* const* rows, const MipKernel& kernel, float* result, size_t count)
+{
+	size_t i = 0;
+#if defined(MIP_GENERATOR_AVX2)
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 sum = _mm256_mul_ps(_mm256_loadu_ps(rows[0] + i), _mm256_set1_ps(kernel.weights[0]));
+		for (int k = 1; k < kernel.tapCount; k++)
+		{
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(rows[k] + i), _mm256_set1_ps(kernel.weights[k]))); // FMA isn't part of AVX2
+		}
+		_mm256_storeu_ps(result + i, sum);
+	}
+#endif
+#if defined(MIP_GENERATOR_SSE)
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 sum = _mm_mul_ps(_mm_loadu_ps(rows[0] + i), _mm_set1_ps(kernel.weights[0]));
+		for (int k = 1; k < kernel.tapCount; k++)
+		{
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows[k] + i), _mm_set1_ps(kernel.weights[k])));
+		}
+		_mm_storeu_ps(result + i, sum);
+	}
+#endif
+	for (; i < count; i++)
+	{
+		float sum = 0.0f;
+		for (int k = 0; k < kernel.tapCount; k++)
+		{
+			sum += rows[k][i] * kernel.weights[k];
+		}
+		result[i] = sum;
+	}
+}
+
+// Halve a row of RGBA float texels
+inline void filterMipColumns(const float* row, int width, const MipKernel& kernel, float* result, int resultWidth)
+{
+	for (int x = 0; x < resultWidth; x++)
+	{
+		int first = x * 2 + kernel.firstOffset;
+#if defined(MIP_GENERATOR_SSE)
+		__m128 sum = _mm_setzero_ps();
+		for (int k = 0; k < kernel.tapCount; k++)
+		{
+			int sourceX = std::min(std::max(first + k, 0), width - 1);
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + sourceX * 4), _mm_set1_ps(kernel.weights[k])));
+		}
+		_mm_storeu_ps(result + x * 4, sum);
+#else
+		float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int k = 0; k < kernel.tapCount; k++)
+		{
+			int sourceX = std::min(std::max(first + k, 0), width - 1);
+			for (int c = 0; c < 4; c++)
+			{
+				sum[c] += row[sourceX * 4 + c] * kernel.weights[k];
+			}
+		}
+		for (int c = 0; c < 4; c++)
+		{
+			result[x * 4 + c] = sum[c];
+		}
+#endif
+	}
+}
+
+// One 2:1 reduction. getRow(y) returns source row y (0 <= y < height) as RGBA floats
+template <typename RowFunction>
+void downsampleMipLevel(RowFunction getRow, int width, int height, const MipKernel& kernel, std::vector<float>& result, int resultWidth, int resultHeight)
+{
+	result.resize((size_t)resultWidth * resultHeight * 4);
+	std::vector<float> column((size_t)width * 4);
+	const float* rows[8];
+	for (int y = 0; y < resultHeight; y++)
+	{
+		int first = y * 2 + kernel.firstOffset;
+		for (int k = 0; k < kernel.tapCount; k++)
+		{
+			rows[k] = getRow(std::min(std::max(first + k, 0), height - 1));
+		}
+		filterMipRows(rows, kernel, column.data(), column.size());
+		filterMipColumns(column.data(), width, kernel, &result[(size_t)y * resultWidth * 4], resultWidth);
+	}
+}
+
+// Alpha scale that makes the fraction of texels with alpha * scale >= reference equal to coverage: the alpha value with that
+// fraction of texels above it (from a histogram) should map to reference. Capped at 4x
+inline float computeAlphaCoverageScale(const std::vector<float>& level, float coverage, float reference)
+{
+	const int binCount = 4096;
+	std::vector<unsigned int> histogram(binCount, 0);
+	size_t count = level.size() / 4;
+	for (size_t i = 0; i < count; i++)
+	{
+		float alpha = std::min(std::max(level[i * 4 + 3], 0.0f), 1.0f);
+		histogram[(int)(alpha * (binCount - 1))]++;
+	}
+	size_t covered = 0;
+	size_t target = (size_t)(coverage * count + 0.5f);
+	int bin = binCount - 1;
+	for (; bin > 0; bin--)
+	{
+		covered += histogram[bin];
+		if (covered >= target)
+		{
+			break;
+		}
+	}
+	float threshold = (float)bin / (binCount - 1);
+	return threshold > reference / 4.0f ? reference / threshold : 4.0f;
+}
+
+// 8 bit texels to linear RGBA floats (width texels)
+inline void convertMipRowToFloat(const unsigned char* source, int width, int nChannels, const float* colorToLinear, float* row)
+{
+	int x = 0;
+#if defined(MIP_GENERATOR_AVX2)
+	if (nChannels == 4)
+	{
+		// 2 texels per iteration: table lookups for RGB, alpha / 255 (divided like the scalar loop, so every texel gets the same value)
+		for (; x + 2 <= width; x += 2)
+		{
+			__m256i channelIndices = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(source + x * 4)));
+			__m256 color = _mm256_i32gather_ps(colorToLinear, channelIndices, 4);
+			__m256 alpha = _mm256_div_ps(_mm256_cvtepi32_ps(channelIndices), _mm256_set1_ps(255.0f));
+			_mm256_storeu_ps(row + x * 4, _mm256_blend_ps(color, alpha, 0x88));
+		}
+	}
+#endif
+	for (; x < width; x++)
+	{
+		row[x * 4 + 0] = colorToLinear[source[x * nChannels + 0]];
+		row[x * 4 + 1] = colorToLinear[source[x * nChannels + 1]];
+		row[x * 4 + 2] = colorToLinear[source[x * nChannels + 2]];
+		row[x * 4 + 3] = nChannels == 4 ? source[x * 4 + 3] / 255.0f : 1.0f;
+	}
+}
+
+// Linear RGBA floats back to 8 bit texels, alpha multiplied by alphaScale
+inline void convertMipLevelToBytes(const std::vector<float>& level, int nChannels, bool srgb, float alphaScale, unsigned char* pixels)
+{
+	const unsigned char* fromLinear = MipColorTables::get().fromLinear;
+	size_t count = level.size() / 4;
+	float colorRange = srgb ? 4095.0f : 255.0f;
+#if defined(MIP_GENERATOR_SSE)
+	__m128 scale = _mm_setr_ps(colorRange, colorRange, colorRange, 255.0f * alphaScale);
+	__m128 maximum = _mm_setr_ps(colorRange, colorRange, colorRange, 255.0f);
+#endif
+	for (size_t i = 0; i < count; i++)
+	{
+		// Table index (sRGB) or byte value per channel
+		alignas(16) int values[4];
+#if defined(MIP_GENERATOR_SSE)
+		__m128 scaled = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(&level[i * 4]), scale), _mm_setzero_ps()), maximum);
+		_mm_store_si128((__m128i*)values, _mm_cvtps_epi32(scaled));
+#else
+		for (int c = 0; c < 4; c++)
+		{
+			float value = level[i * 4 + c] * (c < 3 ? colorRange : 255.0f * alphaScale);
+			values[c] = (int)(std::min(std::max(value, 0.0f), c < 3 ? colorRange : 255.0f) + 0.5f);
+		}
+#endif
+		unsigned char* texel = pixels + i * nChannels;
+		for (int c = 0; c < 3; c++)
+		{
+			texel[c] = srgb ? fromLinear[values[c]] : (unsigned char)values[c];
+		}
+		if (nChannels == 4)
+		{
+			texel[3] = (unsigned char)values[3];
+		}
+	}
+}
+
+// Mip chain of an 8 bit image with 3 or 4 channels, levels 1 (half size) down to 1x1. The image itself is level 0
+inline std::vector<MipLevel> generateMipChain(const unsigned char* pixels, int width, int height, int nChannels, const MipSettings& settings = MipSettings())
+{
+	const MipColorTables& tables = MipColorTables::get();
+	MipKernel kernel = makeMipKernel(settings.filter);
+	float linear[256];
+	for (int i = 0; i < 256; i++)
+	{
+		linear[i] = i / 255.0f;
+	}
+	const float* colorToLinear = settings.srgb ? tables.toLinear : linear;
+
+	float targetCoverage = 0.0f;
+	bool preserveCoverage = settings.alphaCoverageReference > 0.0f && nChannels == 4;
+	if (preserveCoverage)
+	{
+		size_t covered = 0;
+		for (size_t i = 0; i < (size_t)width * height; i++)
+		{
+			covered += pixels[i * 4 + 3] / 255.0f >= settings.alphaCoverageReference ? 1 : 0;
+		}
+		targetCoverage = (float)covered / ((size_t)width * height);
+	}
+
+	// The 8 bit image is converted a row at a time as the filter reaches it, the last 16 rows are kept
+	const int cachedRowCount = 16;
+	std::vector<float> rowCache((size_t)cachedRowCount * width * 4);
+	int cachedRows[cachedRowCount];
+	std::fill(cachedRows, cachedRows + cachedRowCount, -1);
+	auto getImageRow = [&](int y) -> const float*
+	{
+		float* row = &rowCache[(size_t)(y % cachedRowCount) * width * 4];
+		if (cachedRows[y % cachedRowCount] != y)
+		{
+			convertMipRowToFloat(pixels + (size_t)y * width * nChannels, width, nChannels, colorToLinear, row);
+			cachedRows[y % cachedRowCount] = y;
+		}
+		return row;
+	};
+
+	std::vector<MipLevel> levels;
+	std::vector<float> level;
+	std::vector<float> nextLevel;
+	while (width > 1 || height > 1)
+	{
+		int nextWidth = std::max(1, width / 2);
+		int nextHeight = std::max(1, height / 2);
+		if (levels.empty())
+		{
+			downsampleMipLevel(getImageRow, width, height, kernel, nextLevel, nextWidth, nextHeight);
+		}
+		else
+		{
+			int levelWidth = width;
+			downsampleMipLevel([&](int y) { return &level[(size_t)y * levelWidth * 4]; }, width, height, kernel, nextLevel, nextWidth, nextHeight);
+		}
+		level.swap(nextLevel);
+		width = nextWidth;
+		height = nextHeight;
+
+		// Only the output is rescaled, the next level filters the unscaled alpha
+		float alphaScale = preserveCoverage ? computeAlphaCoverageScale(level, targetCoverage, settings.alphaCoverageReference) : 1.0f;
+
+		levels.push_back(MipLevel());
+		MipLevel& mip = levels.back();
+		mip.width = width;
+		mip.height = height;
+		mip.pixels.resize((size_t)width * height * nChannels);
+		convertMipLevelToBytes(level, nChannels, settings.srgb, alphaScale, mip.pixels.data());
+	}
+	return levels;
+}
+
+#endif
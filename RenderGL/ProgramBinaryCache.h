@@ -0,0 +1,220 @@
+#ifndef PROGRAM_BINARY_CACHE_H
+#define PROGRAM_BINARY_CACHE_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+
+#if defined(_WIN32)
+#include <direct.h> // _mkdir
+#else
+#include <sys/stat.h> // mkdir
+#endif
+
+#include "GLExtensions.h"
+
+#define PROGRAM_BINARY_MAGIC 0x43425052u // "RPBC"
+#define PROGRAM_BINARY_VERSION 1u
+#define DEFAULT_PROGRAM_BINARY_CACHE_DIRECTORY "shadercache"
+
+// Header of a cached program binary file, the driver's binary follows
+struct ProgramBinaryHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;          // Same as in the file name, guards against renamed or stale files
+	uint32_t binaryFormat; // As reported by glGetProgramBinary
+	uint32_t binarySize;
+};
+
+struct ProgramBinaryCacheStats
+{
+	unsigned int hits = 0;     // Programs loaded from a binary
+	unsigned int misses = 0;   // No binary yet, compiled from source
+	unsigned int rejected = 0; // Binary the driver refused (e.g. after a driver update), compiled from source
+	unsigned int stored = 0;
+};
+
+// Persistent cache of linked program binaries (ARB_get_program_binary), one file per program in a directory. Programs are keyed
+// by a hash of their exact sources (so #defines in them are covered) and the driver's vendor, renderer and version strings,
+// a driver update or a different GPU just misses. Loading a binary skips compiling and linking, which dominates startup on
+// drivers with slow shader compilers. Without driver support every load misses and nothing is stored
+class ProgramBinaryCache
+{
+public:
+	ProgramBinaryCache(const std::string& directory_in = DEFAULT_PROGRAM_BINARY_CACHE_DIRECTORY) :
+		directory(directory_in)
+	{
+		if (!isSupported())
+		{
+			return;
+		}
+#if defined(_WIN32)
+		_mkdir(directory.c_str());
+#else
+		mkdir(directory.c_str(), 0755);
+#endif
+		// Everything the driver's binaries depend on besides the sources
+		driverHash = hashBytes(glGetString(GL_VENDOR), driverHash);
+		driverHash = hashBytes(glGetString(GL_RENDERER), driverHash);
+		driverHash = hashBytes(glGetString(GL_VERSION), driverHash);
+		driverHash = hashBytes(glGetString(GL_SHADING_LANGUAGE_VERSION), driverHash);
+	}
+	ProgramBinaryCache(const ProgramBinaryCache&) = delete;
+	ProgramBinaryCache& operator=(const ProgramBinaryCache&) = delete;
+
+	// Needs loadGLExtensions() to have run
+	static bool isSupported()
+	{
+		return getGLExtensions().programBinary;
+	}
+
+	// Key of the program linked from these sources on this driver
+	uint64_t getKey(const char* vertexSource, int vertexLength, const char* fragmentSource, int fragmentLength) const
+	{
+		uint64_t hash = driverHash;
+		hash = hashBytes((const unsigned char*)vertexSource, (size_t)vertexLength, hash);
+		hash = hashBytes((const unsigned char*)"\0", 1, hash); // So moving text between the stages changes the key
+		hash = hashBytes((const unsigned char*)fragmentSource, (size_t)fragmentLength, hash);
+		return hash;
+	}
+
+	// New linked program from the cached binary, 0 if there is none or the driver rejects it (compile from source then)
+	unsigned int load(uint64_t key)
+	{
+		if (!isSupported())
+		{
+			return 0;
+		}
+		std::ifstream file(getPath(key), std::ios::binary);
+		ProgramBinaryHeader header;
+		if (!file || !file.read((char*)&header, sizeof(header)) || header.magic != PROGRAM_BINARY_MAGIC
+			|| header.version != PROGRAM_BINARY_VERSION || header.key != key)
+		{
+			stats.misses++;
+			return 0;
+		}
+		// The binary is the rest of the file. A damaged size must not turn into a huge allocation
+		std::streampos binaryStart = file.tellg();
+		file.seekg(0, std::ios::end);
+		std::streamoff remaining = file.tellg() - binaryStart;
+		file.seekg(binaryStart);
+		if (!file || remaining != (std::streamoff)header.binarySize)
+		{
+			stats.misses++;
+			return 0;
+		}
+		std::vector<char> binary(header.binarySize);
+		if (!file.read(binary.data(), binary.size()))
+		{
+			stats.misses++;
+			return 0;
+		}
+
+		unsigned int program = glCreateProgram();
+		getGLExtensions().programBinaryLoad(program, (GLenum)header.binaryFormat, binary.data(), (GLsizei)binary.size());
+		int success = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			glDeleteProgram(program);
+			stats.rejected++;
+			return 0;
+		}
+		stats.hits++;
+		return program;
+	}
+
+	// Call before linking a program that will be stored, some drivers only keep the binary around when asked to
+	void prepare(unsigned int program)
+	{
+		if (isSupported())
+		{
+			getGLExtensions().programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+	}
+
+	// Write the binary of a successfully linked program
+	void store(uint64_t key, unsigned int program)
+	{
+		if (!isSupported())
+		{
+			return;
+		}
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+		{
+			return;
+		}
+		std::vector<char> binary(length);
+		GLenum binaryFormat = 0;
+		getGLExtensions().getProgramBinary(program, length, &length, &binaryFormat, binary.data());
+
+		ProgramBinaryHeader header;
+		header.magic = PROGRAM_BINARY_MAGIC;
+		header.version = PROGRAM_BINARY_VERSION;
+		header.key = key;
+		header.binaryFormat = binaryFormat;
+		header.binarySize = (uint32_t)length;
+
+		// Written under a temporary name and renamed, so a crash never leaves a truncated binary behind
+		std::string path = getPath(key);
+		std::string temporaryPath = path + ".tmp";
+		{
+			std::ofstream file(temporaryPath, std::ios::binary);
+			file.write((const char*)&header, sizeof(header));
+			file.write(binary.data(), length);
+			if (!file)
+			{
+				std::cout << "Failed to write program binary: " << temporaryPath << std::endl;
+				return;
+			}
+		}
+		std::remove(path.c_str()); // rename() doesn't replace existing files on Windows
+		if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+		{
+			std::cout << "Failed to write program binary: " << path << std::endl;
+			return;
+		}
+		stats.stored++;
+	}
+
+	const ProgramBinaryCacheStats& getStats() const
+	{
+		return stats;
+	}
+
+private:
+	std::string getPath(uint64_t key) const
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+		return directory + "/" + name;
+	}
+
+	// 64 bit FNV-1a, continued from hash
+	static uint64_t hashBytes(const unsigned char* bytes, size_t size, uint64_t hash)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+		return hash;
+	}
+	static uint64_t hashBytes(const GLubyte* string, uint64_t hash)
+	{
+		return string ? hashBytes(string, strlen((const char*)string) + 1, hash) : hash;
+	}
+
+	std::string directory;
+	uint64_t driverHash = 14695981039346656037ull;
+	ProgramBinaryCacheStats stats;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+// Per-object data, laid out exactly like the instanced vertex attributes (model matrix in locations 2-5, color in 6)
+struct InstanceData
+{
+	glm::mat4 model_mat;
+	glm::vec4 color; // rgb, w unused (keeps the stride a multiple of 16 bytes)
+};
+
+// Bounding sphere (xyz = center, w = radius) transformed by a model matrix. The radius grows with the largest axis scale
+inline glm::vec4 transformBoundingSphere(const glm::mat4& model_mat, const glm::vec4& sphere)
+{
+	glm::vec3 center = glm::vec3(model_mat * glm::vec4(glm::vec3(sphere), 1.0f));
+	float scale = std::max(glm::length(glm::vec3(model_mat[0])), std::max(glm::length(glm::vec3(model_mat[1])), glm::length(glm::vec3(model_mat[2]))));
+	return glm::vec4(center, sphere.w * scale);
+}
+
+// The lit objects to draw each frame
+class Scene
+{
+public:
+	void addObject(const glm::mat4& model_mat, const glm::vec3& color)
+	{
+		InstanceData instance;
+		instance.model_mat = model_mat;
+		instance.color = glm::vec4(color, 1.0f);
+		instances.push_back(instance);
+	}
+
+	// Stress scene: a grid of count randomly rotated, colored cubes in front of the camera.
+	// Uses its own LCG instead of rand(), so every run (and platform) gets the exact same scene
+	void spawnCubeGrid(unsigned int count, unsigned int seed = 1)
+	{
+		unsigned int side = (unsigned int)ceil(cbrt((double)count));
+		const float spacing = 2.0f;
+		unsigned int state = seed;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int x = i % side;
+			unsigned int y = (i / side) % side;
+			unsigned int z = i / (side * side);
+			glm::vec3 position((x - (side - 1) * 0.5f) * spacing, (y - (side - 1) * 0.5f) * spacing, -2.0f - z * spacing);
+
+			glm::mat4 model_mat = glm::mat4(1.0f);
+			model_mat = glm::translate(model_mat, position);
+			model_mat = glm::rotate(model_mat, glm::radians(nextRandom(state) * 360.0f), glm::vec3(0.3f, 1.0f, 0.5f));
+			model_mat = glm::scale(model_mat, glm::vec3(0.5f + nextRandom(state) * 0.5f));
+			addObject(model_mat, glm::vec3(0.3f + nextRandom(state) * 0.7f, 0.3f + nextRandom(state) * 0.7f, 0.3f + nextRandom(state) * 0.7f));
+		}
+	}
+
+	size_t getObjectCount() const
+	{
+		return instances.size();
+	}
+
+	const std::vector<InstanceData>& getInstances() const
+	{
+		return instances;
+	}
+
+	// World space bounding sphere of an object, given its mesh's local one (xyz = center, w = radius)
+	glm::vec4 getBoundingSphere(size_t index, const glm::vec4& meshSphere) const
+	{
+		return transformBoundingSphere(instances[index].model_mat, meshSphere);
+	}
+
+private:
+	// Uniform in [0, 1)
+	static float nextRandom(unsigned int& state)
+	{
+		state = state * 1664525u + 1013904223u;
+		return (state >> 8) * (1.0f / 16777216.0f);
+	}
+
+	std::vector<InstanceData> instances;
+};
+
+#endif
@@ -4,6 +4,8 @@
 #include <glad/glad.h> // include glad to get all the required OpenGL headers
 
 #include <string>
+#include <cstring>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -12,6 +14,67 @@
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
+#include "GLExtensions.h"
+#include "ProgramBinaryCache.h"
+
+
+// FNV-1a hash of a uniform name, constexpr so names can be hashed at compile time
+constexpr unsigned int hashUniformName(const char* name, unsigned int hash = 2166136261u)
+{
+    return *name == '\0' ? hash : hashUniformName(name + 1, (hash ^ (unsigned char)*name) * 16777619u);
+}
+
+// Maps C++ uniform value types to their GLSL types, so handles can be checked against the program
+template <typename T> struct UniformType;
+template <> struct UniformType<bool> { static const GLenum glType = GL_BOOL; };
+template <> struct UniformType<int> { static const GLenum glType = GL_INT; };
+template <> struct UniformType<float> { static const GLenum glType = GL_FLOAT; };
+template <> struct UniformType<glm::vec2> { static const GLenum glType = GL_FLOAT_VEC2; };
+template <> struct UniformType<glm::vec3> { static const GLenum glType = GL_FLOAT_VEC3; };
+template <> struct UniformType<glm::vec4> { static const GLenum glType = GL_FLOAT_VEC4; };
+template <> struct UniformType<glm::mat2> { static const GLenum glType = GL_FLOAT_MAT2; };
+template <> struct UniformType<glm::mat3> { static const GLenum glType = GL_FLOAT_MAT3; };
+template <> struct UniformType<glm::mat4> { static const GLenum glType = GL_FLOAT_MAT4; };
+
+// Pre-resolved, typed handle to a uniform of one Shader. Resolve once with Shader::getUniform<T>() and set it in the render loop
+template <typename T>
+struct Uniform
+{
+    int index = -1; // Slot in the shader's uniform table, -1 if the program has no such active uniform
+
+    bool isValid() const
+    {
+        return index >= 0;
+    }
+};
+
+// Active uniform of a linked program, as reported by glGetActiveUniform()
+struct UniformInfo
+{
+    std::string name; // Without the "[0]" suffix for arrays
+    unsigned int nameHash;
+    int location;
+    GLenum type;
+    int size;
+
+    // CPU-side copy of the last value uploaded, so setting the same value again can skip the glUniform*() call
+    mutable unsigned char shadow[64];
+    mutable bool hasShadow;
+};
+
+// When a Shader's compile/link results are waited for
+enum ShaderBuildMode
+{
+    SHADER_BUILD_IMMEDIATE, // In the constructor (default)
+    SHADER_BUILD_DEFERRED   // When the program is first needed, so many programs can be submitted before waiting on any (see completeBuild())
+};
+
+// Uniform upload counters, shared by all shaders. Reset once per frame to get per-frame numbers
+struct UniformStats
+{
+    unsigned int uploads = 0; // glUniform*() calls issued
+    unsigned int skipped = 0; // Sets skipped because the program already had that value
+};
 
 class Shader
 {
@@ -19,8 +82,8 @@ public:
     // Program ID
     unsigned int ID;
 
-    // Constructor reads and builds the shader
-    Shader(const char* vertexPath, const char* fragmentPath)
+    // Constructor reads and builds the shader. With a binary cache the linked program is loaded from it when possible
+    Shader(const char* vertexPath, const char* fragmentPath, ProgramBinaryCache* binaryCache = nullptr, ShaderBuildMode buildMode = SHADER_BUILD_IMMEDIATE)
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
@@ -53,121 +116,584 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
+        StageSource stages[] = { { GL_VERTEX_SHADER, vertexCode.c_str(), (int)vertexCode.size() }, { GL_FRAGMENT_SHADER, fragmentCode.c_str(), (int)fragmentCode.size() } };
+        build(stages, 2, binaryCache, buildMode);
+    }
 
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        int success;
-        char infoLog[512];
+    // Build from sources that are in memory already (e.g. in an asset pack mapping), they need not be null terminated
+    Shader(const char* vertexSource, int vertexLength, const char* fragmentSource, int fragmentLength, ProgramBinaryCache* binaryCache = nullptr, ShaderBuildMode buildMode = SHADER_BUILD_IMMEDIATE)
+    {
+        StageSource stages[] = { { GL_VERTEX_SHADER, vertexSource, vertexLength }, { GL_FRAGMENT_SHADER, fragmentSource, fragmentLength } };
+        build(stages, 2, binaryCache, buildMode);
+    }
 
-        // vertex Shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        // print compile errors if any
-        glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-        if (!success)
+    // Compute program from a source in memory, needs GL 4.3 (see GLExtensions::gpuDrivenDrawing). Run it with glDispatchCompute()
+    Shader(const char* computeSource, int computeLength, ProgramBinaryCache* binaryCache = nullptr, ShaderBuildMode buildMode = SHADER_BUILD_IMMEDIATE)
+    {
+        StageSource stages[] = { { GL_COMPUTE_SHADER, computeSource, computeLength } };
+        build(stages, 1, binaryCache, buildMode);
+    }
+
+    // Stand-in for a program whose sources couldn't be put together (a file missing, a broken include): an empty program that
+    // never links. Nothing goes to the compiler, so the only errors reported are the ones about the sources
+    Shader()
+    {
+        ID = glCreateProgram();
+        binaryCache = nullptr;
+        binaryKey = 0;
+        pending = false;
+        linked = false;
+        pendingShaderCount = 0;
+    }
+
+    // True if completing the build won't block: it's done, or the driver finished compiling and linking in the background.
+    // Without KHR_parallel_shader_compile there is no way to tell, so it's true and completing may block
+    bool isReady() const
+    {
+        if (!pending || !getGLExtensions().parallelShaderCompile)
         {
-            glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-            std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-        };
+            return true;
+        }
+        int completed = 0;
+        glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &completed);
+        return completed != 0;
+    }
 
-        // similiar process for Fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-        if (!success)
+    // Wait for a deferred build, report compile/link errors and reflect the uniforms. Everything that needs the linked
+    // program calls this, so it only has to be called explicitly to choose when the wait happens
+    void completeBuild() const
+    {
+        if (!pending)
         {
-            glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-            std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-        };
+            return;
+        }
+        pending = false;
+        int success;
+        char infoLog[512];
 
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
+        // print compile errors if any
+        for (int i = 0; i < pendingShaderCount; i++)
+        {
+            glGetShaderiv(pendingShaders[i], GL_COMPILE_STATUS, &success);
+            if (!success)
+            {
+                int type = 0;
+                glGetShaderiv(pendingShaders[i], GL_SHADER_TYPE, &type);
+                glGetShaderInfoLog(pendingShaders[i], 512, NULL, infoLog);
+                std::cout << "ERROR::SHADER::" << getStageName((GLenum)type) << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+            }
+        }
 
         // print linking errors if any
         glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        linked = success != 0;
         if (!success)
         {
             glGetProgramInfoLog(ID, 512, NULL, infoLog);
             std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
         }
+        else if (binaryCache)
+        {
+            binaryCache->store(binaryKey, ID);
+        }
 
         // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+        for (int i = 0; i < pendingShaderCount; i++)
+        {
+            glDeleteShader(pendingShaders[i]);
+        }
+        pendingShaderCount = 0;
+
+        reflectUniforms();
+    }
+
+    // Whether the program compiled and linked (waits for a deferred build)
+    bool isLinked() const
+    {
+        completeBuild();
+        return linked;
     }
 
     // Use/activate the shader
     void use()
     {
+        completeBuild();
         glUseProgram(ID);
     }
 
-    // utility uniform functions
+    // Bind a uniform block to a binding point (GLSL 330 can't do this in the shader itself). Returns false if the program has no such block
+    bool bindUniformBlock(const char* blockName, unsigned int bindingPoint)
+    {
+        completeBuild();
+        unsigned int blockIndex = glGetUniformBlockIndex(ID, blockName);
+        if (blockIndex == GL_INVALID_INDEX)
+        {
+            return false;
+        }
+        glUniformBlockBinding(ID, blockIndex, bindingPoint);
+        for (UniformBlockBinding& binding : blockBindings)
+        {
+            if (binding.name == blockName)
+            {
+                binding.bindingPoint = bindingPoint;
+                return true;
+            }
+        }
+        blockBindings.push_back({ blockName, bindingPoint });
+        return true;
+    }
+
+    // Switch to the program of a rebuilt Shader (e.g. from changed sources) if it linked, the old program is deleted.
+    // Uniforms keep their slots in the uniform table so handles resolved earlier stay valid (a uniform the new program lacks
+    // becomes a no-op), and the uniform values and block bindings set on the old program are carried over.
+    // The rebuilt Shader is left without a program
+    bool replaceProgram(Shader& rebuilt)
+    {
+        if (!rebuilt.isLinked())
+        {
+            return false;
+        }
+        completeBuild();
+
+        std::vector<UniformInfo> merged(uniforms);
+        for (UniformInfo& info : merged)
+        {
+            info.location = -1;
+        }
+        for (const UniformInfo& candidate : rebuilt.uniforms)
+        {
+            int index = findUniform(candidate.name.c_str());
+            if (index >= 0 && merged[index].type == candidate.type)
+            {
+                merged[index].location = candidate.location;
+                merged[index].size = candidate.size;
+                continue;
+            }
+            if (index >= 0)
+            {
+                // Old handles must not upload a value of the wrong type, the uniform can be resolved again under its new type
+                std::cout << "WARNING::SHADER::UNIFORM_TYPE_CHANGED " << candidate.name << std::endl;
+                merged[index].name.clear();
+                merged[index].nameHash = hashUniformName("");
+            }
+            merged.push_back(candidate);
+        }
+
+        GLint currentProgram = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
+        glUseProgram(rebuilt.ID);
+        for (const UniformInfo& info : merged)
+        {
+            if (info.location >= 0 && info.hasShadow)
+            {
+                uploadShadow(info);
+            }
+        }
+        for (const UniformBlockBinding& binding : blockBindings)
+        {
+            unsigned int blockIndex = glGetUniformBlockIndex(rebuilt.ID, binding.name.c_str());
+            if (blockIndex != GL_INVALID_INDEX)
+            {
+                glUniformBlockBinding(rebuilt.ID, blockIndex, binding.bindingPoint);
+            }
+        }
+        glUseProgram((GLuint)currentProgram == ID ? rebuilt.ID : (GLuint)currentProgram);
+
+        glDeleteProgram(ID);
+        ID = rebuilt.ID;
+        uniforms = merged;
+        rebuilt.ID = 0;
+        rebuilt.uniforms.clear();
+        return true;
+    }
+
+    // Resolve a typed handle to a uniform once, outside of the render loop
+    template <typename T>
+    Uniform<T> getUniform(const char* name) const
+    {
+        Uniform<T> uniform;
+        uniform.index = findUniform(name);
+        if (!uniform.isValid())
+        {
+            std::cout << "WARNING::SHADER::UNIFORM_NOT_ACTIVE " << name << std::endl;
+        }
+        else if (!isCompatibleType(uniforms[uniform.index].type, UniformType<T>::glType))
+        {
+            std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH " << name << std::endl;
+            uniform.index = -1;
+        }
+        return uniform;
+    }
+
+    // typed uniform functions, no lookups on the hot path
     // ------------------------------------------------------------------------
-    void setBool(const std::string& name, bool value) const
+    void set(Uniform<bool> uniform, bool value) const
+    {
+        upload(uniform.index, (int)value);
+    }
+    void set(Uniform<int> uniform, int value) const
+    {
+        upload(uniform.index, value);
+    }
+    void set(Uniform<float> uniform, float value) const
+    {
+        upload(uniform.index, value);
+    }
+    void set(Uniform<glm::vec2> uniform, const glm::vec2& value) const
+    {
+        upload(uniform.index, value);
+    }
+    void set(Uniform<glm::vec3> uniform, const glm::vec3& value) const
+    {
+        upload(uniform.index, value);
+    }
+    void set(Uniform<glm::vec4> uniform, const glm::vec4& value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        upload(uniform.index, value);
+    }
+    void set(Uniform<glm::mat2> uniform, const glm::mat2& mat) const
+    {
+        upload(uniform.index, mat);
+    }
+    void set(Uniform<glm::mat3> uniform, const glm::mat3& mat) const
+    {
+        upload(uniform.index, mat);
+    }
+    void set(Uniform<glm::mat4> uniform, const glm::mat4& mat) const
+    {
+        upload(uniform.index, mat);
+    }
+
+    // utility uniform functions, looked up by name in the reflected uniform table (no driver calls or allocations)
+    // ------------------------------------------------------------------------
+    void setBool(const char* name, bool value) const
+    {
+        upload(findUniform(name), (int)value);
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string& name, int value) const
+    void setInt(const char* name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        upload(findUniform(name), value);
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string& name, float value) const
+    void setFloat(const char* name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        upload(findUniform(name), value);
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string& name, const glm::vec2& value) const
+    void setVec2(const char* name, const glm::vec2& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        upload(findUniform(name), value);
     }
-    void setVec2(const std::string& name, float x, float y) const
+    void setVec2(const char* name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        upload(findUniform(name), glm::vec2(x, y));
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string& name, const glm::vec3& value) const
+    void setVec3(const char* name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        upload(findUniform(name), value);
     }
-    void setVec3(const std::string& name, float x, float y, float z) const
+    void setVec3(const char* name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        upload(findUniform(name), glm::vec3(x, y, z));
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string& name, const glm::vec4& value) const
+    void setVec4(const char* name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        upload(findUniform(name), value);
     }
-    void setVec4(const std::string& name, float x, float y, float z, float w)
+    void setVec4(const char* name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        upload(findUniform(name), glm::vec4(x, y, z, w));
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string& name, const glm::mat2& mat) const
+    void setMat2(const char* name, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        upload(findUniform(name), mat);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string& name, const glm::mat3& mat) const
+    void setMat3(const char* name, const glm::mat3& mat) const
+    {
+        upload(findUniform(name), mat);
+    }
+    // ------------------------------------------------------------------------
+    void setMat4(const char* name, const glm::mat4& mat) const
+    {
+        upload(findUniform(name), mat);
+    }
+
+    // Index of the named uniform in the uniform table, -1 if it's not an active uniform
+    int findUniform(const char* name) const
+    {
+        completeBuild();
+        unsigned int nameHash = hashUniformName(name);
+        for (size_t i = 0; i < uniforms.size(); i++)
+        {
+            if (uniforms[i].nameHash == nameHash && uniforms[i].name == name)
+            {
+                return (int)i;
+            }
+        }
+        return -1;
+    }
+
+    const std::vector<UniformInfo>& getUniforms() const
+    {
+        completeBuild();
+        return uniforms;
+    }
+
+    // Forget the shadowed values, e.g. after the program's uniforms were changed behind this class's back
+    void invalidateUniformShadows()
+    {
+        completeBuild();
+        for (const UniformInfo& info : uniforms)
+        {
+            info.hasShadow = false;
+        }
+    }
+
+    static UniformStats& getStats()
+    {
+        static UniformStats stats;
+        return stats;
+    }
+    static void resetStats()
+    {
+        getStats() = UniformStats();
+    }
+
+private:
+    // Source of one stage of the program: vertex + fragment, or compute alone
+    struct StageSource
+    {
+        GLenum type;
+        const char* source;
+        int length;
+    };
+
+    static const char* getStageName(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_VERTEX_SHADER:
+            return "VERTEX";
+        case GL_FRAGMENT_SHADER:
+            return "FRAGMENT";
+        case GL_COMPUTE_SHADER:
+            return "COMPUTE";
+        default:
+            return "UNKNOWN";
+        }
+    }
+
+    // Compile and link (or load the cached binary), then reflect the uniforms. Deferred builds only submit the work,
+    // completeBuild() does the rest when the program is first needed
+    void build(const StageSource* stages, int stageCount, ProgramBinaryCache* binaryCache_in, ShaderBuildMode buildMode)
+    {
+        binaryCache = binaryCache_in;
+        binaryKey = 0;
+        pending = false;
+        pendingShaderCount = 0;
+        linked = false;
+        if (binaryCache)
+        {
+            // A compute program is keyed like a vertex shader without a fragment shader, which is never built
+            binaryKey = stageCount == 2 ? binaryCache->getKey(stages[0].source, stages[0].length, stages[1].source, stages[1].length)
+                : binaryCache->getKey(stages[0].source, stages[0].length, "", 0);
+            ID = binaryCache->load(binaryKey);
+            if (ID != 0)
+            {
+                linked = true;
+                reflectUniforms();
+                return;
+            }
+        }
+
+        // compile shaders, no status queries so drivers with KHR_parallel_shader_compile can work on them in the background
+        for (int i = 0; i < stageCount; i++)
+        {
+            pendingShaders[i] = glCreateShader(stages[i].type);
+            glShaderSource(pendingShaders[i], 1, &stages[i].source, &stages[i].length);
+            glCompileShader(pendingShaders[i]);
+        }
+        pendingShaderCount = stageCount;
+
+        // shader Program
+        ID = glCreateProgram();
+        for (int i = 0; i < stageCount; i++)
+        {
+            glAttachShader(ID, pendingShaders[i]);
+        }
+        if (binaryCache)
+        {
+            binaryCache->prepare(ID);
+        }
+        glLinkProgram(ID);
+        pending = true;
+
+        if (buildMode == SHADER_BUILD_IMMEDIATE)
+        {
+            completeBuild();
+        }
+    }
+
+    // Cache all active uniforms after linking, so setting them never has to ask the driver for locations
+    void reflectUniforms() const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        uniforms.clear();
+        int uniformCount = 0;
+        int maxNameLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+        std::vector<char> nameBuffer(maxNameLength + 1);
+        for (int i = 0; i < uniformCount; i++)
+        {
+            UniformInfo info;
+            int nameLength = 0;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)nameBuffer.size(), &nameLength, &info.size, &info.type, nameBuffer.data());
+            info.name.assign(nameBuffer.data(), nameLength);
+            info.location = glGetUniformLocation(ID, info.name.c_str());
+            if (info.location < 0)
+            {
+                continue; // Members of uniform blocks have no location
+            }
+
+            // Arrays are reported as "name[0]", look them up by their plain name
+            size_t bracket = info.name.find('[');
+            if (bracket != std::string::npos)
+            {
+                info.name.erase(bracket);
+            }
+            info.nameHash = hashUniformName(info.name.c_str());
+            info.hasShadow = false;
+            uniforms.push_back(info);
+        }
     }
+
+    static bool isCompatibleType(GLenum programType, GLenum requestedType)
+    {
+        if (programType == requestedType)
+        {
+            return true;
+        }
+        // Samplers and bools can be set as ints
+        if (requestedType == GL_INT)
+        {
+            return programType == GL_BOOL || programType == GL_SAMPLER_2D || programType == GL_SAMPLER_3D ||
+                programType == GL_SAMPLER_CUBE || programType == GL_SAMPLER_2D_ARRAY || programType == GL_SAMPLER_2D_SHADOW;
+        }
+        return false;
+    }
+
+    // Every uniform write goes through here so it can be counted, and skipped if the value didn't change.
+    // Like glUniform*() itself, this assumes the program is currently in use
+    template <typename T>
+    void upload(int index, const T& value) const
+    {
+        static_assert(sizeof(T) <= sizeof(UniformInfo::shadow), "Uniform value doesn't fit in the shadow copy");
+        if (index < 0)
+        {
+            return;
+        }
+        const UniformInfo& info = uniforms[index];
+        if (info.hasShadow && memcmp(info.shadow, &value, sizeof(T)) == 0)
+        {
+            getStats().skipped++;
+            return;
+        }
+        memcpy(info.shadow, &value, sizeof(T));
+        info.hasShadow = true;
+        getStats().uploads++;
+        uploadToProgram(info.location, value);
+    }
+
+    // Upload the shadowed value again, into the program in use
+    static void uploadShadow(const UniformInfo& info)
+    {
+        switch (info.type)
+        {
+        case GL_FLOAT:
+            uploadToProgram(info.location, *(const float*)info.shadow);
+            break;
+        case GL_FLOAT_VEC2:
+            uploadToProgram(info.location, *(const glm::vec2*)info.shadow);
+            break;
+        case GL_FLOAT_VEC3:
+            uploadToProgram(info.location, *(const glm::vec3*)info.shadow);
+            break;
+        case GL_FLOAT_VEC4:
+            uploadToProgram(info.location, *(const glm::vec4*)info.shadow);
+            break;
+        case GL_FLOAT_MAT2:
+            uploadToProgram(info.location, *(const glm::mat2*)info.shadow);
+            break;
+        case GL_FLOAT_MAT3:
+            uploadToProgram(info.location, *(const glm::mat3*)info.shadow);
+            break;
+        case GL_FLOAT_MAT4:
+            uploadToProgram(info.location, *(const glm::mat4*)info.shadow);
+            break;
+        default: // Ints, bools and samplers are all set as ints
+            uploadToProgram(info.location, *(const int*)info.shadow);
+            break;
+        }
+    }
+
+    // Raw uploads
     // ------------------------------------------------------------------------
-    void setMat4(const std::string& name, const glm::mat4& mat) const
+    static void uploadToProgram(int location, int value)
+    {
+        glUniform1i(location, value);
+    }
+    static void uploadToProgram(int location, float value)
+    {
+        glUniform1f(location, value);
+    }
+    static void uploadToProgram(int location, const glm::vec2& value)
+    {
+        glUniform2fv(location, 1, &value[0]);
+    }
+    static void uploadToProgram(int location, const glm::vec3& value)
+    {
+        glUniform3fv(location, 1, &value[0]);
+    }
+    static void uploadToProgram(int location, const glm::vec4& value)
+    {
+        glUniform4fv(location, 1, &value[0]);
+    }
+    static void uploadToProgram(int location, const glm::mat2& mat)
+    {
+        glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
+    static void uploadToProgram(int location, const glm::mat3& mat)
+    {
+        glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
+    static void uploadToProgram(int location, const glm::mat4& mat)
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
     }
 
+    mutable std::vector<UniformInfo> uniforms; // Filled in once the build is complete
+
+    // Set with bindUniformBlock(), so a replacement program can get the same bindings
+    struct UniformBlockBinding
+    {
+        std::string name;
+        unsigned int bindingPoint;
+    };
+    std::vector<UniformBlockBinding> blockBindings;
+
+    // Deferred build state, see completeBuild()
+    mutable bool pending;
+    mutable bool linked;
+    mutable unsigned int pendingShaders[2];
+    mutable int pendingShaderCount;
+    ProgramBinaryCache* binaryCache;
+    uint64_t binaryKey;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,306 @@
+#ifndef SHADER_PERMUTATION_CACHE_H
+#define SHADER_PERMUTATION_CACHE_H
+
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "Shader.h"
+#include "ShaderPreprocessor.h"
+#include "ProgramBinaryCache.h"
+#include "AssetPack.h"
+
+struct ShaderPermutationStats
+{
+	unsigned int compiled = 0; // Permutations built (from source or the binary cache)
+	unsigned int reused = 0;   // Requests for a permutation that was built already
+	unsigned int reloaded = 0; // Rebuilt after a source file changed and swapped in
+	unsigned int reloadsFailed = 0; // Rebuilt after a change but didn't compile, the old program stayed
+};
+
+// Builds every (vertex shader, fragment shader, define set) combination once and hands out the same Shader for it afterwards.
+// Specializing through defines (compile time constants, features switched on/off) instead of uniforms and branches keeps
+// the per-draw and per-fragment work down, this keeps the resulting programs from being compiled more than once
+class ShaderPermutationCache
+{
+public:
+	ShaderPermutationCache(const AssetPack* assetPack = nullptr, ProgramBinaryCache* binaryCache_in = nullptr) :
+		preprocessor(assetPack),
+		binaryCache(binaryCache_in),
+		queuedReloads(0)
+	{
+	}
+	ShaderPermutationCache(const ShaderPermutationCache&) = delete;
+	ShaderPermutationCache& operator=(const ShaderPermutationCache&) = delete;
+
+	// The defines go into both stages. The Shader lives as long as the cache. Deferred permutations are only submitted to the
+	// driver, request all that are needed before using any of them so their compiles can overlap (see completeAll())
+	Shader& get(const std::string& vertexPath, const std::string& fragmentPath, const ShaderDefines& defines = ShaderDefines(),
+		ShaderBuildMode buildMode = SHADER_BUILD_IMMEDIATE)
+	{
+		std::string key = vertexPath + "|" + fragmentPath + "|" + getDefinesKey(defines);
+		auto it = permutations.find(key);
+		if (it != permutations.end())
+		{
+			stats.reused++;
+			return *it->second.shader;
+		}
+
+		stats.compiled++;
+		Permutation& permutation = permutations[key];
+		permutation.vertexPath = vertexPath;
+		permutation.fragmentPath = fragmentPath;
+		permutation.defines = defines;
+		permutation.shader = build(preprocessor, permutation, buildMode);
+		if (!permutation.shader)
+		{
+			permutation.shader.reset(new Shader()); // Never links, check() reports the permutation as failed
+		}
+		unchecked.push_back(&permutation);
+		if (buildMode == SHADER_BUILD_IMMEDIATE)
+		{
+			check();
+		}
+		return *permutation.shader;
+	}
+
+	// Same for a compute program (GL 4.3, see GLExtensions::gpuDrivenDrawing)
+	Shader& getCompute(const std::string& computePath, const ShaderDefines& defines = ShaderDefines(), ShaderBuildMode buildMode = SHADER_BUILD_IMMEDIATE)
+	{
+		std::string key = computePath + "|" + getDefinesKey(defines);
+		auto it = permutations.find(key);
+		if (it != permutations.end())
+		{
+			stats.reused++;
+			return *it->second.shader;
+		}
+
+		stats.compiled++;
+		Permutation& permutation = permutations[key];
+		permutation.computePath = computePath;
+		permutation.defines = defines;
+		permutation.shader = build(preprocessor, permutation, buildMode);
+		if (!permutation.shader)
+		{
+			permutation.shader.reset(new Shader()); // Never links, check() reports the permutation as failed
+		}
+		unchecked.push_back(&permutation);
+		if (buildMode == SHADER_BUILD_IMMEDIATE)
+		{
+			check();
+		}
+		return *permutation.shader;
+	}
+
+	// Wait for all deferred permutations and report the ones that failed
+	void completeAll()
+	{
+		check();
+	}
+
+	// Queue a rebuild of every permutation that uses one of the files (shaders or includes, paths as they were passed in or
+	// included). Returns how many were queued, see updateReloads()
+	unsigned int reloadChanged(const std::vector<std::string>& changedFiles)
+	{
+		unsigned int queued = 0;
+		for (const std::string& changedFile : changedFiles)
+		{
+			std::string file = ShaderPreprocessor::resolvePath("", changedFile);
+			for (auto& entry : permutations)
+			{
+				Permutation& permutation = entry.second;
+				if (!permutation.reloadQueued && permutation.usesFile(file))
+				{
+					permutation.reloadQueued = true;
+					queuedReloads++;
+					queued++;
+				}
+			}
+		}
+		return queued;
+	}
+
+	// Call at a frame boundary: swaps in rebuilt programs that are ready (without waiting for any) and submits queued rebuilds
+	// until the time budget is used up, at least one per call so reloads always make progress. A rebuild that fails to preprocess
+	// or compile is reported and dropped, the permutation keeps its working program. Returns how many programs were swapped
+	unsigned int updateReloads(float budgetMilliseconds)
+	{
+		if (queuedReloads == 0 && rebuilding.empty())
+		{
+			return 0;
+		}
+		auto start = std::chrono::steady_clock::now();
+		unsigned int swapped = 0;
+		for (auto it = rebuilding.begin(); it != rebuilding.end();)
+		{
+			Permutation& permutation = **it;
+			if (!permutation.rebuild->isReady())
+			{
+				++it;
+				continue;
+			}
+			if (permutation.shader->replaceProgram(*permutation.rebuild))
+			{
+				std::cout << "Reloaded shader " << permutation.getDescription() << std::endl;
+				stats.reloaded++;
+				swapped++;
+			}
+			else
+			{
+				permutation.printFailure();
+				glDeleteProgram(permutation.rebuild->ID);
+				stats.reloadsFailed++;
+			}
+			permutation.rebuild.reset();
+			it = rebuilding.erase(it);
+		}
+
+		unsigned int submitted = 0;
+		for (auto& entry : permutations)
+		{
+			Permutation& permutation = entry.second;
+			if (!permutation.reloadQueued || permutation.rebuild)
+			{
+				continue; // A rebuild still in flight is finished first, the change gets picked up by the next one
+			}
+			float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (submitted > 0 && elapsed >= budgetMilliseconds)
+			{
+				break;
+			}
+			// Reloads read the loose files, they are what gets edited (an asset pack is a build output)
+			permutation.reloadQueued = false;
+			queuedReloads--;
+			permutation.rebuild = build(filePreprocessor, permutation, SHADER_BUILD_DEFERRED);
+			if (permutation.rebuild)
+			{
+				rebuilding.push_back(&permutation);
+			}
+			else
+			{
+				// E.g. saved halfway or an include is missing: nothing to compile, the working program and file lists stay
+				permutation.printFailure();
+				stats.reloadsFailed++;
+			}
+			submitted++;
+		}
+		return swapped;
+	}
+
+	size_t getPermutationCount() const
+	{
+		return permutations.size();
+	}
+
+	const ShaderPermutationStats& getStats() const
+	{
+		return stats;
+	}
+
+private:
+	struct Permutation
+	{
+		std::unique_ptr<Shader> shader;
+		std::string vertexPath;
+		std::string fragmentPath;
+		std::string computePath; // Instead of the vertex and fragment shaders
+		ShaderDefines defines;
+		std::vector<std::string> vertexFiles;   // From the last build, with includes
+		std::vector<std::string> fragmentFiles;
+		std::vector<std::string> computeFiles;
+		bool reloadQueued = false;
+		std::unique_ptr<Shader> rebuild; // Submitted to the driver, not swapped in yet
+
+		bool usesFile(const std::string& file) const
+		{
+			return std::find(vertexFiles.begin(), vertexFiles.end(), file) != vertexFiles.end()
+				|| std::find(fragmentFiles.begin(), fragmentFiles.end(), file) != fragmentFiles.end()
+				|| std::find(computeFiles.begin(), computeFiles.end(), file) != computeFiles.end();
+		}
+
+		std::string getDescription() const
+		{
+			return (computePath.empty() ? vertexPath + " " + fragmentPath : computePath) + " " + getDefinesKey(defines);
+		}
+
+		// Messages refer to "<source string>:<line>"
+		void printFailure() const
+		{
+			std::cout << "Shader permutation failed: " << getDescription() << std::endl;
+			printSourceStrings("vertex", vertexFiles);
+			printSourceStrings("fragment", fragmentFiles);
+			printSourceStrings("compute", computeFiles);
+		}
+	};
+
+	// nullptr if a source can't be preprocessed (the preprocessor reports why): nothing is compiled, compiling the source it got
+	// that far would only add confusing GLSL errors. The file lists are only replaced by a successful build, except on the first
+	// one, where the files read so far are all there is to watch for a fix
+	std::unique_ptr<Shader> build(const ShaderPreprocessor& sourcePreprocessor, Permutation& permutation, ShaderBuildMode buildMode)
+	{
+		bool firstBuild = !permutation.shader;
+		if (!permutation.computePath.empty())
+		{
+			PreprocessedShader compute;
+			bool preprocessed = sourcePreprocessor.preprocess(permutation.computePath, permutation.defines, compute);
+			if (preprocessed || firstBuild)
+			{
+				permutation.computeFiles = compute.files;
+			}
+			if (!preprocessed)
+			{
+				return nullptr;
+			}
+			return std::unique_ptr<Shader>(new Shader(compute.source.c_str(), (int)compute.source.size(), binaryCache, buildMode));
+		}
+		PreprocessedShader vertex;
+		PreprocessedShader fragment;
+		bool preprocessed = sourcePreprocessor.preprocess(permutation.vertexPath, permutation.defines, vertex);
+		preprocessed = sourcePreprocessor.preprocess(permutation.fragmentPath, permutation.defines, fragment) && preprocessed;
+		if (preprocessed || firstBuild)
+		{
+			permutation.vertexFiles = vertex.files;
+			permutation.fragmentFiles = fragment.files;
+		}
+		if (!preprocessed)
+		{
+			return nullptr;
+		}
+		return std::unique_ptr<Shader>(new Shader(vertex.source.c_str(), (int)vertex.source.size(), fragment.source.c_str(), (int)fragment.source.size(), binaryCache, buildMode));
+	}
+
+	void check()
+	{
+		for (const Permutation* permutation : unchecked)
+		{
+			if (!permutation->shader->isLinked())
+			{
+				permutation->printFailure();
+			}
+		}
+		unchecked.clear();
+	}
+
+	static void printSourceStrings(const char* stage, const std::vector<std::string>& files)
+	{
+		for (size_t i = 0; i < files.size(); i++)
+		{
+			std::cout << "  " << stage << " source string " << i << ": " << files[i] << std::endl;
+		}
+	}
+
+	ShaderPreprocessor preprocessor;
+	ShaderPreprocessor filePreprocessor; // Without the asset pack, for reloads
+	ProgramBinaryCache* binaryCache;
+	std::unordered_map<std::string, Permutation> permutations; // Node based, Permutation pointers stay valid
+	std::vector<Permutation*> unchecked;
+	std::vector<Permutation*> rebuilding;
+	unsigned int queuedReloads;
+	ShaderPermutationStats stats;
+};
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include "AssetPack.h"
+
+// A #define injected into a shader, value may be empty ("#define NAME")
+struct ShaderDefine
+{
+	std::string name;
+	std::string value;
+
+	bool operator<(const ShaderDefine& other) const
+	{
+		return name < other.name;
+	}
+};
+
+typedef std::vector<ShaderDefine> ShaderDefines;
+
+// Canonical text of a define set (sorted by name), equal sets give equal strings regardless of their order
+inline std::string getDefinesKey(ShaderDefines defines)
+{
+	std::sort(defines.begin(), defines.end());
+	std::string key;
+	for (const ShaderDefine& define : defines)
+	{
+		key += define.name;
+		if (!define.value.empty())
+		{
+			key += "=" + define.value;
+		}
+		key += ";";
+	}
+	return key;
+}
+
+// Source ready for glShaderSource, plus the files it was assembled from. The compiler reports errors as
+// "<source string>:<line>", the source string number is the index into files
+struct PreprocessedShader
+{
+	std::string source;
+	std::vector<std::string> files; // [0] is the shader itself, then its includes in the order they were first included
+};
+
+// Resolves #include "file" (relative to the including file, each file is included at most once so includes need no guards),
+// injects #defines right after #version and inserts #line directives so compiler messages point at the right file and line.
+// Files are read from the asset pack if it has them, from disk otherwise
+class ShaderPreprocessor
+{
+public:
+	ShaderPreprocessor(const AssetPack* assetPack_in = nullptr) :
+		assetPack(assetPack_in)
+	{
+	}
+
+	// False (and a message) if a file can't be read or an include is malformed
+	bool preprocess(const std::string& path, const ShaderDefines& defines, PreprocessedShader& shader) const
+	{
+		shader.source.clear();
+		shader.files.clear();
+		return append(path, defines, shader, 0);
+	}
+
+	// Joins a path relative to the directory of baseFile, resolving "." and ".." so every spelling of a file gets the same name
+	static std::string resolvePath(const std::string& baseFile, const std::string& relativePath)
+	{
+		size_t slash = baseFile.find_last_of("/\\");
+		std::string joined = slash == std::string::npos ? relativePath : baseFile.substr(0, slash + 1) + relativePath;
+		std::replace(joined.begin(), joined.end(), '\\', '/');
+
+		std::vector<std::string> parts;
+		std::stringstream stream(joined);
+		std::string part;
+		while (std::getline(stream, part, '/'))
+		{
+			if (part == "..")
+			{
+				if (!parts.empty() && parts.back() != "..")
+				{
+					parts.pop_back();
+					continue;
+				}
+			}
+			else if (part.empty() || part == ".")
+			{
+				continue;
+			}
+			parts.push_back(part);
+		}
+		std::string resolved;
+		for (size_t i = 0; i < parts.size(); i++)
+		{
+			resolved += (i > 0 ? "/" : "") + parts[i];
+		}
+		return resolved;
+	}
+
+private:
+	bool append(const std::string& path, const ShaderDefines& defines, PreprocessedShader& shader, int depth) const
+	{
+		const int maxIncludeDepth = 32;
+		if (depth > maxIncludeDepth)
+		{
+			std::cout << "ERROR::SHADER::INCLUDE_TOO_DEEP " << path << std::endl;
+			return false;
+		}
+		std::string text;
+		if (!readFile(path, text))
+		{
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+			return false;
+		}
+		size_t fileIndex = shader.files.size();
+		shader.files.push_back(path);
+
+		std::stringstream stream(text);
+		std::string line;
+		int lineNumber = 0;
+		while (std::getline(stream, line))
+		{
+			lineNumber++;
+			if (!line.empty() && line.back() == '\r')
+			{
+				line.pop_back();
+			}
+			std::string directive = getDirective(line);
+			if (directive == "version" && fileIndex == 0)
+			{
+				// Defines have to come after #version, which has to be the first statement
+				shader.source += line + "\n";
+				for (const ShaderDefine& define : defines)
+				{
+					shader.source += "#define " + define.name + (define.value.empty() ? "" : " " + define.value) + "\n";
+				}
+				shader.source += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+			}
+			else if (directive == "include")
+			{
+				size_t open = line.find('"');
+				size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+				if (close == std::string::npos)
+				{
+					std::cout << "ERROR::SHADER::MALFORMED_INCLUDE " << path << ":" << lineNumber << std::endl;
+					return false;
+				}
+				std::string includePath = resolvePath(path, line.substr(open + 1, close - open - 1));
+				if (std::find(shader.files.begin(), shader.files.end(), includePath) == shader.files.end())
+				{
+					shader.source += "#line 1 " + std::to_string(shader.files.size()) + "\n";
+					if (!append(includePath, defines, shader, depth + 1))
+					{
+						return false;
+					}
+					shader.source += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+				}
+				else
+				{
+					shader.source += "\n"; // Keep the line count
+				}
+			}
+			else
+			{
+				shader.source += line + "\n";
+			}
+		}
+		return true;
+	}
+
+	// Name of the preprocessor directive on the line ("version", "include", ...), empty if it isn't one
+	static std::string getDirective(const std::string& line)
+	{
+		size_t hash = line.find_first_not_of(" \t");
+		if (hash == std::string::npos || line[hash] != '#')
+		{
+			return std::string();
+		}
+		size_t start = line.find_first_not_of(" \t", hash + 1);
+		if (start == std::string::npos)
+		{
+			return std::string();
+		}
+		size_t end = line.find_first_not_of("abcdefghijklmnopqrstuvwxyz", start);
+		return line.substr(start, (end == std::string::npos ? line.size() : end) - start);
+	}
+
+	bool readFile(const std::string& path, std::string& text) const
+	{
+		if (assetPack && assetPack->isOpen())
+		{
+			AssetView asset = assetPack->find(path);
+			if (asset.isValid())
+			{
+				text.assign((const char*)asset.data, asset.size);
+				return true;
+			}
+		}
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+		{
+			return false;
+		}
+		std::stringstream contents;
+		contents << file.rdbuf();
+		text = contents.str();
+		return true;
+	}
+
+	const AssetPack* assetPack;
+};
+
+#endif
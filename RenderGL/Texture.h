@@ -2,26 +2,93 @@
 #define TEXTURE_H
 
 #include <glad/glad.h> // include glad to get all the required OpenGL headers
+#include <string>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <iostream>
+#include <cstring>
 #include "stb_image.h"
+#include "TextureCooker.h"
+#include "GLExtensions.h"
 
-class Texture
+// EXT_texture_compression_s3tc, not part of core GL but supported by practically every desktop driver
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// What happens to the decoded pixels once they are on the GPU
+enum TextureRetention
+{
+	TEXTURE_RELEASE_AFTER_UPLOAD, // Free them, the GPU copy is all that's needed for rendering (default)
+	TEXTURE_RETAIN_PIXELS         // Keep them for CPU readback/streaming, see getPixels(). Not for cooked (.rtex) textures, they
+	                              // are uploaded compressed and never decoded: asking for it is reported and ignored
+};
+
+class Texture;
+
+// Byte counts of one texture (or all of them), see TextureMemory
+struct TextureMemoryUsage
+{
+	size_t cpuBytes = 0; // Decoded pixels kept in RAM
+	size_t gpuBytes = 0; // Estimated video memory, including the mip chain
+};
+
+// Registry of every live Texture, for reporting how much CPU and GPU memory textures take
+class TextureMemory
 {
 public:
-	Texture(std::string imageFilePath) : ID(0), data(nullptr), width(0), height(0), nChannels(0)
+	static TextureMemoryUsage getTotal();
+	static void printReport(std::ostream& out);
+
+private:
+	friend class Texture;
+	static void add(Texture* texture)
 	{
-		// Create and bind 1 texture
-		glGenTextures(1, &ID);
-		glBindTexture(GL_TEXTURE_2D, ID);
+		std::lock_guard<std::mutex> lock(getMutex());
+		getTextures().push_back(texture);
+	}
+	static void remove(Texture* texture)
+	{
+		std::lock_guard<std::mutex> lock(getMutex());
+		std::vector<Texture*>& textures = getTextures();
+		textures.erase(std::remove(textures.begin(), textures.end(), texture), textures.end());
+	}
+	static std::vector<Texture*>& getTextures()
+	{
+		static std::vector<Texture*> textures;
+		return textures;
+	}
+	static std::mutex& getMutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+};
 
-		// set the texture wrapping/filtering options (on the currently bound texture object)
+class Texture
+{
+public:
+	Texture(std::string imageFilePath, TextureRetention retention = TEXTURE_RELEASE_AFTER_UPLOAD) : ID(0), data(nullptr), width(0), height(0), nChannels(0), resident(false), hasMipmaps(false), compressedBlockBytes(0), name(imageFilePath)
+	{
+		TextureMemory::add(this);
 
-		// Repeat texture if sampling outside of the 0, 1 region
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		// Create and bind 1 texture
+		createTexture();
 
-		// Linearly interpolate for minification + magnification
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		// Cooked (.rtex) textures are uploaded as is, see TextureCooker.h. They have no CPU copy to retain
+		if (imageFilePath.size() > 5 && imageFilePath.compare(imageFilePath.size() - 5, 5, ".rtex") == 0)
+		{
+			if (retention == TEXTURE_RETAIN_PIXELS)
+			{
+				std::cout << "ERROR::TEXTURE::CANNOT_RETAIN_COOKED_PIXELS " << imageFilePath << std::endl;
+			}
+			loadCooked(imageFilePath);
+			return;
+		}
 
 		// Load texture from image, flipped by default since OGL handles textures differently from how it's written to usually
 		stbi_set_flip_vertically_on_load(true);
@@ -33,6 +100,8 @@ public:
 			{
 				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
 				glGenerateMipmap(GL_TEXTURE_2D);
+				resident = true;
+				hasMipmaps = true;
 				std::cout << "Successfully loaded " << imageFilePath << " with number of channels: " << nChannels << std::endl;
 			}
 			else if (nChannels == 4)
@@ -40,20 +109,58 @@ public:
 				// for the alpha channel, so make sure to tell OpenGL the data type is of GL_RGBA
 				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
 				glGenerateMipmap(GL_TEXTURE_2D);
+				resident = true;
+				hasMipmaps = true;
 				std::cout << "Successfully loaded " << imageFilePath << " with number of channels: " << nChannels << std::endl;
 			}
 			else
 			{
 				std::cout << "Failed to load texture (nChannels must be 3 or 4!): " << imageFilePath << " " << std::endl;
 			}
+
+			// The GL has its own copy now
+			if (retention == TEXTURE_RELEASE_AFTER_UPLOAD || !resident)
+			{
+				stbi_image_free(data);
+				data = nullptr;
+			}
 		}
 		else
 		{
 			std::cout << "Failed to load texture (stbi_load() failed): " << imageFilePath << " " << std::endl;
 		}
 	}
+	// Cooked container (.rtex) that is in memory already, e.g. in an asset pack mapping. The blocks are uploaded straight from there
+	Texture(const std::string& name_in, const unsigned char* cookedData, size_t cookedSize) : ID(0), data(nullptr), width(0), height(0), nChannels(0), resident(false), hasMipmaps(false), compressedBlockBytes(0), name(name_in)
+	{
+		TextureMemory::add(this);
+		createTexture();
+		CookedTextureView cooked;
+		if (parseCookedTexture(cookedData, cookedSize, cooked))
+		{
+			uploadCooked(cooked);
+		}
+		else
+		{
+			std::cout << "Failed to load cooked texture (invalid container): " << name << " " << std::endl;
+		}
+	}
+	// Placeholder texture (2x2 magenta/black checkerboard) to be filled in later with setImage(), e.g. by TextureLoader
+	Texture() : ID(0), data(nullptr), width(0), height(0), nChannels(0), resident(false), hasMipmaps(false), compressedBlockBytes(0), name("placeholder")
+	{
+		TextureMemory::add(this);
+		createTexture();
+		const unsigned char checkerboard[] = { 255, 0, 255, 255,  0, 0, 0, 255,  0, 0, 0, 255,  255, 0, 255, 255 };
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, checkerboard);
+	}
+	// Registered with TextureMemory by address and owns its GL name and pixels
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
 	~Texture()
 	{
+		TextureMemory::remove(this);
 		stbi_image_free(data);
 		unbind();
 		glDeleteTextures(1, &ID);
@@ -73,14 +180,258 @@ public:
 		return ID;
 	}
 
+	// Replace the contents with a decoded 3 or 4 channel image and build its mip chain. pixels may be an offset into the bound
+	// GL_PIXEL_UNPACK_BUFFER. Rows are tightly packed. mipPixels: levels 1 and below computed already (see generateMipChain()),
+	// same layout, glGenerateMipmap is used if there are none
+	void setImage(int width_in, int height_in, int nChannels_in, const void* pixels, const std::vector<const void*>& mipPixels = std::vector<const void*>())
+	{
+		stbi_image_free(data);
+		data = nullptr;
+		GLenum format = nChannels_in == 4 ? GL_RGBA : GL_RGB;
+		bind();
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width_in, height_in, 0, format, GL_UNSIGNED_BYTE, pixels);
+		for (size_t level = 1; level <= mipPixels.size(); level++)
+		{
+			glTexImage2D(GL_TEXTURE_2D, (GLint)level, format, std::max(1, width_in >> level), std::max(1, height_in >> level), 0, format, GL_UNSIGNED_BYTE, mipPixels[level - 1]);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		if (mipPixels.empty())
+		{
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000); // Default, the texture may have had a shorter chain before
+			glGenerateMipmap(GL_TEXTURE_2D);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		}
+		else
+		{
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)mipPixels.size());
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		width = width_in;
+		height = height_in;
+		nChannels = nChannels_in;
+		resident = true;
+		hasMipmaps = true;
+		compressedBlockBytes = 0;
+	}
+
+	// Load the (changed) file again into this texture, so everything holding it sees the new image. Pixels stay retained if
+	// they were. Synchronous, TextureLoader::reload() decodes on its threads. False if it can't be loaded, the old image stays
+	bool reload(const std::string& imageFilePath)
+	{
+		bind();
+		if (imageFilePath.size() > 5 && imageFilePath.compare(imageFilePath.size() - 5, 5, ".rtex") == 0)
+		{
+			stbi_image_free(data);
+			data = nullptr;
+			loadCooked(imageFilePath);
+			return resident;
+		}
+
+		stbi_set_flip_vertically_on_load(true);
+		int imageWidth = 0;
+		int imageHeight = 0;
+		int imageChannels = 0;
+		unsigned char* pixels = stbi_load(imageFilePath.c_str(), &imageWidth, &imageHeight, &imageChannels, 0);
+		if (!pixels || (imageChannels != 3 && imageChannels != 4))
+		{
+			std::cout << "Failed to reload texture: " << imageFilePath << " " << std::endl;
+			stbi_image_free(pixels);
+			return false;
+		}
+		bool retained = data != nullptr;
+		setImage(imageWidth, imageHeight, imageChannels, pixels);
+		if (retained)
+		{
+			retainPixels(pixels);
+		}
+		else
+		{
+			stbi_image_free(pixels);
+		}
+		return true;
+	}
+
+	// Keep a CPU copy of the current image (allocated by stb_image, the texture frees it)
+	void retainPixels(unsigned char* pixels)
+	{
+		stbi_image_free(data);
+		data = pixels;
+	}
+
+	// Decoded pixels if they were retained (TEXTURE_RETAIN_PIXELS), nullptr otherwise
+	const unsigned char* getPixels()
+	{
+		return data;
+	}
+
+	const std::string& getName()
+	{
+		return name;
+	}
+	void setName(const std::string& name_in)
+	{
+		name = name_in;
+	}
+
+	TextureMemoryUsage getMemoryUsage()
+	{
+		TextureMemoryUsage usage;
+		if (data)
+		{
+			usage.cpuBytes = (size_t)width * height * nChannels;
+		}
+
+		// Estimate: drivers generally pad RGB8 to 4 bytes per texel, and the mip chain adds up to about a third.
+		// Compressed textures take exactly their 4x4 blocks
+		int levelWidth = resident ? width : 2;
+		int levelHeight = resident ? height : 2;
+		while (true)
+		{
+			if (compressedBlockBytes > 0)
+			{
+				usage.gpuBytes += (size_t)((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * compressedBlockBytes;
+			}
+			else
+			{
+				usage.gpuBytes += (size_t)levelWidth * levelHeight * 4;
+			}
+			if (!hasMipmaps || (levelWidth == 1 && levelHeight == 1))
+			{
+				break;
+			}
+			levelWidth = std::max(1, levelWidth / 2);
+			levelHeight = std::max(1, levelHeight / 2);
+		}
+		return usage;
+	}
+
+	// False while this is still a placeholder (or the image failed to load)
+	bool isResident()
+	{
+		return resident;
+	}
+
+	int getWidth()
+	{
+		return width;
+	}
+	int getHeight()
+	{
+		return height;
+	}
+
+	// True if the GL supports BC1/BC3 (S3TC) textures, cooked textures are decompressed on the CPU otherwise
+	static bool isS3TCSupported()
+	{
+		static int supported = -1;
+		if (supported < 0)
+		{
+			supported = hasGLExtension("GL_EXT_texture_compression_s3tc") ? 1 : 0;
+		}
+		return supported == 1;
+	}
+
 private:
+	void createTexture()
+	{
+		glGenTextures(1, &ID);
+		glBindTexture(GL_TEXTURE_2D, ID);
+
+		// set the texture wrapping/filtering options (on the currently bound texture object)
+
+		// Repeat texture if sampling outside of the 0, 1 region
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+		// Linearly interpolate for minification + magnification
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+
+	// Upload a cooked container with its precomputed mip chain (texture bound)
+	void loadCooked(const std::string& cookedFilePath)
+	{
+		std::vector<unsigned char> bytes;
+		CookedTextureView cooked;
+		if (!readCookedTexture(cookedFilePath, bytes, cooked))
+		{
+			std::cout << "Failed to load cooked texture: " << cookedFilePath << " " << std::endl;
+			return;
+		}
+		uploadCooked(cooked);
+		std::cout << "Successfully loaded " << cookedFilePath << (compressedBlockBytes > 0 ? " (compressed)" : " (decompressed, no S3TC support)") << std::endl;
+	}
+
+	void uploadCooked(const CookedTextureView& cooked)
+	{
+		bool compressed = isS3TCSupported();
+		GLenum internalFormat = cooked.format == COOKED_TEXTURE_BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		std::vector<unsigned char> pixels;
+		for (size_t level = 0; level < cooked.mips.size(); level++)
+		{
+			const CookedMipView& mip = cooked.mips[level];
+			if (compressed)
+			{
+				glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, internalFormat, mip.width, mip.height, 0, (GLsizei)mip.size, mip.blocks);
+			}
+			else
+			{
+				decompressTextureImage(mip, cooked.format, pixels);
+				glTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_RGBA, mip.width, mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+			}
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)cooked.mips.size() - 1);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+		width = cooked.width;
+		height = cooked.height;
+		nChannels = cooked.format == COOKED_TEXTURE_BC3 ? 4 : 3;
+		resident = true;
+		hasMipmaps = true;
+		compressedBlockBytes = compressed ? (cooked.format == COOKED_TEXTURE_BC3 ? 16 : 8) : 0;
+	}
+
 	unsigned int ID;
 	unsigned char* data;
 
 	int width;
 	int height;
 	int nChannels;
+	bool resident;
+	bool hasMipmaps;
+	int compressedBlockBytes; // 0 -> uncompressed
+	std::string name;
 };
 
+inline TextureMemoryUsage TextureMemory::getTotal()
+{
+	std::lock_guard<std::mutex> lock(getMutex());
+	TextureMemoryUsage total;
+	for (Texture* texture : getTextures())
+	{
+		TextureMemoryUsage usage = texture->getMemoryUsage();
+		total.cpuBytes += usage.cpuBytes;
+		total.gpuBytes += usage.gpuBytes;
+	}
+	return total;
+}
+
+// One line per texture plus the totals
+inline void TextureMemory::printReport(std::ostream& out)
+{
+	std::lock_guard<std::mutex> lock(getMutex());
+	TextureMemoryUsage total;
+	for (Texture* texture : getTextures())
+	{
+		TextureMemoryUsage usage = texture->getMemoryUsage();
+		out << "  " << texture->getName() << " (" << texture->getWidth() << "x" << texture->getHeight() << "): " << usage.cpuBytes << " CPU bytes, " << usage.gpuBytes << " GPU bytes" << std::endl;
+		total.cpuBytes += usage.cpuBytes;
+		total.gpuBytes += usage.gpuBytes;
+	}
+	out << "Textures: " << getTextures().size() << ", " << total.cpuBytes << " CPU bytes, " << total.gpuBytes << " GPU bytes" << std::endl;
+}
+
 
 #endif
\ No newline at end of file
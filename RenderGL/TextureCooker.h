@@ -0,0 +1,547 @@
+#ifndef TEXTURE_COOKER_H
+#define TEXTURE_COOKER_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+#include "stb_image.h"
+
+// Offline texture cooking: source images are decoded once, their mip chain is computed on the CPU and every level is block
+// compressed (BC1 for opaque images, BC3 with alpha), then stored in a small container the Texture constructor uploads with
+// glCompressedTexImage2D as is. No image decoding or glGenerateMipmap at startup, and 4x (BC3) to 8x (BC1) less texture memory.
+//
+// Container (.rtex, little endian): "RTEX", uint32 version, uint32 format, uint32 width, uint32 height, uint32 mip count,
+// then per mip level (largest first) uint32 byte count followed by the blocks, rows of 4x4 blocks bottom to top like GL expects
+
+#define COOKED_TEXTURE_MAGIC 0x58455452u // "RTEX"
+#define COOKED_TEXTURE_VERSION 1u
+#define COOKED_TEXTURE_MAX_SIZE 16384 // Largest width/height cooked or accepted, the minimum GL_MAX_TEXTURE_SIZE of current GPUs
+
+enum CookedTextureFormat
+{
+	COOKED_TEXTURE_BC1 = 1, // RGB, 8 bytes per 4x4 block
+	COOKED_TEXTURE_BC3 = 2  // RGBA, 16 bytes per 4x4 block
+};
+
+struct CookedMip
+{
+	int width = 0;
+	int height = 0;
+	std::vector<unsigned char> blocks;
+};
+
+struct CookedTexture
+{
+	CookedTextureFormat format = COOKED_TEXTURE_BC1;
+	int width = 0;
+	int height = 0;
+	std::vector<CookedMip> mips;
+
+	int getBlockBytes() const
+	{
+		return format == COOKED_TEXTURE_BC3 ? 16 : 8;
+	}
+};
+
+// A mip level of a container that is in memory already
+struct CookedMipView
+{
+	int width = 0;
+	int height = 0;
+	const unsigned char* blocks = nullptr;
+	size_t size = 0;
+};
+
+struct CookedTextureView
+{
+	CookedTextureFormat format = COOKED_TEXTURE_BC1;
+	int width = 0;
+	int height = 0;
+	std::vector<CookedMipView> mips;
+};
+
+// 8 bit RGBA to 5:6:5 and back (with the bit replication hardware uses)
+inline uint16_t packColor565(const int* rgb)
+{
+	int r = std::min(31, std::max(0, (rgb[0] * 31 + 127) / 255));
+	int g = std::min(63, std::max(0, (rgb[1] * 63 + 127) / 255));
+	int b = std::min(31, std::max(0, (rgb[2] * 31 + 127) / 255));
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+inline void unpackColor565(uint16_t color, int* rgb)
+{
+	int r = (color >> 11) & 31;
+	int g = (color >> 5) & 63;
+	int b = color & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Endpoints at the extremes of the block's colors along their principal axis, then every texel gets the nearest of the
+// 4 palette colors. Always the 4 color mode, which BC3 color blocks require
+inline void encodeBC1Block(const unsigned char* block, unsigned char* out)
+{
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			mean[c] += block[i * 4 + c] / 16.0f;
+		}
+	}
+	float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f }; // rr rg rb gg gb bb
+	for (int i = 0; i < 16; i++)
+	{
+		float r = block[i * 4 + 0] - mean[0];
+		float g = block[i * 4 + 1] - mean[1];
+		float b = block[i * 4 + 2] - mean[2];
+		covariance[0] += r * r;
+		covariance[1] += r * g;
+		covariance[2] += r * b;
+		covariance[3] += g * g;
+		covariance[4] += g * b;
+		covariance[5] += b * b;
+	}
+
+	// Power iteration for the dominant eigenvector
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 4; iteration++)
+	{
+		float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+		float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+		float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+		float length = std::max(std::max(std::abs(x), std::abs(y)), std::abs(z));
+		if (length < 1e-6f)
+		{
+			break; // Flat block, keep the previous axis
+		}
+		axis[0] = x / length;
+		axis[1] = y / length;
+		axis[2] = z / length;
+	}
+
+	int minIndex = 0;
+	int maxIndex = 0;
+	float minProjection = 1e30f;
+	float maxProjection = -1e30f;
+	for (int i = 0; i < 16; i++)
+	{
+		float projection = block[i * 4 + 0] * axis[0] + block[i * 4 + 1] * axis[1] + block[i * 4 + 2] * axis[2];
+		if (projection < minProjection)
+		{
+			minProjection = projection;
+			minIndex = i;
+		}
+		if (projection > maxProjection)
+		{
+			maxProjection = projection;
+			maxIndex = i;
+		}
+	}
+
+	int maxColor[3] = { block[maxIndex * 4 + 0], block[maxIndex * 4 + 1], block[maxIndex * 4 + 2] };
+	int minColor[3] = { block[minIndex * 4 + 0], block[minIndex * 4 + 1], block[minIndex * 4 + 2] };
+	uint16_t color0 = packColor565(maxColor);
+	uint16_t color1 = packColor565(minColor);
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		int palette[4][3];
+		unpackColor565(color0, palette[0]);
+		unpackColor565(color1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0;
+			int bestDistance = 1 << 30;
+			for (int p = 0; p < 4; p++)
+			{
+				int dr = block[i * 4 + 0] - palette[p][0];
+				int dg = block[i * 4 + 1] - palette[p][1];
+				int db = block[i * 4 + 2] - palette[p][2];
+				int distance = dr * dr + dg * dg + db * db;
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= (uint32_t)best << (i * 2);
+		}
+	}
+
+	out[0] = (unsigned char)(color0 & 0xFF);
+	out[1] = (unsigned char)(color0 >> 8);
+	out[2] = (unsigned char)(color1 & 0xFF);
+	out[3] = (unsigned char)(color1 >> 8);
+	for (int i = 0; i < 4; i++)
+	{
+		out[4 + i] = (unsigned char)(indices >> (i * 8));
+	}
+}
+
+// Alpha endpoints are the block's max and min alpha, 6 interpolated values between them (8 value mode)
+inline void encodeBC3AlphaBlock(const unsigned char* block, unsigned char* out)
+{
+	int alpha0 = 0;
+	int alpha1 = 255;
+	for (int i = 0; i < 16; i++)
+	{
+		alpha0 = std::max(alpha0, (int)block[i * 4 + 3]);
+		alpha1 = std::min(alpha1, (int)block[i * 4 + 3]);
+	}
+
+	uint64_t indices = 0;
+	if (alpha0 != alpha1)
+	{
+		int palette[8];
+		palette[0] = alpha0;
+		palette[1] = alpha1;
+		for (int i = 1; i < 7; i++)
+		{
+			palette[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7;
+		}
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0;
+			int bestDistance = 256;
+			for (int p = 0; p < 8; p++)
+			{
+				int distance = std::abs(block[i * 4 + 3] - palette[p]);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= (uint64_t)best << (i * 3);
+		}
+	}
+
+	out[0] = (unsigned char)alpha0;
+	out[1] = (unsigned char)alpha1;
+	for (int i = 0; i < 6; i++)
+	{
+		out[2 + i] = (unsigned char)(indices >> (i * 8));
+	}
+}
+
+// 4 color mode only, which is all encodeBC1Block() writes
+inline void decodeBC1Block(const unsigned char* in, unsigned char* block)
+{
+	uint16_t color0 = (uint16_t)(in[0] | (in[1] << 8));
+	uint16_t color1 = (uint16_t)(in[2] | (in[3] << 8));
+	int palette[4][3];
+	unpackColor565(color0, palette[0]);
+	unpackColor565(color1, palette[1]);
+	for (int c = 0; c < 3; c++)
+	{
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+	uint32_t indices = (uint32_t)in[4] | ((uint32_t)in[5] << 8) | ((uint32_t)in[6] << 16) | ((uint32_t)in[7] << 24);
+	for (int i = 0; i < 16; i++)
+	{
+		int index = (indices >> (i * 2)) & 3;
+		block[i * 4 + 0] = (unsigned char)palette[index][0];
+		block[i * 4 + 1] = (unsigned char)palette[index][1];
+		block[i * 4 + 2] = (unsigned char)palette[index][2];
+		block[i * 4 + 3] = 255;
+	}
+}
+
+inline void decodeBC3AlphaBlock(const unsigned char* in, unsigned char* block)
+{
+	int palette[8];
+	palette[0] = in[0];
+	palette[1] = in[1];
+	if (palette[0] > palette[1])
+	{
+		for (int i = 1; i < 7; i++)
+		{
+			palette[i + 1] = ((7 - i) * palette[0] + i * palette[1]) / 7;
+		}
+	}
+	else
+	{
+		for (int i = 1; i < 5; i++)
+		{
+			palette[i + 1] = ((5 - i) * palette[0] + i * palette[1]) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+	uint64_t indices = 0;
+	for (int i = 0; i < 6; i++)
+	{
+		indices |= (uint64_t)in[2 + i] << (i * 8);
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		block[i * 4 + 3] = (unsigned char)palette[(indices >> (i * 3)) & 7];
+	}
+}
+
+// Compress an RGBA8 image, partial blocks at the edges repeat the last row/column
+inline void compressTextureImage(const unsigned char* pixels, int width, int height, CookedTextureFormat format, std::vector<unsigned char>& blocks)
+{
+	int blockBytes = format == COOKED_TEXTURE_BC3 ? 16 : 8;
+	int blocksX = (width + 3) / 4;
+	int blocksY = (height + 3) / 4;
+	blocks.resize((size_t)blocksX * blocksY * blockBytes);
+	unsigned char block[16 * 4];
+	for (int by = 0; by < blocksY; by++)
+	{
+		for (int bx = 0; bx < blocksX; bx++)
+		{
+			for (int y = 0; y < 4; y++)
+			{
+				for (int x = 0; x < 4; x++)
+				{
+					int sourceX = std::min(bx * 4 + x, width - 1);
+					int sourceY = std::min(by * 4 + y, height - 1);
+					memcpy(&block[(y * 4 + x) * 4], &pixels[((size_t)sourceY * width + sourceX) * 4], 4);
+				}
+			}
+			unsigned char* out = &blocks[((size_t)by * blocksX + bx) * blockBytes];
+			if (format == COOKED_TEXTURE_BC3)
+			{
+				encodeBC3AlphaBlock(block, out);
+				out += 8;
+			}
+			encodeBC1Block(block, out);
+		}
+	}
+}
+
+// Back to RGBA8, for GL implementations without S3TC support
+inline void decompressTextureImage(const CookedMipView& mip, CookedTextureFormat format, std::vector<unsigned char>& pixels)
+{
+	int blockBytes = format == COOKED_TEXTURE_BC3 ? 16 : 8;
+	int blocksX = (mip.width + 3) / 4;
+	int blocksY = (mip.height + 3) / 4;
+	pixels.resize((size_t)mip.width * mip.height * 4);
+	unsigned char block[16 * 4];
+	for (int by = 0; by < blocksY; by++)
+	{
+		for (int bx = 0; bx < blocksX; bx++)
+		{
+			const unsigned char* in = &mip.blocks[((size_t)by * blocksX + bx) * blockBytes];
+			if (format == COOKED_TEXTURE_BC3)
+			{
+				decodeBC1Block(in + 8, block);
+				decodeBC3AlphaBlock(in, block);
+			}
+			else
+			{
+				decodeBC1Block(in, block);
+			}
+			for (int y = 0; y < 4 && by * 4 + y < mip.height; y++)
+			{
+				for (int x = 0; x < 4 && bx * 4 + x < mip.width; x++)
+				{
+					memcpy(&pixels[((size_t)(by * 4 + y) * mip.width + bx * 4 + x) * 4], &block[(y * 4 + x) * 4], 4);
+				}
+			}
+		}
+	}
+}
+
+// Next mip level of an RGBA8 image, 2x2 box filter (odd sizes repeat the last row/column)
+inline void downsampleTextureImage(const std::vector<unsigned char>& pixels, int width, int height, std::vector<unsigned char>& result)
+{
+	int resultWidth = std::max(1, width / 2);
+	int resultHeight = std::max(1, height / 2);
+	result.resize((size_t)resultWidth * resultHeight * 4);
+	for (int y = 0; y < resultHeight; y++)
+	{
+		int y0 = std::min(y * 2, height - 1);
+		int y1 = std::min(y * 2 + 1, height - 1);
+		for (int x = 0; x < resultWidth; x++)
+		{
+			int x0 = std::min(x * 2, width - 1);
+			int x1 = std::min(x * 2 + 1, width - 1);
+			for (int c = 0; c < 4; c++)
+			{
+				int sum = pixels[((size_t)y0 * width + x0) * 4 + c] + pixels[((size_t)y0 * width + x1) * 4 + c]
+					+ pixels[((size_t)y1 * width + x0) * 4 + c] + pixels[((size_t)y1 * width + x1) * 4 + c];
+				result[((size_t)y * resultWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+// Full mip chain down to 1x1 of an RGBA8 image
+inline CookedTexture cookTextureImage(const unsigned char* pixels, int width, int height, CookedTextureFormat format)
+{
+	CookedTexture cooked;
+	cooked.format = format;
+	cooked.width = width;
+	cooked.height = height;
+	std::vector<unsigned char> level(pixels, pixels + (size_t)width * height * 4);
+	std::vector<unsigned char> nextLevel;
+	while (true)
+	{
+		CookedMip mip;
+		mip.width = width;
+		mip.height = height;
+		compressTextureImage(level.data(), width, height, format, mip.blocks);
+		cooked.mips.push_back(mip);
+		if (width == 1 && height == 1)
+		{
+			break;
+		}
+		downsampleTextureImage(level, width, height, nextLevel);
+		level.swap(nextLevel);
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+	return cooked;
+}
+
+inline bool writeCookedTexture(const std::string& path, const CookedTexture& cooked)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+	uint32_t header[6] = { COOKED_TEXTURE_MAGIC, COOKED_TEXTURE_VERSION, (uint32_t)cooked.format, (uint32_t)cooked.width, (uint32_t)cooked.height, (uint32_t)cooked.mips.size() };
+	file.write((const char*)header, sizeof(header));
+	for (const CookedMip& mip : cooked.mips)
+	{
+		uint32_t size = (uint32_t)mip.blocks.size();
+		file.write((const char*)&size, sizeof(size));
+		file.write((const char*)mip.blocks.data(), size);
+	}
+	return (bool)file;
+}
+
+// Number of levels in a full mip chain down to 1x1
+inline uint32_t getMipCount(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+	{
+		count++;
+	}
+	return count;
+}
+
+// Blocks of a container in memory (a file read whole or an asset pack mapping), without copying them.
+// False if the bytes are not a valid container. Everything is checked against the data actually there, the container may be
+// corrupt or come from an untrusted pack
+inline bool parseCookedTexture(const unsigned char* bytes, size_t size, CookedTextureView& view)
+{
+	uint32_t header[6];
+	if (size < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(header, bytes, sizeof(header));
+	if (header[0] != COOKED_TEXTURE_MAGIC || header[1] != COOKED_TEXTURE_VERSION || (header[2] != COOKED_TEXTURE_BC1 && header[2] != COOKED_TEXTURE_BC3)
+		|| header[3] == 0 || header[3] > COOKED_TEXTURE_MAX_SIZE || header[4] == 0 || header[4] > COOKED_TEXTURE_MAX_SIZE
+		|| header[5] == 0 || header[5] > getMipCount(header[3], header[4]))
+	{
+		return false;
+	}
+	view.format = (CookedTextureFormat)header[2];
+	view.width = (int)header[3];
+	view.height = (int)header[4];
+	view.mips.resize(header[5]);
+	size_t offset = sizeof(header);
+	int width = view.width;
+	int height = view.height;
+	for (CookedMipView& mip : view.mips)
+	{
+		uint32_t mipSize = 0;
+		if (sizeof(mipSize) > size - offset)
+		{
+			return false;
+		}
+		memcpy(&mipSize, bytes + offset, sizeof(mipSize));
+		offset += sizeof(mipSize);
+		uint64_t expectedSize = (uint64_t)((width + 3) / 4) * (uint64_t)((height + 3) / 4) * (view.format == COOKED_TEXTURE_BC3 ? 16 : 8);
+		if (mipSize != expectedSize || mipSize > size - offset)
+		{
+			return false;
+		}
+		mip.width = width;
+		mip.height = height;
+		mip.blocks = bytes + offset;
+		mip.size = mipSize;
+		offset += mipSize;
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+	return true;
+}
+
+// Read a container file whole into bytes, view points into them
+inline bool readCookedTexture(const std::string& path, std::vector<unsigned char>& bytes, CookedTextureView& view)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		return false;
+	}
+	bytes.resize((size_t)file.tellg());
+	file.seekg(0);
+	if (!file.read((char*)bytes.data(), bytes.size()))
+	{
+		return false;
+	}
+	return parseCookedTexture(bytes.data(), bytes.size(), view);
+}
+
+// Cook a source image into a container, BC3 if the image has an alpha channel, BC1 otherwise.
+// Flipped vertically like the Texture constructor flips its images
+inline bool cookTexture(const std::string& imageFilePath, const std::string& cookedFilePath)
+{
+	stbi_set_flip_vertically_on_load(true);
+	int width = 0;
+	int height = 0;
+	int nChannels = 0;
+	unsigned char* pixels = stbi_load(imageFilePath.c_str(), &width, &height, &nChannels, 4);
+	if (!pixels)
+	{
+		std::cout << "Failed to cook texture (stbi_load() failed): " << imageFilePath << std::endl;
+		return false;
+	}
+	if (width > COOKED_TEXTURE_MAX_SIZE || height > COOKED_TEXTURE_MAX_SIZE)
+	{
+		std::cout << "Failed to cook texture (larger than " << COOKED_TEXTURE_MAX_SIZE << " pixels): " << imageFilePath << std::endl;
+		stbi_image_free(pixels);
+		return false;
+	}
+	CookedTextureFormat format = nChannels == 2 || nChannels == 4 ? COOKED_TEXTURE_BC3 : COOKED_TEXTURE_BC1;
+	CookedTexture cooked = cookTextureImage(pixels, width, height, format);
+	stbi_image_free(pixels);
+
+	if (!writeCookedTexture(cookedFilePath, cooked))
+	{
+		std::cout << "Failed to write cooked texture: " << cookedFilePath << std::endl;
+		return false;
+	}
+	std::cout << "Cooked " << imageFilePath << " (" << width << "x" << height << ", " << cooked.mips.size() << " mips, "
+		<< (format == COOKED_TEXTURE_BC3 ? "BC3" : "BC1") << ") into " << cookedFilePath << std::endl;
+	return true;
+}
+
+#endif
@@ -0,0 +1,255 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include <string>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+
+#include "Texture.h"
+#include "ThreadPool.h"
+#include "MipGenerator.h"
+#include "stb_image.h"
+
+#define DEFAULT_TEXTURE_UPLOAD_BUDGET (8 * 1024 * 1024) // Bytes uploaded per frame at most (a single bigger image still gets through)
+
+// Asynchronous texture loading: images are decoded on a thread pool, then uploaded on the GL thread through a pixel buffer object,
+// a bounded number of bytes per update() (call once per frame). Until then load() hands out a placeholder, see Texture()
+class TextureLoader
+{
+public:
+	TextureLoader(ThreadPool& pool_in, size_t uploadBudget_in = DEFAULT_TEXTURE_UPLOAD_BUDGET) :
+		pool(pool_in),
+		uploadBudget(uploadBudget_in),
+		PBO(0),
+		decoding(0),
+		pendingCount(0),
+		cpuMips(false)
+	{
+		glGenBuffers(1, &PBO);
+	}
+	~TextureLoader()
+	{
+		// Decode tasks still running reference this loader
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			decodingDone.wait(lock, [this]() { return decoding == 0; });
+		}
+		for (DecodedImage& image : decoded)
+		{
+			stbi_image_free(image.pixels);
+		}
+		glDeleteBuffers(1, &PBO);
+	}
+	TextureLoader(const TextureLoader&) = delete;
+	TextureLoader& operator=(const TextureLoader&) = delete;
+
+	// Start loading an image, the texture is usable (as a placeholder) right away and becomes resident in a later update()
+	std::shared_ptr<Texture> load(const std::string& imageFilePath, TextureRetention retention = TEXTURE_RELEASE_AFTER_UPLOAD)
+	{
+		// Cooked textures need no decoding, they are ready to upload as soon as they are read. They can't retain pixels (see
+		// TextureRetention), the Texture reports it
+		if (imageFilePath.size() > 5 && imageFilePath.compare(imageFilePath.size() - 5, 5, ".rtex") == 0)
+		{
+			return std::make_shared<Texture>(imageFilePath, retention);
+		}
+
+		std::shared_ptr<Texture> texture(new Texture());
+		texture->setName(imageFilePath);
+		startDecode(texture, imageFilePath, retention);
+		return texture;
+	}
+
+	// Load the (changed) file again into an existing texture, it keeps showing the old image until the new one is uploaded in
+	// update() (or for good if decoding fails). Cooked textures are reloaded right away
+	void reload(const std::shared_ptr<Texture>& texture, const std::string& imageFilePath, TextureRetention retention = TEXTURE_RELEASE_AFTER_UPLOAD)
+	{
+		if (imageFilePath.size() > 5 && imageFilePath.compare(imageFilePath.size() - 5, 5, ".rtex") == 0)
+		{
+			if (retention == TEXTURE_RETAIN_PIXELS)
+			{
+				std::cout << "ERROR::TEXTURE::CANNOT_RETAIN_COOKED_PIXELS " << imageFilePath << std::endl;
+			}
+			texture->reload(imageFilePath);
+			return;
+		}
+		startDecode(texture, imageFilePath, retention);
+	}
+
+	// Compute the mip chains of textures loaded from now on on the decode threads (see MipGenerator.h) instead of glGenerateMipmap
+	void enableCPUMips(const MipSettings& settings)
+	{
+		cpuMips = true;
+		mipSettings = settings;
+	}
+
+	// Upload decoded images until this frame's budget is used up, returns how many became resident. GL thread only
+	unsigned int update()
+	{
+		unsigned int uploaded = 0;
+		size_t uploadedBytes = 0;
+		while (true)
+		{
+			DecodedImage image;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (decoded.empty())
+				{
+					break;
+				}
+				size_t size = getUploadSize(decoded.front());
+				if (uploadedBytes > 0 && uploadedBytes + size > uploadBudget)
+				{
+					break;
+				}
+				image = decoded.front();
+				decoded.pop_front();
+			}
+
+			pendingCount--;
+			if (!image.pixels)
+			{
+				std::cout << "Failed to load texture (stbi_load() failed): " << image.path << " " << std::endl;
+				continue;
+			}
+			uploadedBytes += upload(image);
+			if (image.retention == TEXTURE_RETAIN_PIXELS)
+			{
+				image.texture->retainPixels(image.pixels);
+			}
+			else
+			{
+				stbi_image_free(image.pixels);
+			}
+			uploaded++;
+		}
+		return uploaded;
+	}
+
+	// Textures requested but not resident (or failed) yet
+	unsigned int getPendingCount()
+	{
+		return pendingCount;
+	}
+
+private:
+	struct DecodedImage
+	{
+		std::shared_ptr<Texture> texture;
+		std::string path;
+		unsigned char* pixels = nullptr;
+		int width = 0;
+		int height = 0;
+		int nChannels = 0;
+		TextureRetention retention = TEXTURE_RELEASE_AFTER_UPLOAD;
+		std::vector<MipLevel> mips; // Empty -> glGenerateMipmap
+	};
+
+	void startDecode(const std::shared_ptr<Texture>& texture, const std::string& imageFilePath, TextureRetention retention)
+	{
+		pendingCount++;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			decoding++;
+		}
+		bool generateMips = cpuMips;
+		MipSettings settings = mipSettings;
+		pool.submit([this, texture, imageFilePath, retention, generateMips, settings]() { decode(texture, imageFilePath, retention, generateMips ? &settings : nullptr); });
+	}
+
+	static size_t getUploadSize(const DecodedImage& image)
+	{
+		size_t size = (size_t)image.width * image.height * image.nChannels;
+		for (const MipLevel& mip : image.mips)
+		{
+			size += mip.pixels.size();
+		}
+		return size;
+	}
+
+	// Worker thread: no GL calls in here
+	void decode(const std::shared_ptr<Texture>& texture, const std::string& imageFilePath, TextureRetention retention, const MipSettings* mipSettings)
+	{
+		DecodedImage image;
+		image.texture = texture;
+		image.path = imageFilePath;
+		image.retention = retention;
+
+		// Flipped like the synchronous Texture constructor, but without touching the global flag other threads read
+		stbi_set_flip_vertically_on_load_thread(true);
+		int fileChannels = 0;
+		if (stbi_info(imageFilePath.c_str(), &image.width, &image.height, &fileChannels))
+		{
+			// Grey/grey + alpha are expanded, textures are always RGB or RGBA
+			int channels = fileChannels == 2 || fileChannels == 4 ? 4 : 3;
+			image.pixels = stbi_load(imageFilePath.c_str(), &image.width, &image.height, &fileChannels, channels);
+			image.nChannels = channels;
+			if (image.pixels && mipSettings)
+			{
+				image.mips = generateMipChain(image.pixels, image.width, image.height, channels, *mipSettings);
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		decoded.push_back(image);
+		decoding--;
+		if (decoding == 0)
+		{
+			decodingDone.notify_all();
+		}
+	}
+
+	// Copy into the (orphaned) PBO, so glTexImage2D reads from driver memory and the copy to the texture can happen asynchronously.
+	// Precomputed mip levels follow the image in the same buffer
+	size_t upload(const DecodedImage& image)
+	{
+		size_t size = getUploadSize(image);
+		size_t imageSize = (size_t)image.width * image.height * image.nChannels;
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, PBO);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+		unsigned char* mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		std::vector<const void*> mipPixels;
+		if (mapped)
+		{
+			memcpy(mapped, image.pixels, imageSize);
+			size_t offset = imageSize;
+			for (const MipLevel& mip : image.mips)
+			{
+				memcpy(mapped + offset, mip.pixels.data(), mip.pixels.size());
+				mipPixels.push_back((const void*)offset);
+				offset += mip.pixels.size();
+			}
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			image.texture->setImage(image.width, image.height, image.nChannels, (void*)0, mipPixels);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		if (!mapped)
+		{
+			for (const MipLevel& mip : image.mips)
+			{
+				mipPixels.push_back(mip.pixels.data());
+			}
+			image.texture->setImage(image.width, image.height, image.nChannels, image.pixels, mipPixels);
+		}
+		return size;
+	}
+
+	ThreadPool& pool;
+	size_t uploadBudget;
+	unsigned int PBO;
+
+	std::mutex mutex;
+	std::condition_variable decodingDone;
+	std::deque<DecodedImage> decoded; // Waiting for upload
+	unsigned int decoding;            // Decode tasks not finished yet
+	unsigned int pendingCount;        // GL thread only
+	bool cpuMips;
+	MipSettings mipSettings;
+};
+
+#endif
@@ -0,0 +1,273 @@
+#ifndef TEXTURE_MANAGER_H
+#define TEXTURE_MANAGER_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <algorithm>
+#include <unordered_map>
+#include <memory>
+#include <fstream>
+#include <cstdint>
+#include <stdlib.h> // realpath/_fullpath
+
+#include "Texture.h"
+#include "TextureLoader.h"
+
+#define DEFAULT_TEXTURE_CACHE_BUDGET (256 * 1024 * 1024) // Estimated GPU bytes kept around for textures nobody uses anymore
+
+// Counters since the manager was created
+struct TextureCacheStats
+{
+	unsigned int pathHits = 0;    // Same file requested again
+	unsigned int contentHits = 0; // Different file, identical bytes
+	unsigned int misses = 0;      // Decoded and uploaded
+	unsigned int evictions = 0;
+	unsigned int reloads = 0;     // Cached textures loaded again because their file changed
+};
+
+// Deduplicates textures: a texture is loaded once per canonical path, and files with identical contents share it as well.
+// Handles are shared_ptrs, a texture only the manager still references is unused and gets evicted, least recently requested
+// first, once the cached textures take more than the memory budget (estimated GPU bytes, see Texture::getMemoryUsage())
+class TextureManager
+{
+public:
+	// With a loader, textures load asynchronously (placeholder first, see TextureLoader), otherwise with the Texture constructor
+	TextureManager(size_t memoryBudget_in = DEFAULT_TEXTURE_CACHE_BUDGET, TextureLoader* loader_in = nullptr) :
+		memoryBudget(memoryBudget_in),
+		loader(loader_in)
+	{
+	}
+	TextureManager(const TextureManager&) = delete;
+	TextureManager& operator=(const TextureManager&) = delete;
+
+	std::shared_ptr<Texture> get(const std::string& imageFilePath)
+	{
+		std::string path = getCanonicalPath(imageFilePath);
+		auto pathIt = entryOfPath.find(path);
+		if (pathIt != entryOfPath.end())
+		{
+			stats.pathHits++;
+			return use(pathIt->second);
+		}
+
+		// New path, but the file may be a copy of one that is loaded already
+		uint64_t hash = 0;
+		bool hashed = hashFile(path, hash);
+		if (hashed)
+		{
+			auto hashIt = entryOfHash.find(hash);
+			if (hashIt != entryOfHash.end())
+			{
+				stats.contentHits++;
+				entryOfPath[path] = hashIt->second;
+				hashIt->second->paths.push_back(path);
+				return use(hashIt->second);
+			}
+		}
+
+		stats.misses++;
+		Entry entry;
+		entry.texture = loader ? loader->load(path) : std::make_shared<Texture>(path);
+		entry.paths.push_back(path);
+		entry.hash = hash;
+		entry.hashed = hashed;
+		entries.push_front(entry);
+		entryOfPath[path] = entries.begin();
+		if (hashed)
+		{
+			entryOfHash[hash] = entries.begin();
+		}
+		std::shared_ptr<Texture> texture = entries.front().texture; // Referenced, so trim() keeps it
+		trim();
+		return texture;
+	}
+
+	// Evict unused textures, least recently requested first, until the cache fits the budget (or only used ones are left)
+	void trim()
+	{
+		size_t cachedBytes = getCachedBytes();
+		auto it = entries.end();
+		while (cachedBytes > memoryBudget && it != entries.begin())
+		{
+			--it;
+			if (it->texture.use_count() > 1)
+			{
+				continue;
+			}
+			cachedBytes -= it->texture->getMemoryUsage().gpuBytes;
+			for (const std::string& path : it->paths)
+			{
+				entryOfPath.erase(path);
+			}
+			auto hashIt = it->hashed ? entryOfHash.find(it->hash) : entryOfHash.end();
+			if (hashIt != entryOfHash.end() && hashIt->second == it)
+			{
+				entryOfHash.erase(hashIt);
+			}
+			it = entries.erase(it);
+			stats.evictions++;
+		}
+	}
+
+	// Load a cached texture again because its file changed. The Texture object stays the same, so everyone holding it sees the
+	// new image (through the loader once it's decoded and uploaded, if there is one). If other files shared the texture because
+	// they had identical contents, the changed file gets a texture of its own instead (handed out by get() from now on) and the
+	// others keep the old one. False if the file isn't cached
+	bool reload(const std::string& imageFilePath)
+	{
+		std::string path = getCanonicalPath(imageFilePath);
+		auto pathIt = entryOfPath.find(path);
+		if (pathIt == entryOfPath.end())
+		{
+			return false;
+		}
+		std::list<Entry>::iterator entryIt = pathIt->second;
+		TextureRetention retention = entryIt->texture->getPixels() ? TEXTURE_RETAIN_PIXELS : TEXTURE_RELEASE_AFTER_UPLOAD;
+		stats.reloads++;
+
+		if (entryIt->paths.size() > 1)
+		{
+			// The other paths still have the old contents, so the old hash keeps pointing at their entry
+			entryIt->paths.erase(std::find(entryIt->paths.begin(), entryIt->paths.end(), path));
+			Entry entry;
+			entry.texture = loader ? loader->load(path, retention) : std::make_shared<Texture>(path, retention);
+			entry.paths.push_back(path);
+			entry.hashed = hashFile(path, entry.hash);
+			entries.push_front(entry);
+			entryOfPath[path] = entries.begin();
+			if (entry.hashed)
+			{
+				entryOfHash.insert(std::make_pair(entry.hash, entries.begin())); // Unless another texture has these contents already
+			}
+			return true;
+		}
+
+		Entry& entry = *entryIt;
+		auto hashIt = entry.hashed ? entryOfHash.find(entry.hash) : entryOfHash.end();
+		if (hashIt != entryOfHash.end() && hashIt->second == entryIt)
+		{
+			entryOfHash.erase(hashIt);
+		}
+		entry.hashed = hashFile(path, entry.hash);
+		if (entry.hashed)
+		{
+			entryOfHash.insert(std::make_pair(entry.hash, entryIt)); // Unless another texture has these contents already
+		}
+
+		if (loader)
+		{
+			loader->reload(entry.texture, path, retention);
+		}
+		else
+		{
+			entry.texture->reload(path);
+		}
+		return true;
+	}
+
+	// Drop every texture nobody else references
+	void clearUnused()
+	{
+		size_t budget = memoryBudget;
+		memoryBudget = 0;
+		trim();
+		memoryBudget = budget;
+	}
+
+	void setMemoryBudget(size_t memoryBudget_in)
+	{
+		memoryBudget = memoryBudget_in;
+		trim();
+	}
+
+	// Estimated GPU bytes of all cached textures, used or not
+	size_t getCachedBytes()
+	{
+		size_t bytes = 0;
+		for (Entry& entry : entries)
+		{
+			bytes += entry.texture->getMemoryUsage().gpuBytes;
+		}
+		return bytes;
+	}
+
+	size_t getTextureCount()
+	{
+		return entries.size();
+	}
+
+	const TextureCacheStats& getStats()
+	{
+		return stats;
+	}
+
+	// Absolute path with ".", ".." and symlinks resolved, so different spellings of a path find the same texture.
+	// Falls back to the path as given if the file doesn't exist (the load then fails and reports it)
+	static std::string getCanonicalPath(const std::string& path)
+	{
+#if defined(_WIN32)
+		char resolved[_MAX_PATH];
+		if (_fullpath(resolved, path.c_str(), _MAX_PATH))
+		{
+			return resolved;
+		}
+#else
+		char* resolved = realpath(path.c_str(), NULL);
+		if (resolved)
+		{
+			std::string canonical(resolved);
+			free(resolved);
+			return canonical;
+		}
+#endif
+		return path;
+	}
+
+	// 64 bit FNV-1a of the file contents
+	static bool hashFile(const std::string& path, uint64_t& hash)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+		{
+			return false;
+		}
+		hash = 14695981039346656037ull;
+		char buffer[64 * 1024];
+		while (file)
+		{
+			file.read(buffer, sizeof(buffer));
+			std::streamsize count = file.gcount();
+			for (std::streamsize i = 0; i < count; i++)
+			{
+				hash = (hash ^ (unsigned char)buffer[i]) * 1099511628211ull;
+			}
+		}
+		return true;
+	}
+
+private:
+	struct Entry
+	{
+		std::shared_ptr<Texture> texture;
+		std::vector<std::string> paths; // Canonical paths that resolved to this texture
+		uint64_t hash = 0;
+		bool hashed = false;
+	};
+
+	// Move to the front of the LRU list
+	std::shared_ptr<Texture> use(std::list<Entry>::iterator entry)
+	{
+		entries.splice(entries.begin(), entries, entry);
+		return entry->texture;
+	}
+
+	size_t memoryBudget;
+	TextureLoader* loader;
+	std::list<Entry> entries; // Most recently requested first
+	std::unordered_map<std::string, std::list<Entry>::iterator> entryOfPath;
+	std::unordered_map<uint64_t, std::list<Entry>::iterator> entryOfHash;
+	TextureCacheStats stats;
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+// Fixed set of worker threads running queued tasks in FIFO order. Tasks must not touch OpenGL, there is no context on the workers
+class ThreadPool
+{
+public:
+	// 0 -> one thread per core
+	ThreadPool(unsigned int threadCount = 0) : activeTasks(0), stopping(false)
+	{
+		if (threadCount == 0)
+		{
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		}
+		for (unsigned int i = 0; i < threadCount; i++)
+		{
+			workers.emplace_back(&ThreadPool::workerLoop, this);
+		}
+	}
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		taskAvailable.notify_all();
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+	}
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void submit(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			tasks.push_back(std::move(task));
+		}
+		taskAvailable.notify_one();
+	}
+
+	// Block until the queue is empty and no task is running
+	void waitIdle()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		idle.wait(lock, [this]() { return tasks.empty() && activeTasks == 0; });
+	}
+
+	unsigned int getThreadCount() const
+	{
+		return (unsigned int)workers.size();
+	}
+
+private:
+	void workerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				taskAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+				if (tasks.empty())
+				{
+					return; // Stopping, and nothing left to do
+				}
+				task = std::move(tasks.front());
+				tasks.pop_front();
+				activeTasks++;
+			}
+			task();
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				activeTasks--;
+				if (tasks.empty() && activeTasks == 0)
+				{
+					idle.notify_all();
+				}
+			}
+		}
+	}
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	unsigned int activeTasks;
+	bool stopping;
+	std::mutex mutex;
+	std::condition_variable taskAvailable;
+	std::condition_variable idle;
+};
+
+#endif
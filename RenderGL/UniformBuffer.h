@@ -0,0 +1,129 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include <vector>
+#include <cstring>
+#include <iostream>
+
+#include "glm/glm.hpp"
+
+// Binding point of the FrameData block, every program reading it gets its block bound here
+#define FRAME_DATA_BINDING 0
+
+// Per-frame data shared by all programs, must match the std140 "FrameData" block in the shaders
+struct FrameData
+{
+	glm::mat4 view_mat;
+	glm::mat4 projection_mat;
+	glm::vec4 lightPos; // vec3 padded to a vec4, like std140 does anyway
+};
+
+// Uniform buffer that gets rewritten every frame, bound to a fixed binding point.
+// The buffer is split into a ring of regions: each frame writes the next region while the GPU may still be reading the previous ones,
+// and a fence per region makes sure a region is only overwritten once the GPU is done with it, so the CPU doesn't stall on the GPU.
+class UniformRingBuffer
+{
+public:
+	UniformRingBuffer(size_t dataSize_in, unsigned int bindingPoint_in, unsigned int regionCount_in = 3) :
+		ID(0),
+		dataSize(dataSize_in),
+		regionStride(0),
+		bindingPoint(bindingPoint_in),
+		regionCount(regionCount_in),
+		currentRegion(0),
+		stallCount(0),
+		fences(regionCount_in, (GLsync)0)
+	{
+		// Every region has to start at a multiple of the offset alignment to be bindable with glBindBufferRange()
+		int offsetAlignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+		regionStride = (dataSize + offsetAlignment - 1) / offsetAlignment * offsetAlignment;
+
+		glGenBuffers(1, &ID);
+		glBindBuffer(GL_UNIFORM_BUFFER, ID);
+		glBufferData(GL_UNIFORM_BUFFER, regionStride * regionCount, NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+	~UniformRingBuffer()
+	{
+		for (GLsync fence : fences)
+		{
+			if (fence)
+			{
+				glDeleteSync(fence);
+			}
+		}
+		glDeleteBuffers(1, &ID);
+	}
+
+	// Write this frame's data into the next region and bind it. Call once per frame, before drawing
+	void update(const void* data)
+	{
+		currentRegion = (currentRegion + 1) % regionCount;
+		waitForRegion(currentRegion);
+
+		// Unsynchronized, the fence already guarantees the GPU isn't reading this region anymore
+		glBindBuffer(GL_UNIFORM_BUFFER, ID);
+		void* mapped = glMapBufferRange(GL_UNIFORM_BUFFER, currentRegion * regionStride, dataSize,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (mapped)
+		{
+			memcpy(mapped, data, dataSize);
+			glUnmapBuffer(GL_UNIFORM_BUFFER);
+		}
+		else
+		{
+			std::cout << "ERROR::UNIFORM_BUFFER::MAP_FAILED" << std::endl;
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+		glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, ID, currentRegion * regionStride, dataSize);
+	}
+
+	// Mark the current region as in use by everything submitted so far. Call once per frame, after the last draw reading it
+	void fenceFrame()
+	{
+		fences[currentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	// Number of times the CPU had to wait for the GPU to release a region
+	unsigned int getStallCount()
+	{
+		return stallCount;
+	}
+
+	unsigned int getID()
+	{
+		return ID;
+	}
+
+private:
+	void waitForRegion(unsigned int region)
+	{
+		GLsync fence = fences[region];
+		if (!fence)
+		{
+			return;
+		}
+		if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			stallCount++;
+			glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000); // 1s
+		}
+		glDeleteSync(fence);
+		fences[region] = 0;
+	}
+
+	unsigned int ID;
+	size_t dataSize;
+	size_t regionStride;
+	unsigned int bindingPoint;
+	unsigned int regionCount;
+	unsigned int currentRegion;
+	unsigned int stallCount;
+	std::vector<GLsync> fences;
+};
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef VERTEX_QUANTIZATION_H
+#define VERTEX_QUANTIZATION_H
+
+#include <cmath>
+#include <cstring>
+
+#include "glm/glm.hpp"
+
+// Packing helpers for compact vertex formats, the shaders/GL decode them again (see Mesh and VertexFormat)
+
+// IEEE 754 binary16, round to nearest
+inline unsigned short floatToHalf(float value)
+{
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+	unsigned int sign = (bits >> 16) & 0x8000;
+	unsigned int floatExponent = (bits >> 23) & 0xFF;
+	unsigned int mantissa = bits & 0x7FFFFF;
+
+	if (floatExponent == 0xFF) // Inf/NaN
+	{
+		return (unsigned short)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+	}
+	int exponent = (int)floatExponent - 127 + 15;
+	if (exponent >= 31) // Too large, becomes Inf
+	{
+		return (unsigned short)(sign | 0x7C00);
+	}
+	if (exponent <= 0) // Subnormal half (or zero)
+	{
+		if (exponent < -10)
+		{
+			return (unsigned short)sign;
+		}
+		mantissa |= 0x800000;
+		unsigned int shift = (unsigned int)(14 - exponent);
+		unsigned int half = mantissa >> shift;
+		if ((mantissa >> (shift - 1)) & 1)
+		{
+			half++;
+		}
+		return (unsigned short)(sign | half);
+	}
+	unsigned int half = sign | ((unsigned int)exponent << 10) | (mantissa >> 13);
+	if (mantissa & 0x1000)
+	{
+		half++; // A carry into the exponent is still the correctly rounded result
+	}
+	return (unsigned short)half;
+}
+
+inline float halfToFloat(unsigned short half)
+{
+	unsigned int sign = (half & 0x8000u) << 16;
+	unsigned int exponent = (half >> 10) & 0x1F;
+	unsigned int mantissa = half & 0x3FF;
+	unsigned int bits;
+	if (exponent == 0)
+	{
+		float value = mantissa * (1.0f / 16777216.0f); // 2^-24
+		return sign ? -value : value;
+	}
+	else if (exponent == 31)
+	{
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else
+	{
+		bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	}
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+// [0, 1] -> 16-bit unsigned normalized
+inline unsigned short quantizeUnorm16(float value)
+{
+	return (unsigned short)(glm::clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+}
+
+// [-1, 1] -> 16-bit signed normalized
+inline short quantizeSnorm16(float value)
+{
+	return (short)floor(glm::clamp(value, -1.0f, 1.0f) * 32767.0f + 0.5f);
+}
+
+// Unit vector -> GL_INT_2_10_10_10_REV (x in the low bits, w unused)
+inline unsigned int packSnorm2_10_10_10(const glm::vec3& normal)
+{
+	int x = (int)floor(glm::clamp(normal.x, -1.0f, 1.0f) * 511.0f + 0.5f);
+	int y = (int)floor(glm::clamp(normal.y, -1.0f, 1.0f) * 511.0f + 0.5f);
+	int z = (int)floor(glm::clamp(normal.z, -1.0f, 1.0f) * 511.0f + 0.5f);
+	return ((unsigned int)x & 0x3FF) | (((unsigned int)y & 0x3FF) << 10) | (((unsigned int)z & 0x3FF) << 20);
+}
+
+// Unit vector -> point in the [-1, 1]^2 square by projecting onto an octahedron and unfolding the lower half.
+// Decoded by decodeOctahedral() in the vertex shaders
+inline glm::vec2 encodeOctahedral(const glm::vec3& normal)
+{
+	float sum = fabs(normal.x) + fabs(normal.y) + fabs(normal.z);
+	glm::vec2 projected(normal.x / sum, normal.y / sum);
+	if (normal.z < 0.0f)
+	{
+		projected = glm::vec2((1.0f - fabs(projected.y)) * (projected.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - fabs(projected.x)) * (projected.y >= 0.0f ? 1.0f : -1.0f));
+	}
+	return projected;
+}
+
+#endif
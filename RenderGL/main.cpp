@@ -1,9 +1,35 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <algorithm>
 #include "Shader.h"
 #include "Texture.h"
 #include "Camera.h"
+#include "UniformBuffer.h"
+#include "Scene.h"
+#include "Mesh.h"
+#include "FrustumCulling.h"
+#include "BVH.h"
+#include "Microbenchmarks.h"
+#include "Framebuffer.h"
+#include "HeadlessContext.h"
+#include "AppOptions.h"
+#include "AssetPack.h"
+#include "MeshImporter.h"
+#include "MeshCooker.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "GpuDrivenRenderer.h"
+#include "GLExtensions.h"
+#include "ProgramBinaryCache.h"
+#include "ShaderPermutationCache.h"
+#include "HotReloader.h"
+#include "Benchmark.h"
+#include "CameraPath.h"
 #include "stb_image.h"
 
 #include "glm/glm.hpp"
@@ -15,16 +41,21 @@
 #define DEFAULT_WINDOW_HEIGHT 600
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
-void processKeyboardInput(GLFWwindow* window);
+unsigned int processKeyboardInput(GLFWwindow* window);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+float getElapsedTime();
+void setDecodeUniforms(Shader& shader, Mesh& mesh);
+void setInstanceAttributes(unsigned int instanceVBO, size_t firstInstance);
+bool shouldKeepRendering(GLFWwindow* window, const AppOptions& options, unsigned int frameCount);
 
 // Initial mouse position (center of the screen)
 float lastX = DEFAULT_WINDOW_WIDTH / 2;
 float lastY = DEFAULT_WINDOW_HEIGHT / 2;
 bool firstMouse = true;
 
-// Delta time setup
+// Delta time setup (std::chrono instead of glfwGetTime() so it also works without GLFW in headless mode)
+std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
 float deltaTime = 0.0f;	// Time between current frame and last frame
 float lastFrame = 0.0f; // Time of last frame
 
@@ -40,48 +71,162 @@ glm::vec3 lightPos(1.2f, 1.0f, 1.0f);
 // Generic global variables
 float arrow_key_value = 0.0;
 
-int main()
+int main(int argc, char* argv[])
 {
-	glfwInit();
-	// Specify OpenGL v3.3
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	AppOptions options = parseAppOptions(argc, argv);
+	if (options.showHelp)
+	{
+		printUsage(argv[0]);
+		return 0;
+	}
+	if (options.cullingBenchmark)
+	{
+		runCullingBenchmark();
+		return 0;
+	}
+	if (options.bvhBenchmark)
+	{
+		runBVHBenchmark();
+		return 0;
+	}
+	if (!options.cookInputFile.empty())
+	{
+		return cookTexture(options.cookInputFile, options.cookOutputFile) ? 0 : -1;
+	}
+	if (!options.cookMeshInputFile.empty())
+	{
+		ThreadPool importPool;
+		return cookMesh(options.cookMeshInputFile, options.cookMeshOutputFile, options.vertexFormat, options.generateLods, &importPool) ? 0 : -1;
+	}
+	if (!options.packOutputFile.empty())
+	{
+		return AssetPack::write(options.packOutputFile, options.packInputFiles) ? 0 : -1;
+	}
+	if (!options.packBenchmarkFile.empty())
+	{
+		runAssetPackBenchmark(options.packBenchmarkFile);
+		return 0;
+	}
+	if (!options.importBenchmarkFile.empty())
+	{
+		runMeshImportBenchmark(options.importBenchmarkFile);
+		return 0;
+	}
+	if (!options.meshCodecBenchmarkFile.empty())
+	{
+		runMeshCodecBenchmark(options.meshCodecBenchmarkFile, options.vertexFormat);
+		return 0;
+	}
+
+	GLFWwindow* window = NULL;
+	HeadlessContext headlessContext;
+	std::unique_ptr<Framebuffer> offscreenFramebuffer;
 
-	// Explicitly use core profile
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	// OpenGL v3.3 core, 4.3 for GPU-driven drawing (compute shaders, storage buffers, indirect draws)
+	int glMajorVersion = options.gpuDriven ? 4 : 3;
+	int glMinorVersion = 3;
 
-	// Create a window object
-	GLFWwindow* window = glfwCreateWindow(DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT, "RenderGL", NULL, NULL);
-	if (window == NULL)
+	if (options.headless)
 	{
-		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
-		return -1;
-	}
-	glfwMakeContextCurrent(window);
+		// Surfaceless context, no window and no display needed
+		if (!headlessContext.create(glMajorVersion, glMinorVersion))
+		{
+			std::cout << "Failed to create headless OpenGL context" << std::endl;
+			return -1;
+		}
 
-	// Initialize GLAD
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+		// Initialize GLAD
+		if (!gladLoadGLLoader((GLADloadproc)HeadlessContext::getProcAddress))
+		{
+			std::cout << "Failed to initialize GLAD" << std::endl;
+			return -1;
+		}
+		loadGLExtensions((GLADloadproc)HeadlessContext::getProcAddress);
+
+		// Everything gets rendered into an FBO instead of the (nonexistent) default framebuffer
+		offscreenFramebuffer.reset(new Framebuffer(DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT));
+		offscreenFramebuffer->bind();
+		std::cout << "Running headless on " << glGetString(GL_RENDERER) << std::endl;
+	}
+	else
 	{
-		std::cout << "Failed to initialize GLAD" << std::endl;
-		glfwTerminate();
-		return -1;
+		glfwInit();
+		// Specify the OpenGL version
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, glMajorVersion);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, glMinorVersion);
+
+		// Explicitly use core profile
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+		// Create a window object
+		window = glfwCreateWindow(DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT, "RenderGL", NULL, NULL);
+		if (window == NULL)
+		{
+			std::cout << "Failed to create GLFW window" << std::endl;
+			glfwTerminate();
+			return -1;
+		}
+		glfwMakeContextCurrent(window);
+
+		// Initialize GLAD
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+		{
+			std::cout << "Failed to initialize GLAD" << std::endl;
+			glfwTerminate();
+			return -1;
+		}
+		loadGLExtensions((GLADloadproc)glfwGetProcAddress);
+
+		// wrt to the window
+		glViewport(0, 0, DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT);
+
+		// On resize window, resize framebuffer/viewport
+		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+
+		// Cursor/mouse	stuff, register callbacks
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED); // Capture + hide cursor when application in focus
+		glfwSetCursorPosCallback(window, mouse_callback);
+		glfwSetScrollCallback(window, scroll_callback);
 	}
 
-	// wrt to the window
-	glViewport(0, 0, DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT);
+	if (options.textureBenchmarkCount > 0 || options.mipBenchmark)
+	{
+		if (options.textureBenchmarkCount > 0)
+		{
+			runTextureLoadingBenchmark(options.textureBenchmarkCount);
+		}
+		if (options.mipBenchmark)
+		{
+			runMipBenchmark();
+		}
+		if (window != NULL)
+		{
+			glfwTerminate();
+		}
+		return 0;
+	}
 
-	// On resize window, resize framebuffer/viewport
-	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+	// GPU-driven drawing does its own culling and level of detail selection, and draws all objects with one call
+	bool gpuDriven = false;
+	if (options.gpuDriven)
+	{
+		gpuDriven = getGLExtensions().gpuDrivenDrawing;
+		if (gpuDriven)
+		{
+			options.frustumCulling = false;
+			options.bvh = false;
+			options.instanced = false;
+			options.meshlets = false;
+		}
+		else
+		{
+			std::cout << "GPU-driven drawing needs OpenGL 4.3, the objects are drawn from the CPU" << std::endl;
+		}
+	}
 
 	// Enable depth-testing
 	glEnable(GL_DEPTH_TEST);
 
-	// Cursor/mouse	stuff, register callbacks
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED); // Capture + hide cursor when application in focus
-	glfwSetCursorPosCallback(window, mouse_callback);
-	glfwSetScrollCallback(window, scroll_callback);
-
 	// Cube vertices + normals
 	float vertices[] = {
 	-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
@@ -127,51 +272,309 @@ int main()
 	-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f
 	};
 
-	// Set up Vertex Buffer Object
-	unsigned int VBO;
-	glGenBuffers(1, &VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO); // bind VBO to target GL_ARRAY_BUFFER
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW); // copy data from vertices to buffer memory	
+	// Turn the cube into an indexed, cache-optimized mesh and set up its Vertex Buffer Object + Element Buffer Object
+	MeshData cubeData = MeshData::fromTriangleList(vertices, sizeof(vertices) / (6 * sizeof(float)));
+	printMeshOptimizationReport("cube", cubeData.optimize());
+	if (options.meshlets && options.meshFile.empty())
+	{
+		buildMeshlets(cubeData);
+	}
+	Mesh cubeMesh(cubeData, options.vertexFormat);
+	std::cout << "Mesh cube: " << cubeMesh.getVertexBufferSize() << " bytes of vertex data (" << options.vertexFormat.getVertexSize() << " bytes per vertex)" << std::endl;
+
+	// The objects are cubes too, unless a mesh file was given. It's parsed on all cores (or decoded, if it's cooked) and written straight
+	// into its GPU buffers
+	Mesh* objectMesh = &cubeMesh;
+	std::unique_ptr<Mesh> importedMesh;
+	glm::vec4 cubeBoundingSphere = cubeData.computeBoundingSphere();
+	glm::vec4 objectBoundingSphere = cubeBoundingSphere;
+	if (getMeshFileType(options.meshFile) == MESH_FILE_COOKED)
+	{
+		CookedMeshLoadStats loadStats;
+		importedMesh = loadCookedMesh(options.meshFile, true, objectBoundingSphere, loadStats);
+		if (!importedMesh)
+		{
+			return -1;
+		}
+		printCookedMeshLoadStats(options.meshFile, loadStats);
+		if (options.meshlets)
+		{
+			std::cout << "Meshlets are built from source meshes (.obj, .glb), " << options.meshFile << " is drawn whole" << std::endl;
+		}
+		objectMesh = importedMesh.get();
+	}
+	else if (!options.meshFile.empty())
+	{
+		ThreadPool importPool;
+		MeshImporter importer(&importPool);
+		importer.setFitToUnitCube(true);
+		if (options.generateLods || options.meshlets)
+		{
+			// The simplifier and the meshlet builder work on the vertices in memory, so this takes the MeshData detour instead of streaming
+			// into the GPU buffers
+			MeshData meshData;
+			if (!importer.import(options.meshFile, meshData))
+			{
+				return -1;
+			}
+			if (options.generateLods)
+			{
+				std::chrono::steady_clock::time_point lodStart = std::chrono::steady_clock::now();
+				generateLods(meshData);
+				printMeshLods(options.meshFile, meshData.lods, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - lodStart).count());
+			}
+			meshData.optimize();
+			if (options.meshlets)
+			{
+				std::chrono::steady_clock::time_point meshletStart = std::chrono::steady_clock::now();
+				buildMeshlets(meshData);
+				printMeshlets(options.meshFile, meshData, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - meshletStart).count());
+			}
+			importedMesh.reset(new Mesh(meshData, options.vertexFormat));
+		}
+		else
+		{
+			importedMesh = importer.importToGPU(options.meshFile, options.vertexFormat);
+			if (!importedMesh)
+			{
+				return -1;
+			}
+		}
+		printMeshImportStats(options.meshFile, importer.getStats());
+		objectMesh = importedMesh.get();
+		objectBoundingSphere = importer.getBoundingSphere();
+	}
 
 	// Lit objects setup
-	unsigned int cubeVAO;
-	glGenVertexArrays(1, &cubeVAO); // Create
-	glBindVertexArray(cubeVAO); // Bind
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0); // Set attributes (vertex positions)
-	glEnableVertexAttribArray(0); // Enable attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float))); // Set attributes (normals)
-	glEnableVertexAttribArray(1); // Enable attribute
-
-	// Light source vertex attributes setup
-	unsigned int lightVAO;
-	glGenVertexArrays(1, &lightVAO);
-	glBindVertexArray(lightVAO);
-	// we only need to bind to the VBO (to link it with glVertexAttribPointer), no need to fill it; the VBO's data already contains all we need (it's already bound, but we do it again for educational purposes)
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-
-	// Shader setup
-	Shader lightingShader("shaders\\vertexShaderCubes.vs", "shaders\\lighting.fs"); // For objects to be lit (cubes)
-	lightingShader.use();
-	lightingShader.setVec3("objectColor", 1.0f, 0.5f, 0.31f); // Coral color
-	lightingShader.setVec3("lightColor", 1.0f, 1.0f, 1.0f); // Pure white light
-	lightingShader.setVec3("lightPos", lightPos); // Light's position, needed for calculating lighting
-
-	Shader lightingSourceShader("shaders\\vertexShaderLights.vs", "shaders\\light_source.fs"); // For light objects
-	lightingSourceShader.use();
+	unsigned int objectVAO = objectMesh->createVertexArray();
+
+	// Lit objects to draw, a single coral cube unless a stress scene was requested
+	Scene scene;
+	if (options.cubeCount > 0)
+	{
+		scene.spawnCubeGrid(options.cubeCount);
+	}
+	else
+	{
+		scene.addObject(glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, 0.0f, 1.0f)), glm::vec3(1.0f, 0.5f, 0.31f)); // Coral color
+	}
+
+	// Bounding spheres of the objects for frustum culling. Without culling every object is always visible
+	FrustumCuller culler;
+	std::vector<unsigned int> visibleObjects(scene.getObjectCount());
+	std::vector<glm::vec4> objectSpheres(scene.getObjectCount());
+	for (size_t i = 0; i < scene.getObjectCount(); i++)
+	{
+		objectSpheres[i] = scene.getBoundingSphere(i, objectBoundingSphere);
+		culler.addSphere(glm::vec3(objectSpheres[i]), objectSpheres[i].w);
+		visibleObjects[i] = (unsigned int)i;
+	}
+	std::vector<InstanceData> visibleInstances;
+	bool cullObjects = options.frustumCulling || options.bvh;
+
+	// Level of detail per object, picked every frame from its distance when the mesh has more than one (on the GPU when it's driving)
+	bool selectLods = objectMesh->getLodCount() > 1 && options.lodPixelError > 0.0f && !gpuDriven;
+	std::vector<unsigned int> objectLods(scene.getObjectCount(), 0);
+	std::vector<unsigned int> lodInstanceCounts(objectMesh->getLodCount(), 0);
+	std::vector<unsigned int> lodInstanceOffsets(objectMesh->getLodCount(), 0);
+
+	// Meshlets that survive culling, as index ranges for one object at a time
+	bool cullMeshletsPerObject = !objectMesh->getMeshlets().empty() && !options.instanced;
+	std::vector<GLsizei> meshletRangeCounts;
+	std::vector<unsigned int> meshletRangeFirstIndices;
+	if (options.meshlets && options.instanced)
+	{
+		std::cout << "Meshlet culling is per object, instanced objects are drawn whole" << std::endl;
+	}
+
+	// BVH over the objects plus the light source (the last object), which moves every frame and gets refit incrementally
+	BVH bvh;
+	unsigned int lightObject = (unsigned int)scene.getObjectCount();
+	unsigned int pickedObject = ~0u;
+	if (options.bvh)
+	{
+		std::vector<AABB> objectBounds;
+		for (size_t i = 0; i < scene.getObjectCount(); i++)
+		{
+			objectBounds.push_back(AABB::fromSphere(scene.getBoundingSphere(i, objectBoundingSphere)));
+		}
+		objectBounds.push_back(AABB()); // Light, placed every frame
+		std::chrono::steady_clock::time_point buildStart = std::chrono::steady_clock::now();
+		bvh.build(objectBounds, std::max(1u, std::thread::hardware_concurrency()));
+		std::cout << "BVH: " << bvh.getNodeCount() << " nodes, built in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count() << " ms" << std::endl;
+	}
+
+	// Instance buffer: model matrix + color per object, read as instanced attributes. Refilled with only the visible objects (grouped by level
+	// of detail) every frame when culling or picking levels of detail
+	bool streamInstances = cullObjects || selectLods;
+	unsigned int instanceVBO;
+	glGenBuffers(1, &instanceVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, scene.getObjectCount() * sizeof(InstanceData), scene.getInstances().data(), streamInstances ? GL_STREAM_DRAW : GL_STATIC_DRAW);
+
+	// Instanced lit objects setup, same per-vertex attributes as objectVAO plus the per-instance ones
+	unsigned int instancedObjectVAO = objectMesh->createVertexArray();
+	for (unsigned int location = 2; location <= 6; location++) // A mat4 attribute takes up 4 vec4 locations, then the color
+	{
+		glEnableVertexAttribArray(location);
+		glVertexAttribDivisor(location, 1); // Advance once per instance instead of per vertex
+	}
+	setInstanceAttributes(instanceVBO, 0);
+
+	// Light source vertex attributes setup, only needs positions
+	unsigned int lightVAO = cubeMesh.createVertexArray(false);
+
+	// Shader setup, from the asset pack if there is one, linked programs from the binary cache if they are in it.
+	// The vertex format and the constant light color are compiled into the programs
+	AssetPack assetPack;
+	if (!options.assetPackFile.empty() && !assetPack.open(options.assetPackFile))
+	{
+		return -1;
+	}
+	std::unique_ptr<ProgramBinaryCache> programBinaryCache;
+	if (!options.shaderCacheDirectory.empty())
+	{
+		programBinaryCache.reset(new ProgramBinaryCache(options.shaderCacheDirectory));
+	}
+	ShaderPermutationCache shaders(&assetPack, programBinaryCache.get());
+	ShaderDefines meshDefines; // The light sources are cubes, a cooked object mesh may have another vertex format
+	if (cubeMesh.hasOctahedralNormals())
+	{
+		meshDefines.push_back({ "OCTAHEDRAL_NORMALS", "" });
+	}
+	ShaderDefines lightingDefines;
+	if (objectMesh->hasOctahedralNormals())
+	{
+		lightingDefines.push_back({ "OCTAHEDRAL_NORMALS", "" });
+	}
+	lightingDefines.push_back({ "LIGHT_COLOR", "vec3(1.0)" }); // Pure white light
+	ShaderDefines instancedLightingDefines = lightingDefines;
+	instancedLightingDefines.push_back({ "INSTANCED", "" }); // Model matrix + color per instance
+
+	// With KHR_parallel_shader_compile all programs are submitted before any result is waited for, so the driver can
+	// compile them on its own threads. Otherwise (or with --serial-shaders) each one is compiled and checked in turn
+	bool parallelShaderCompile = getGLExtensions().parallelShaderCompile && !options.serialShaderCompile;
+	if (getGLExtensions().parallelShaderCompile)
+	{
+		getGLExtensions().maxShaderCompilerThreads(parallelShaderCompile ? 0xFFFFFFFFu : 0u); // All the driver wants, or none
+	}
+	ShaderBuildMode shaderBuildMode = parallelShaderCompile ? SHADER_BUILD_DEFERRED : SHADER_BUILD_IMMEDIATE;
+
+	auto shaderSetupStart = std::chrono::steady_clock::now();
+	Shader& lightingShader = shaders.get("shaders/vertexShaderCubes.vs", "shaders/lighting.fs", lightingDefines, shaderBuildMode); // For objects to be lit (cubes)
+	Shader& instancedLightingShader = shaders.get("shaders/vertexShaderCubes.vs", "shaders/lighting.fs", instancedLightingDefines, shaderBuildMode);
+	Shader& lightingSourceShader = shaders.get("shaders/vertexShaderLights.vs", "shaders/light_source.fs", meshDefines, shaderBuildMode); // For light objects
+	Shader* cullingShader = gpuDriven ? &shaders.getCompute("shaders/object_culling.comp", ShaderDefines(), shaderBuildMode) : nullptr;
+	float shaderSubmitTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - shaderSetupStart).count();
+	shaders.completeAll();
+
+	lightingShader.bindUniformBlock("FrameData", FRAME_DATA_BINDING); // Camera matrices + light position, needed for calculating lighting
+	instancedLightingShader.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+	lightingSourceShader.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+	if (cullingShader)
+	{
+		cullingShader->bindUniformBlock("FrameData", FRAME_DATA_BINDING); // The frustum comes from the camera matrices
+	}
+	float shaderSetupTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - shaderSetupStart).count();
+	std::cout << "Shaders ready in " << shaderSetupTime << " ms, " << shaders.getPermutationCount() << " permutations";
+	if (parallelShaderCompile)
+	{
+		std::cout << " (parallel compile, " << shaderSubmitTime << " ms to submit)";
+	}
+	else
+	{
+		std::cout << " (serial compile)";
+	}
+	if (programBinaryCache && ProgramBinaryCache::isSupported())
+	{
+		const ProgramBinaryCacheStats& binaryStats = programBinaryCache->getStats();
+		std::cout << " (program binary cache: " << binaryStats.hits << " hits, " << binaryStats.misses << " misses, " << binaryStats.rejected << " rejected)";
+	}
+	else if (programBinaryCache)
+	{
+		std::cout << " (program binaries not supported by the driver, compiled from source)";
+	}
+	std::cout << std::endl;
+
+	// Each program always draws the same mesh, so its vertex decoding parameters only need to be set once
+	setDecodeUniforms(lightingShader, *objectMesh);
+	setDecodeUniforms(instancedLightingShader, *objectMesh);
+	setDecodeUniforms(lightingSourceShader, cubeMesh);
+
+	// Watch the shader sources, changed ones are rebuilt and swapped in at the start of a frame
+	std::unique_ptr<HotReloader> hotReloader;
+	if (options.hotReload)
+	{
+		hotReloader.reset(new HotReloader(&shaders));
+		if (!hotReloader->start({ "shaders" }))
+		{
+			hotReloader.reset();
+		}
+	}
+
+	// Resolve uniform handles once, the render loop does no name lookups (they stay valid across shader reloads)
+	Uniform<glm::mat4> lightingSourceModelMat = lightingSourceShader.getUniform<glm::mat4>("model_mat");
+	Uniform<glm::mat4> lightingModelMat = lightingShader.getUniform<glm::mat4>("model_mat");
+	Uniform<glm::vec3> lightingObjectColor = lightingShader.getUniform<glm::vec3>("objectColor");
+
+	// Per-frame data (camera + light) for all programs, written once per frame
+	UniformRingBuffer frameUniformBuffer(sizeof(FrameData), FRAME_DATA_BINDING);
+
+	// Object bounds and levels of detail on the GPU, the draw commands get written there every frame
+	std::unique_ptr<GpuDrivenRenderer> gpuRenderer;
+	if (gpuDriven)
+	{
+		gpuRenderer.reset(new GpuDrivenRenderer(*cullingShader, *objectMesh, objectSpheres, objectBoundingSphere.w));
+	}
+
+	// Benchmark setup, the camera follows a scripted path instead of the mouse/keyboard
+	std::unique_ptr<Benchmark> benchmark;
+	CameraPath cameraPath;
+	CameraPath recordedCameraPath;
+	if (options.benchmark)
+	{
+		if (options.cameraPathFile.empty() || !cameraPath.loadFromFile(options.cameraPathFile))
+		{
+			cameraPath = CameraPath::createDefault();
+		}
+		benchmark.reset(new Benchmark(options.warmupFrames));
+	}
 
 	// Render loop
-	while (!glfwWindowShouldClose(window))
+	unsigned int frameCount = 0;
+	while (shouldKeepRendering(window, options, frameCount))
 	{
+		if (benchmark)
+		{
+			benchmark->beginFrame();
+		}
+		Shader::resetStats();
+		if (hotReloader)
+		{
+			hotReloader->update();
+		}
+
 		// Input
-		processKeyboardInput(window);
+		unsigned int movementMask = 0;
+		if (window != NULL && !benchmark)
+		{
+			movementMask = processKeyboardInput(window);
+		}
 
-		// Delta time calculation
-		float currentFrame = glfwGetTime();
+		// Delta time calculation (fixed timestep when benchmarking, so every run renders the exact same frames)
+		float currentFrame = benchmark ? frameCount * BENCHMARK_TIMESTEP : getElapsedTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
+		if (benchmark)
+		{
+			cameraPath.apply(camera, currentFrame, deltaTime);
+		}
+		else if (!options.recordCameraPathFile.empty())
+		{
+			recordedCameraPath.addKeyframe(currentFrame, yaw, pitch, fov, movementMask);
+		}
+
 		// Clear screen with a nice color
 		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -184,63 +587,345 @@ int main()
 		glm::mat4 projection_mat;
 		projection_mat = glm::perspective(glm::radians(camera.getFOV()), (float)DEFAULT_WINDOW_WIDTH / (float)DEFAULT_WINDOW_WIDTH, 0.1f, 100.0f);
 
-		/*
-		* Draw lights
-		*/
-		lightingSourceShader.use();
 		// Light source model matrix
 		glm::mat4 light_source_model_mat;
 		light_source_model_mat = glm::mat4(1.0f);
-		light_source_model_mat = glm::rotate(light_source_model_mat, glm::radians((float)glfwGetTime() * 100), glm::vec3(1.0f, 0.0f, 1.0f));
+		light_source_model_mat = glm::rotate(light_source_model_mat, glm::radians(currentFrame * 100), glm::vec3(1.0f, 0.0f, 1.0f));
 		light_source_model_mat = glm::translate(light_source_model_mat, lightPos);
 		light_source_model_mat = glm::scale(light_source_model_mat, glm::vec3(0.2f));
-		lightingSourceShader.setMat4("model_mat", light_source_model_mat);
-		lightingSourceShader.setMat4("view_mat", view_mat);
-		lightingSourceShader.setMat4("projection_mat", projection_mat);
-		glBindVertexArray(lightVAO);
-		glDrawArrays(GL_TRIANGLES, 0, 36);
+		glm::vec3 newLightPos = light_source_model_mat * glm::vec4(lightPos, 1.0f);
+
+		// One buffer write for every program instead of separate uploads per program
+		FrameData frameData;
+		frameData.view_mat = view_mat;
+		frameData.projection_mat = projection_mat;
+		frameData.lightPos = glm::vec4(newLightPos, 1.0f);
+		frameUniformBuffer.update(&frameData);
+
+		// Frustum culling, planes in world space so the bounding volumes don't need to be transformed
+		Frustum frustum = Frustum::fromMatrix(projection_mat * view_mat);
+		double cullMilliseconds = 0.0;
+		bool lightVisible = true;
+		if (options.bvh)
+		{
+			std::chrono::steady_clock::time_point cullStart = std::chrono::steady_clock::now();
+			bvh.updateObject(lightObject, AABB::fromSphere(transformBoundingSphere(light_source_model_mat, cubeBoundingSphere)));
+			bvh.cullFrustum(frustum, visibleObjects);
+			std::vector<unsigned int>::iterator light = std::find(visibleObjects.begin(), visibleObjects.end(), lightObject);
+			lightVisible = light != visibleObjects.end();
+			if (lightVisible)
+			{
+				visibleObjects.erase(light);
+			}
+
+			// Pick whatever the camera looks at
+			RayHit hit;
+			pickedObject = bvh.raycast(camera.getPosition(), camera.getFront(), hit) ? hit.object : ~0u;
+			cullMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cullStart).count();
+		}
+		else if (options.frustumCulling)
+		{
+			std::chrono::steady_clock::time_point cullStart = std::chrono::steady_clock::now();
+			culler.cull(frustum, visibleObjects);
+			cullMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cullStart).count();
+		}
+
+		// Level of detail per visible object: the coarsest one whose error covers at most lodPixelError pixels, seen from the camera at the
+		// distance of the object's closest point
+		double lodMilliseconds = 0.0;
+		if (selectLods)
+		{
+			std::chrono::steady_clock::time_point lodStart = std::chrono::steady_clock::now();
+			float projectionScale = getLodProjectionScale(camera.getFOV(), (float)DEFAULT_WINDOW_HEIGHT);
+			glm::vec3 cameraPosition = camera.getPosition();
+			for (unsigned int objectIndex : visibleObjects)
+			{
+				const glm::vec4& sphere = objectSpheres[objectIndex];
+				float distance = glm::length(glm::vec3(sphere) - cameraPosition) - sphere.w;
+				objectLods[objectIndex] = objectMesh->selectLod(distance, sphere.w / objectBoundingSphere.w, projectionScale, options.lodPixelError);
+			}
+			lodMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - lodStart).count();
+		}
 
 		/*
-		* Draw non-light cube objects
+		* Draw lights
 		*/
-		// Activate Shader
-		lightingShader.use();
-		glm::vec3 cubePos(0.5f, 0.0f, 1.0f);
-		glm::mat4 cube_model_mat;
-		cube_model_mat = glm::mat4(1.0f);
-		cube_model_mat = glm::translate(cube_model_mat, cubePos);
-		lightingShader.setMat4("model_mat", cube_model_mat);
-		lightingShader.setMat4("view_mat", view_mat);
-		lightingShader.setMat4("projection_mat", projection_mat);
-		glm::vec3 newLightPos = light_source_model_mat * glm::vec4(lightPos, 1.0f);
-		lightingShader.setVec3("lightPos", glm::vec3(newLightPos.x, newLightPos.y, newLightPos.z));
-		glBindVertexArray(cubeVAO);
-		glDrawArrays(GL_TRIANGLES, 0, 36); // Render the cube
+		unsigned int drawCalls = 0;
+		size_t triangleCount = 0;
+		MeshletCullStats meshletStats;
+		double meshletCullMilliseconds = 0.0;
+		if (lightVisible)
+		{
+			lightingSourceShader.use();
+			lightingSourceShader.set(lightingSourceModelMat, light_source_model_mat);
+			glBindVertexArray(lightVAO);
+			cubeMesh.draw();
+			drawCalls++;
+			triangleCount += cubeMesh.getLod(0).indexCount / 3;
+		}
+
+		/*
+		* Draw non-light objects
+		*/
+		std::chrono::steady_clock::time_point objectDrawStart = std::chrono::steady_clock::now();
+		if (gpuDriven)
+		{
+			// Culling, levels of detail and the draw commands are all up to the GPU, so this costs the same for any number of objects.
+			// The counts come from a few frames ago
+			gpuRenderer->cull(camera.getPosition(), getLodProjectionScale(camera.getFOV(), (float)DEFAULT_WINDOW_HEIGHT), objectMesh->getLodCount() > 1 ? options.lodPixelError : 0.0f);
+			instancedLightingShader.use();
+			glBindVertexArray(instancedObjectVAO);
+			gpuRenderer->draw();
+			drawCalls++;
+			triangleCount += gpuRenderer->getStats().triangles;
+		}
+		else if (options.instanced)
+		{
+			// All objects in one call per level of detail, per-object data comes from the instance buffer
+			std::fill(lodInstanceCounts.begin(), lodInstanceCounts.end(), 0);
+			if (selectLods)
+			{
+				for (unsigned int objectIndex : visibleObjects)
+				{
+					lodInstanceCounts[objectLods[objectIndex]]++;
+				}
+			}
+			else
+			{
+				lodInstanceCounts[0] = (unsigned int)visibleObjects.size();
+			}
+			if (streamInstances)
+			{
+				// Compact the visible objects into the instance buffer, sorted by level of detail (orphaned, so this doesn't wait for last frame's draw)
+				unsigned int offset = 0;
+				for (size_t lod = 0; lod < lodInstanceCounts.size(); lod++)
+				{
+					lodInstanceOffsets[lod] = offset;
+					offset += lodInstanceCounts[lod];
+				}
+				visibleInstances.resize(visibleObjects.size());
+				for (unsigned int objectIndex : visibleObjects)
+				{
+					InstanceData& instance = visibleInstances[lodInstanceOffsets[objectLods[objectIndex]]++];
+					instance = scene.getInstances()[objectIndex];
+					if (objectIndex == pickedObject)
+					{
+						instance.color = glm::vec4(1.0f); // Highlight
+					}
+				}
+				glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+				glBufferData(GL_ARRAY_BUFFER, scene.getObjectCount() * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+				glBufferSubData(GL_ARRAY_BUFFER, 0, visibleInstances.size() * sizeof(InstanceData), visibleInstances.data());
+			}
+			instancedLightingShader.use();
+			glBindVertexArray(instancedObjectVAO);
+			unsigned int firstInstance = 0;
+			for (unsigned int lod = 0; lod < objectMesh->getLodCount(); lod++)
+			{
+				if (lodInstanceCounts[lod] == 0)
+				{
+					continue;
+				}
+				if (selectLods)
+				{
+					setInstanceAttributes(instanceVBO, firstInstance); // No base instance in GL 3.3, so the attributes start at the group instead
+				}
+				objectMesh->drawInstanced(lodInstanceCounts[lod], lod);
+				drawCalls++;
+				triangleCount += (size_t)lodInstanceCounts[lod] * (objectMesh->getLod(lod).indexCount / 3);
+				firstInstance += lodInstanceCounts[lod];
+			}
+		}
+		else
+		{
+			// Activate Shader
+			lightingShader.use();
+			glBindVertexArray(objectVAO);
+			for (unsigned int objectIndex : visibleObjects)
+			{
+				const InstanceData& object = scene.getInstances()[objectIndex];
+				const MeshLod& lod = objectMesh->getLod(objectLods[objectIndex]);
+				if (cullMeshletsPerObject)
+				{
+					// Only the meshlets facing the camera and inside the frustum, nothing at all if none are
+					std::chrono::steady_clock::time_point meshletStart = std::chrono::steady_clock::now();
+					meshletRangeCounts.clear();
+					meshletRangeFirstIndices.clear();
+					cullMeshlets(objectMesh->getMeshlets(), lod, object.model_mat, frustum, camera.getPosition(), meshletRangeCounts, meshletRangeFirstIndices, meshletStats);
+					meshletCullMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - meshletStart).count();
+					if (meshletRangeCounts.empty())
+					{
+						continue;
+					}
+				}
+				lightingShader.set(lightingModelMat, object.model_mat);
+				lightingShader.set(lightingObjectColor, objectIndex == pickedObject ? glm::vec3(1.0f) : glm::vec3(object.color));
+				if (cullMeshletsPerObject)
+				{
+					objectMesh->drawRanges(meshletRangeCounts, meshletRangeFirstIndices);
+				}
+				else
+				{
+					objectMesh->draw(objectLods[objectIndex]); // Render the object
+					triangleCount += lod.indexCount / 3;
+				}
+				drawCalls++;
+			}
+			triangleCount += meshletStats.submittedTriangles;
+		}
+		double objectDrawMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - objectDrawStart).count();
+		frameUniformBuffer.fenceFrame();
+		if (gpuRenderer)
+		{
+			gpuRenderer->fenceFrame();
+		}
 
 		// Check and all events and then swap the buffers
-		glfwPollEvents();
-		glfwSwapBuffers(window);
+		if (window != NULL)
+		{
+			glfwPollEvents();
+			glfwSwapBuffers(window);
+		}
+		else
+		{
+			glFlush(); // No swap to kick off the work, so submit the frame explicitly
+		}
+
+		if (benchmark)
+		{
+			benchmark->addFrameCounter("uniform_uploads_per_frame", Shader::getStats().uploads);
+			benchmark->addFrameCounter("uniform_uploads_skipped_per_frame", Shader::getStats().skipped);
+			benchmark->addFrameCounter("draw_calls_per_frame", drawCalls);
+			benchmark->addFrameCounter("visible_objects_per_frame", gpuRenderer ? (double)gpuRenderer->getStats().visibleObjects : (double)visibleObjects.size());
+			benchmark->addFrameCounter("triangles_per_frame", (double)triangleCount);
+			if (hotReloader)
+			{
+				benchmark->addFrameCounter("hot_reload_ms", hotReloader->getLastUpdateMilliseconds());
+			}
+			benchmark->addFrameCounter("cull_ms_per_frame", cullMilliseconds);
+			benchmark->addFrameCounter("object_draw_ms_per_frame", objectDrawMilliseconds); // CPU time to issue the object draws
+			if (selectLods)
+			{
+				benchmark->addFrameCounter("lod_ms_per_frame", lodMilliseconds);
+			}
+			if (cullMeshletsPerObject)
+			{
+				benchmark->addFrameCounter("meshlets_tested_per_frame", (double)meshletStats.tested);
+				benchmark->addFrameCounter("meshlets_frustum_culled_per_frame", (double)meshletStats.frustumCulled);
+				benchmark->addFrameCounter("meshlets_backface_culled_per_frame", (double)meshletStats.backfaceCulled);
+				benchmark->addFrameCounter("meshlet_cull_ms_per_frame", meshletCullMilliseconds);
+			}
+			benchmark->endFrame();
+		}
+		frameCount++;
+	}
+
+	if (benchmark)
+	{
+		benchmark->setCounter("frame_data_stalls", frameUniformBuffer.getStallCount());
+		if (gpuRenderer)
+		{
+			benchmark->setCounter("gpu_cull_stats_stalls", gpuRenderer->getStallCount());
+		}
+		benchmark->setCounter("objects", (double)scene.getObjectCount());
+		benchmark->setCounter("bvh_nodes", (double)bvh.getNodeCount());
+		benchmark->setCounter("lods", (double)objectMesh->getLodCount());
+		TextureMemoryUsage textureMemory = TextureMemory::getTotal();
+		benchmark->setCounter("texture_cpu_bytes", (double)textureMemory.cpuBytes);
+		benchmark->setCounter("texture_gpu_bytes", (double)textureMemory.gpuBytes);
+		benchmark->setCounter("objects_per_second", scene.getObjectCount() * benchmark->getMeasuredFrameCount() / benchmark->getMeasuredSeconds());
+		benchmark->setCounter("draw_calls_per_second", benchmark->getCounterTotal("draw_calls_per_frame") / benchmark->getMeasuredSeconds());
+	}
+
+	if (benchmark)
+	{
+		benchmark->writeReport(options.benchmarkOutputFile, DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT);
+		benchmark.reset();
+	}
+	if (!options.recordCameraPathFile.empty() && recordedCameraPath.saveToFile(options.recordCameraPathFile))
+	{
+		std::cout << "Saved camera path (" << recordedCameraPath.getKeyframeCount() << " keyframes) to " << options.recordCameraPathFile << std::endl;
+	}
+
+	if (offscreenFramebuffer)
+	{
+		glFinish();
+		float totalTime = getElapsedTime();
+		std::cout << "Rendered " << frameCount << " frames in " << totalTime << " s (" << frameCount / totalTime << " fps)" << std::endl;
+		if (!options.outputImagePath.empty() && offscreenFramebuffer->saveToPPM(options.outputImagePath))
+		{
+			std::cout << "Saved last frame to " << options.outputImagePath << std::endl;
+		}
+		offscreenFramebuffer.reset();
 	}
 
 	// Cleanup OpenGL stuff
-	glDeleteVertexArrays(1, &cubeVAO);
-	glDeleteVertexArrays(1, &lightVAO);
-	glDeleteBuffers(1, &VBO);
+	gpuRenderer.reset();
+	glDeleteBuffers(1, &instanceVBO); // The VAOs are owned by the meshes
 
-	// Cleanup glfw
-	glfwTerminate();
+	// Cleanup glfw (the headless context cleans up after itself)
+	if (window != NULL)
+	{
+		glfwTerminate();
+	}
 	return 0;
 }
 
+// Tell a program how to decode the (possibly quantized) vertices of a mesh, the normal encoding is compiled in (OCTAHEDRAL_NORMALS)
+void setDecodeUniforms(Shader& shader, Mesh& mesh)
+{
+	shader.use();
+	shader.setVec3("positionScale", mesh.getPositionScale());
+	shader.setVec3("positionOffset", mesh.getPositionOffset());
+}
+
+// Point the per-instance attributes (model matrix + color) of the bound VAO into the instance buffer, starting at firstInstance
+void setInstanceAttributes(unsigned int instanceVBO, size_t firstInstance)
+{
+	size_t base = firstInstance * sizeof(InstanceData);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	for (unsigned int column = 0; column < 4; column++) // A mat4 attribute takes up 4 vec4 locations
+	{
+		glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(base + column * sizeof(glm::vec4)));
+	}
+	glVertexAttribPointer(6, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(base + offsetof(InstanceData, color)));
+}
+
+// Seconds since startup
+float getElapsedTime()
+{
+	return std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+// Windowed runs last until the window is closed, headless runs until the frame limit or the deadline is hit
+bool shouldKeepRendering(GLFWwindow* window, const AppOptions& options, unsigned int frameCount)
+{
+	if (window != NULL && glfwWindowShouldClose(window))
+	{
+		return false;
+	}
+	if (options.maxFrames > 0 && frameCount >= options.maxFrames)
+	{
+		return false;
+	}
+	if (options.maxSeconds > 0.0f && getElapsedTime() >= options.maxSeconds)
+	{
+		return false;
+	}
+	return true;
+}
+
 // Window resize callback
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
 	glViewport(0, 0, width, height);
 }
 
-// Process keyboard
-void processKeyboardInput(GLFWwindow* window)
+// Process keyboard, returns the camera movements applied this frame (see movementBit())
+unsigned int processKeyboardInput(GLFWwindow* window)
 {
+	unsigned int movementMask = 0;
+
 	/*
 	* Generic keybindings
 	*/
@@ -265,19 +950,24 @@ void processKeyboardInput(GLFWwindow* window)
 	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
 	{
 		camera.processMovement(FORWARD, deltaTime);
+		movementMask |= movementBit(FORWARD);
 	}
 	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
 	{
 		camera.processMovement(BACKWARD, deltaTime);
+		movementMask |= movementBit(BACKWARD);
 	}
 	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
 	{
 		camera.processMovement(LEFT, deltaTime);
+		movementMask |= movementBit(LEFT);
 	}
 	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
 	{
 		camera.processMovement(RIGHT, deltaTime);
+		movementMask |= movementBit(RIGHT);
 	}
+	return movementMask;
 }
 
 // Based on the mouse position, calculate the new pitch and yaw and update the camera's internal state accordingly
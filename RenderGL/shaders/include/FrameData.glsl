@@ -0,0 +1,7 @@
+// Shared by all programs, updated once per frame (FrameData in main.cpp)
+layout (std140) uniform FrameData
+{
+    mat4 view_mat;
+    mat4 projection_mat;
+    vec4 lightPos; // xyz is the world-space light position
+};
@@ -0,0 +1,28 @@
+// Vertex decoding for quantized meshes, see VertexFormat in Mesh.h
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+vec3 decodePosition(vec3 position)
+{
+    return position * positionScale + positionOffset;
+}
+
+// Inverse of encodeOctahedral() in VertexQuantization.h
+vec3 decodeOctahedral(vec2 encoded)
+{
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -fold : fold;
+    normal.y += normal.y >= 0.0 ? -fold : fold;
+    return normalize(normal);
+}
+
+// OCTAHEDRAL_NORMALS is defined for meshes with octahedral encoded normals, so there is no branch per vertex
+vec3 decodeNormal(vec4 normal)
+{
+#ifdef OCTAHEDRAL_NORMALS
+    return decodeOctahedral(normal.xy);
+#else
+    return normal.xyz;
+#endif
+}
@@ -3,22 +3,36 @@ out vec4 FragColor;
 
 in vec3 FragPos;
 in vec3 Normal;
-
+#ifdef INSTANCED
+in vec3 ObjectColor; // Per instance instead of a uniform
+#else
 uniform vec3 objectColor;
-uniform vec3 lightColor;
-uniform vec3 lightPos;
+#endif
+
+// Constant for all objects, so it's compiled in instead of being a uniform
+#ifndef LIGHT_COLOR
+#define LIGHT_COLOR vec3(1.0) // Pure white light
+#endif
+
+#include "include/FrameData.glsl"
 
 void main()
 {
+#ifdef INSTANCED
+    vec3 color = ObjectColor;
+#else
+    vec3 color = objectColor;
+#endif
+
     // Ambient
     float ambientStrength = 0.1;
-    vec3 ambient = ambientStrength * lightColor;
+    vec3 ambient = ambientStrength * LIGHT_COLOR;
 
     // Diffuse
     vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(lightPos - FragPos); // Get the light ray
+    vec3 lightDir = normalize(lightPos.xyz - FragPos); // Get the light ray
     float diff = max(dot(norm, lightDir), 0.0); // Max since dot product could return negative if light is past 90 degrees
-    vec3 diffuse = diff * lightColor;
+    vec3 diffuse = diff * LIGHT_COLOR;
 
-    FragColor = vec4((ambient + diffuse) * objectColor, 1.0);
-}  
\ No newline at end of file
+    FragColor = vec4((ambient + diffuse) * color, 1.0);
+}
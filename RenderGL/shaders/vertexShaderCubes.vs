@@ -1,17 +1,32 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
-  
+layout (location = 1) in vec4 aNormal; // xyz, or octahedral encoded in xy
+#ifdef INSTANCED
+layout (location = 2) in mat4 aModelMat; // Per instance, takes up locations 2-5
+layout (location = 6) in vec3 aColor;    // Per instance
+#else
 uniform mat4 model_mat;
-uniform mat4 view_mat;
-uniform mat4 projection_mat;
+#endif
+
+#include "include/VertexDecoding.glsl"
+#include "include/FrameData.glsl"
 
 out vec3 FragPos;
 out vec3 Normal;
+#ifdef INSTANCED
+out vec3 ObjectColor;
+#endif
 
 void main()
 {
-    gl_Position = projection_mat * view_mat * model_mat * vec4(aPos, 1.0);
-    FragPos = vec3(model_mat * vec4(aPos, 1.0)); // Need in order to get fragment positions in world space
-    Normal = aNormal;
-} 
\ No newline at end of file
+#ifdef INSTANCED
+    mat4 model = aModelMat;
+    ObjectColor = aColor;
+#else
+    mat4 model = model_mat;
+#endif
+    vec3 position = decodePosition(aPos);
+    gl_Position = projection_mat * view_mat * model * vec4(position, 1.0);
+    FragPos = vec3(model * vec4(position, 1.0)); // Need in order to get fragment positions in world space
+    Normal = mat3(model) * decodeNormal(aNormal); // Cubes are rotated, only uniform scale so no inverse transpose needed
+}
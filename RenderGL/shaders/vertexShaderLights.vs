@@ -2,10 +2,11 @@
 layout (location = 0) in vec3 aPos;
 
 uniform mat4 model_mat;
-uniform mat4 view_mat;
-uniform mat4 projection_mat;
+
+#include "include/VertexDecoding.glsl"
+#include "include/FrameData.glsl"
 
 void main()
 {
-    gl_Position = projection_mat * view_mat * model_mat * vec4(aPos, 1.0);
-} 
\ No newline at end of file
+    gl_Position = projection_mat * view_mat * model_mat * vec4(decodePosition(aPos), 1.0);
+}